@@ -1,131 +1,190 @@
-
 #ifndef __GnssMonitor_h__
 #define __GnssMonitor_h__
 
-// State variables
-float mSpeed = 0;
-float mCourse = 0;
-float mLatitude = NAN;
-char mLatIndicator = 'N';
-float mLongitude = NAN;
-char mLonIndicator = 'E';
-float mElevation = NAN;
-String mMode = "---";
-float mVerticalError = NAN;
-float mHorizontalError = NAN;
-float mHdop = NAN;
-float mVdop = NAN;
-float mPdop = NAN;
-int8_t mFixType = 0;
-int mSats = 0;
-int mQuality = 0;
-String mGpstime = "---";
-int mSatsBySystem [5] = { 0, 0, 0, 0, 0 }; 
+#include "seqlock.h"
+#include "format.h"
+
+// State for one navigation epoch. Must stay plain data so it can be copied by the seqlock.
+struct GnssMonitorState
+{
+  uint32_t iTOW = 0;
+  float speed = 0;
+  float course = 0;
+  float latitude = NAN;
+  char latIndicator = 'N';
+  float longitude = NAN;
+  char lonIndicator = 'E';
+  float elevation = NAN;
+  TextBuffer<16> mode = "---";
+  float verticalError = NAN;
+  float horizontalError = NAN;
+  float hdop = NAN;
+  float vdop = NAN;
+  float pdop = NAN;
+  int8_t fixType = 0;
+  int sats = 0;
+  int quality = 0;
+  TextBuffer<12> gpstime = "---";
+  int satsBySystem [5] = { 0, 0, 0, 0, 0 };
+  // Raw values behind the texts, so they can be formatted later
+  uint8_t hour = 0;
+  uint8_t minute = 0;
+  uint8_t second = 0;
+  uint8_t carrSoln = 0;
+  const char* modeName = nullptr; // nullptr: show fixType:carrSoln
+};
+
+// Written by the GNSS callbacks (possibly from interrupt context), read by the pages
+SeqLock<GnssMonitorState> monitorState;
+GnssMonitorState mPending; // Producer's working copy. Only touched by the callbacks
+GnssMonitorState mView; // Reader's snapshot. Only touched by the UI
+bool monitorHeadless = false; // Display is off: keep the numbers, skip the texts only pages show
+
+// Take a consistent snapshot of the latest epoch for the accessors below. Call once per redraw.
+void refreshMonitorView()
+{
+  monitorState.read(mView);
+}
+
+void formatMonitorText(GnssMonitorState &m)
+{
+  m.gpstime.clear().appendTime(m.hour, m.minute, m.second);
+  m.mode.clear();
+  if(m.modeName)
+    m.mode.append(m.modeName);
+  else
+    m.mode.appendInt(m.fixType).append(':').appendInt(m.carrSoln); // "???";
+}
 
 char buf[1024];
 void onPVTDataChanged_(UBX_NAV_PVT_data_t pvt)
 {
-    mSpeed = pvt.gSpeed * 0.00194384449;
-    mCourse = pvt.headVeh/ 100000.0;
-    mElevation = pvt.hMSL / 1000.0;
-    mLatitude = pvt.lat / 10000000.0;
-    if(mLatitude <0)
+    GnssMonitorState &m = mPending;
+    m.iTOW = pvt.iTOW;
+    m.speed = pvt.gSpeed * 0.00194384449;
+    m.course = pvt.headVeh/ 100000.0;
+    m.elevation = pvt.hMSL / 1000.0;
+    m.latitude = pvt.lat / 10000000.0;
+    if(m.latitude <0)
     {
-      mLatIndicator = 'S';
-      mLatitude = -mLatitude;
+      m.latIndicator = 'S';
+      m.latitude = -m.latitude;
     }
     else 
-      mLatIndicator = 'N';
-    mLongitude = pvt.lon / 10000000.0;
-    if(mLongitude <0)
+      m.latIndicator = 'N';
+    m.longitude = pvt.lon / 10000000.0;
+    if(m.longitude <0)
     {
-      mLonIndicator = 'W';
-      mLongitude = -mLongitude;
+      m.lonIndicator = 'W';
+      m.longitude = -m.longitude;
     }
     else 
-      mLonIndicator = 'E';
+      m.lonIndicator = 'E';
 
-   mGpstime = String(pvt.hour) + (pvt.min < 10 ? ":0" : ":") + String(pvt.min)+ (pvt.sec < 10 ? ":0" : ":") + String(pvt.sec);
-   mFixType = pvt.fixType;
+   m.hour = pvt.hour;
+   m.minute = pvt.min;
+   m.second = pvt.sec;
+   m.fixType = pvt.fixType;
    auto flags = pvt.flags.bits.gnssFixOK;
    bool isValid = pvt.flags.bits.gnssFixOK == 1;
    uint8_t sol = pvt.flags.bits.carrSoln;
+   m.carrSoln = sol;
    uint8_t diffSoln = pvt.flags.bits.diffSoln;
+   const char* mode = nullptr;
     if(sol == 1) {
-      mMode = "RTK Float";
-      mQuality = 5;
+      mode = "RTK Float";
+      m.quality = 5;
     }
     else if(sol == 2) {
-      mMode = "RTK";
-      mQuality = 4;
+      mode = "RTK";
+      m.quality = 4;
     }
     else if(!isValid)
     {
-      mQuality = 0;
-      mMode = "No fix";
+      m.quality = 0;
+      mode = "No fix";
     }
     else if(diffSoln)
     {
-      mMode = "Differential";
-      mQuality = 2;
+      mode = "Differential";
+      m.quality = 2;
     }
     else {
-      if(mFixType == 0) {
-         mQuality = 0;
-         mMode = "No fix";
+      if(m.fixType == 0) {
+         m.quality = 0;
+         mode = "No fix";
       }
-      else if(mFixType == 2) {
-         mMode = "Dead Reckoning";
-         mQuality = 0;
+      else if(m.fixType == 2) {
+         mode = "Dead Reckoning";
+         m.quality = 0;
       }
-      else if(mFixType == 2) {
-         mMode = "GPS 2D";
-         mQuality = 1;
+      else if(m.fixType == 2) {
+         mode = "GPS 2D";
+         m.quality = 1;
       }
-      else if(mFixType == 3) {
-         mMode = "GPS";
-         mQuality = 1;
+      else if(m.fixType == 3) {
+         mode = "GPS";
+         m.quality = 1;
       }
-      else if(mFixType == 4) {
-         mMode = "Differential";
-         mQuality = 2;
+      else if(m.fixType == 4) {
+         mode = "Differential";
+         m.quality = 2;
       }
-      else if(mFixType == 5) {
-         mMode = "Time-only fix";
-         mQuality = 0;
+      else if(m.fixType == 5) {
+         mode = "Time-only fix";
+         m.quality = 0;
       }
-      else
-         mMode = String(mFixType) + ":" + String(sol); // "???";
     }
-    mSats = pvt.numSV;
+    m.modeName = mode;
+    if(!monitorHeadless)
+      formatMonitorText(m);
+    m.sats = pvt.numSV;
+    monitorState.write(m);
+}
+// Call from the same context as the callbacks. Leaving headless mode brings the texts up to date
+// and clears the values whose messages were turned off, so the pages don't show old ones.
+void setMonitorHeadless(bool headless)
+{
+  monitorHeadless = headless;
+  if(headless)
+    return;
+  formatMonitorText(mPending);
+  mPending.verticalError = NAN;
+  mPending.horizontalError = NAN;
+  mPending.pdop = NAN;
+  mPending.hdop = NAN;
+  mPending.vdop = NAN;
+  monitorState.write(mPending);
 }
 void OnHPPOSLLHChanged_(UBX_NAV_HPPOSLLH_data_t hppos)
 {
-  mVerticalError = hppos.vAcc / 10000.0;
-  mHorizontalError = hppos.hAcc / 10000.0;
+  mPending.verticalError = hppos.vAcc / 10000.0;
+  mPending.horizontalError = hppos.hAcc / 10000.0;
+  monitorState.write(mPending);
 }
 void OnDOPChanged_(UBX_NAV_DOP_data_t dop)
 {   
-  mPdop = dop.pDOP / 100.0;
-  mHdop = dop.hDOP / 100.0;
-  mVdop = dop.vDOP / 100.0;  
+  mPending.pdop = dop.pDOP / 100.0;
+  mPending.hdop = dop.hDOP / 100.0;
+  mPending.vdop = dop.vDOP / 100.0;  
+  monitorState.write(mPending);
 }
-  bool hasFix() { return mFixType > 0; };
-  int8_t fixType() { return mFixType; };
-  float speed() { return hasFix() ? mSpeed : NAN; };
-  float course() { return hasFix() ? mCourse : NAN; }; 
-  float latitude() { return hasFix() ? mLatitude : NAN; };
-  char latIndicator() { return mLatIndicator; }
-  float longitude() { return hasFix() ? mLongitude : NAN; }
-  char lonIndicator() { return mLonIndicator; }
-  float elevation() { return hasFix() ? mElevation : NAN; }
-  String mode() { return mMode; }
-  float verticalError() { return hasFix() ? mVerticalError : NAN; }
-  float horizontalError() { return hasFix() ? mHorizontalError : NAN; }
-  float hdop() { return hasFix() && mHdop < 99.9 ? mHdop : NAN; }
-  float vdop() { return hasFix() && mVdop < 99.9 ? mVdop : NAN; }
-  float pdop() { return hasFix() && mPdop < 99.9 ? mPdop : NAN; }
-  int sats() { return mSats; } // mSatsBySystem[0] + mSatsBySystem[1] + mSatsBySystem[2] + mSatsBySystem[3] + mSatsBySystem[4]; }
-  int quality() { return mQuality; }
-  String gpstime() { return mGpstime; }
+  bool hasFix() { return mView.fixType > 0; };
+  int8_t fixType() { return mView.fixType; };
+  float speed() { return hasFix() ? mView.speed : NAN; };
+  float course() { return hasFix() ? mView.course : NAN; }; 
+  float latitude() { return hasFix() ? mView.latitude : NAN; };
+  char latIndicator() { return mView.latIndicator; }
+  float longitude() { return hasFix() ? mView.longitude : NAN; }
+  char lonIndicator() { return mView.lonIndicator; }
+  float elevation() { return hasFix() ? mView.elevation : NAN; }
+  const char* mode() { return mView.mode.c_str(); }
+  float verticalError() { return hasFix() ? mView.verticalError : NAN; }
+  float horizontalError() { return hasFix() ? mView.horizontalError : NAN; }
+  float hdop() { return hasFix() && mView.hdop < 99.9 ? mView.hdop : NAN; }
+  float vdop() { return hasFix() && mView.vdop < 99.9 ? mView.vdop : NAN; }
+  float pdop() { return hasFix() && mView.pdop < 99.9 ? mView.pdop : NAN; }
+  int sats() { return mView.sats; } // mView.satsBySystem[0] + mView.satsBySystem[1] + mView.satsBySystem[2] + mView.satsBySystem[3] + mView.satsBySystem[4]; }
+  int quality() { return mView.quality; }
+  const char* gpstime() { return mView.gpstime.c_str(); }
 #endif
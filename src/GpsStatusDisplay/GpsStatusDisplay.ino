@@ -8,22 +8,105 @@
   3rd party libs used:
   ucglib : https://github.com/olikraus/ucglib  v1.5.2 http://librarymanager/All#Ucglib
   SparkFun u-blox lib: https://github.com/sparkfun/SparkFun_u-blox_GNSS_Arduino_Library
+  SdFat (with LOGGING): https://github.com/greiman/SdFat http://librarymanager/All#SdFat
 */
 
 #include <Wire.h>
 #include <Ucglib.h> //http://librarymanager/All#Ucglib
 
+// Uncomment to render into a 32KB RAM framebuffer and only send the changed areas to the display
+//#define DISPLAY_FRAMEBUFFER
+// With DISPLAY_FRAMEBUFFER, uncomment to send the changed areas with DMA while the loop keeps running (SAMD51)
+//#define DISPLAY_DMA
+// Uncomment to count heap operations per frame and print heap usage/fragmentation every 10 seconds
+//#define HEAP_STATS
+// Uncomment to print the time spent running and sleeping and the wakeup counts every 10 seconds
+//#define POWER_STATS
+// Uncomment to print the receiver link and parser counters (bytes, frames, checksum failures,
+// retries...) every 10 seconds. A long press of the down button shows them on a diagnostics page
+//#define LINK_STATS
+// To time the I2C reads, parsing, callbacks, rendering and menu handling, define STAGE_TIMING in
+// stagetimer.h. The times are printed every 10 seconds, and a long press of the right button
+// shows them on a diagnostics page
+// Uncomment if the receiver's TX ready output is wired to a pin. loop() then sleeps until the
+// receiver has data instead of waking up to poll it. GNSS_TXREADY_PIO is the receiver's PIO
+// number for the signal (see the receiver's integration manual)
+//#define PIN_GNSS_TXREADY 11
+//#define GNSS_TXREADY_PIO 6
+// Uncomment to log the receiver's UBX PVT and HPPOSLLH frames to an SD card. The log statistics
+// are printed every 10 seconds with LOG_LEVEL_INFO
+//#define LOGGING
+// With LOGGING, uncomment to also log raw measurements (RXM-RAWX, receivers with raw output only)
+//#define LOG_RAWX
+// With LOGGING, uncomment to also write a compact, delta encoded epoch log (LOGnnn.EPL, see
+// epochlog.h), less than a tenth of the size of the PVT and HPPOSLLH frames
+//#define LOG_EPOCHS
+// With LOGGING, uncomment to also write a time index of the UBX log (LOGnnn.IDX, see
+// logindex.h) so tools can seek to a time without scanning the log
+//#define LOG_INDEX
+// SD card chip select. The Adalogger FeatherWing uses pin 10, which is the left button here
+#define PIN_SD_CS 12
+// Frames wait here while the card is busy, a power of two. Each RAWX frame is up to about 3KB
+#define LOG_FILE_BUFFER_SIZE 16384
+
 // Initialize the OLED display:
+#ifdef DISPLAY_FRAMEBUFFER
+#include "framebuffer.h"
+Ucglib_SSD1351_18x128x128_FB_HWSPI ucg(/*cd=*/ 1, /*cs=*/ 0, /*reset=*/ 4);
+#else
 Ucglib_SSD1351_18x128x128_FT_HWSPI ucg(/*cd=*/ 1, /*cs=*/ 0, /*reset=*/ 4);
+#endif
 
 #include "SparkFun_u-blox_GNSS_Arduino_Library.h"
 #include "GnssMonitor.h"
+#include "headless.h"
 #include "drawhelpers.h"
 #include "Menu.h"
 #include "buttons.h"
 #include "bitmaps.h"
+#include "renderscheduler.h"
+#include "format.h"
+#include "heapstats.h"
+#include "stagetimer.h"
+#include "linkstats.h"
+#include "idle.h"
+
+// Screen refresh rate is independent of the GNSS navigation rate
+RenderScheduler renderScheduler(/*fps=*/ 5, /*frame budget ms=*/ 40);
+// Without TX ready, how often loop() wakes up to poll the receiver
+#define GNSS_POLL_INTERVAL_MS 50
+
 #include "statuspages.h"
 #include "settingsMenu.h"
+#ifdef LOGGING
+#include "logger.h"
+#ifdef LOGGER_POSIX
+PosixLogFile logDevice("gnss.ubx");
+#else
+SdLogFile logDevice(PIN_SD_CS);
+#endif
+#ifdef LOG_INDEX
+#ifdef LOGGER_POSIX
+PosixLogFile indexLogDevice("gnss.idx");
+#else
+SdLogFile indexLogDevice(PIN_SD_CS, "IDX", 1024UL * 1024);
+#endif
+UbxLogger indexBlockLogger(&indexLogDevice);
+UbxLogIndexer logIndexer(&indexBlockLogger);
+UbxLogger logger(&logDevice, &logIndexer);
+#else
+UbxLogger logger(&logDevice);
+#endif
+#ifdef LOG_EPOCHS
+#ifdef LOGGER_POSIX
+PosixLogFile epochLogDevice("gnss.epl");
+#else
+SdLogFile epochLogDevice(PIN_SD_CS, "EPL", 4UL * 1024 * 1024);
+#endif
+UbxLogger epochBlockLogger(&epochLogDevice);
+EpochLogger epochLogger(&epochBlockLogger);
+#endif
+#endif
 
 bool ledstate;
 bool isDisplayOff;
@@ -33,11 +116,14 @@ bool isInitializing = true;
 bool gpsConnectionError = false;
 
 int16_t currentDisplay = 2;
+int16_t lastStatusPage = 2; // Status page shown before the last press, where a hidden page goes back to
 
 void showDisplay(bool newPage)
 {
    if(isDisplayOff)
      return;
+   STAGE_TIMER(STAGE_RENDER);
+   refreshMonitorView();
    drawStatusBar(newPage);
    if (currentMenu)
      return;
@@ -49,6 +135,14 @@ void showDisplay(bool newPage)
       drawPage_NavigationInfo(newPage);
    else if(currentDisplay == 2)
       drawPage_LocationInfo(newPage);
+#ifdef STAGE_TIMING
+   else if(currentDisplay == STAGE_TIMES_PAGE)
+      drawPage_StageTimes(newPage);
+#endif
+#ifdef LINK_STATS
+   else if(currentDisplay == LINK_STATS_PAGE)
+      drawPage_LinkStats(newPage, gps.getLinkStats());
+#endif
 }
 void drawStatusBar(bool newPage)
 {
@@ -71,7 +165,7 @@ void drawStatusBar(bool newPage)
   }
   
   //Fix quality
-  String m;
+  const char* m;
   int q = quality();
   ucg.setColor(0,255,0);
   if(q == 0)
@@ -100,7 +194,7 @@ void drawStatusBar(bool newPage)
   ucg.print(m);
 
   // Horizontal error
-  String str = "      ";
+  TextBuffer<16> str("      ");
   auto err = horizontalError();
   if(!isnan(err)) {
     int decimals = 1;
@@ -110,21 +204,24 @@ void drawStatusBar(bool newPage)
       decimals = 2;
     else if(err < 2)
       decimals = 1;
-    str = " " + String(err, decimals) + "m  ";
+    str.clear().append(' ').appendFloat(err, decimals).append("m  ");
   }
   auto width = ucg.getStrWidth(str.c_str());
   ucg.setColor(255, 255, 0);
   ucg.setPrintPos(64-width/2+1,8); 
   ucg.print(str.c_str());
   if(!isnan(err))
-    drawBitmap(64-width/2-3, 1, 5, 7, plusminus, 255, 255, 0);
+    drawBitmap(64-width/2-3, 1, plusminusPacked, 255, 255, 0);
 
   // Satellite count
+  if(renderScheduler.deferNonCritical())
+    return;
   if(newPage)
-    drawBitmap(100, 1, 10, 6, satBitmap, 255, 255, 0);
+    drawBitmap(100, 1, satBitmapPacked, 255, 255, 0);
   ucg.setColor(255, 255, 0);
   ucg.setPrintPos(115,8);
-  ucg.print(String(sats()).c_str());
+  TextBuffer<4> satCount;
+  ucg.print(satCount.appendInt(sats()).c_str());
 }
 const int buttonPin = 10;
 unsigned long lastButtonPressTime;
@@ -140,11 +237,17 @@ void onPVTDataChanged(UBX_NAV_PVT_data_t pvt)
   ledstate = !ledstate;
 
   onPVTDataChanged_(pvt);
+#ifdef LOG_EPOCHS
+  epochLogger.addPVT(pvt);
+#endif
   hasNewData = true;
 }
 void OnHPPOSLLHChanged(UBX_NAV_HPPOSLLH_data_t hppos)
 {
   OnHPPOSLLHChanged_(hppos);
+#ifdef LOG_EPOCHS
+  epochLogger.addHPPOSLLH(hppos);
+#endif
   hasNewData = true;
 }
 void OnDOPChanged(UBX_NAV_DOP_data_t dop)
@@ -152,6 +255,9 @@ void OnDOPChanged(UBX_NAV_DOP_data_t dop)
   OnDOPChanged_(dop);
   hasNewData = true;
 }
+#ifdef PIN_GNSS_TXREADY
+void onGnssTxReady() { idleScheduler.wake(WAKE_GNSS); }
+#endif
 void configureGps()
 {
   //Wire.setClock(400000); //Increase I2C clock speed to 400kHz
@@ -166,13 +272,50 @@ void configureGps()
   gps.setAutoPVTcallback(onPVTDataChanged);
   gps.setAutoHPPOSLLHcallback(OnHPPOSLLHChanged);
   gps.setAutoDOPcallback(OnDOPChanged);
+#ifdef PIN_GNSS_TXREADY
+  // TX ready goes high when at least 8 bytes are waiting for I2C. Poll whenever it is high
+  gps.setVal8(UBLOX_CFG_TXREADY_ENABLED, 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  gps.setVal8(UBLOX_CFG_TXREADY_POLARITY, 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR); // High-active
+  gps.setVal8(UBLOX_CFG_TXREADY_PIN, GNSS_TXREADY_PIO, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  gps.setVal16(UBLOX_CFG_TXREADY_THRESHOLD, 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  gps.setVal8(UBLOX_CFG_TXREADY_INTERFACE, 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR); // I2C
+  gps.setI2CpollingWait(0);
+  pinMode(PIN_GNSS_TXREADY, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_GNSS_TXREADY), onGnssTxReady, RISING);
+#else
+  // Slightly shorter than the loop's poll interval, so a wakeup for a poll never finds the
+  // library's own timer a millisecond short
+  gps.setI2CpollingWait(GNSS_POLL_INTERVAL_MS - 2);
+#endif
 }
+#ifdef LOGGING
+void startLogging()
+{
+  gps.logNAVPVT();
+  gps.logNAVHPPOSLLH();
+#ifdef LOG_RAWX
+  gps.setAutoRXMRAWX(true, false);
+  gps.logRXMRAWX();
+#endif
+  if(!logger.begin(&gps))
+    LOG_ERROR("LOG DEVICE FAILED, CS PIN: ", PIN_SD_CS);
+#ifdef LOG_EPOCHS
+  if(!epochLogger.begin())
+    LOG_ERROR("EPOCH LOG FAILED, CS PIN: ", PIN_SD_CS);
+#endif
+#ifdef LOG_INDEX
+  if(!logIndexer.begin())
+    LOG_ERROR("LOG INDEX FAILED, CS PIN: ", PIN_SD_CS);
+#endif
+}
+#endif
 
 void setup()
 {
   Serial.begin(115200);
   // while (!Serial); //Wait for user to open terminal
   Serial.println("App start");
+  beginStageTiming();
   lastButtonPressTime = millis();
   Wire.begin();   
 #if defined(AM_PART_APOLLO3)
@@ -188,6 +331,9 @@ void setup()
   ucg.setFontMode(UCG_FONT_MODE_SOLID);
 
   int count = 0;
+#ifdef LOGGING
+  gps.setFileBufferSize(LOG_FILE_BUFFER_SIZE); // Allocated by begin()
+#endif
   bool gpsStarted = gps.begin(Wire);
   while(!gpsStarted && count < 20)
   {    
@@ -199,84 +345,241 @@ void setup()
       gpsConnectionError = true;
   if(!gpsConnectionError){
     configureGps();
+#ifdef LOGGING
+    startLogging();
+#endif
   }
   initSettingsMenu(&gps);
+#ifdef BENCHMARK_BITMAPS
+  benchmarkBitmaps();
+  ucg.clearScreen();
+#endif
   showDisplay(true);
   menu->setDisplay(&ucg);
+#ifdef DISPLAY_FRAMEBUFFER
+  ucg.flush();
+#endif
   digitalWrite(LED_BUILTIN, HIGH);
 }
 
-int buttonState = KEY_NONE;
 void loop()
 {
   bool requireFullRedraw = false;
   
+  auto ingestStart = micros();
+  auto pollTime = millis();
   if(!gpsConnectionError)
     gps.checkUblox(); // Check for the arrival of new data and process it.
     gps.checkCallbacks(); // Check if any callbacks are waiting to be processed. 
-  // Flash LED on each new data
-  if(!hasNewData)
-  {
-    delay(1);
-  }
+  renderScheduler.ingestDone(micros() - ingestStart);
+#ifdef LOGGING
+#ifdef DISPLAY_DMA
+  logger.service(!displayDma.isBusy()); // The card shares the SPI bus with the display
+#ifdef LOG_EPOCHS
+  epochBlockLogger.service(!displayDma.isBusy());
+#endif
+#ifdef LOG_INDEX
+  indexBlockLogger.service(!displayDma.isBusy());
+#endif
+#else
+  logger.service();
+#ifdef LOG_EPOCHS
+  epochBlockLogger.service();
+#endif
+#ifdef LOG_INDEX
+  indexBlockLogger.service();
+#endif
+#endif
+#endif
   // Process UI
   
   auto t = millis();
-  auto newButtonState = getButtonState();
+  updateButtons();
+  ButtonEvent event;
+  while(getButtonEvent(event))
+  {
+    lastButtonPressTime = t; //reset button press inactivity timer
+    if(isDisplayOff)
+    {
+      if(event.type == BUTTON_PRESS)
+      {
+        // A key was pressed -> Turn screen back on
+        isDisplayOff = false;
+        if(!gpsConnectionError)
+          leaveHeadless(&gps);
+        ucg.clearScreen();
+        ucg.powerUp();
+        requireFullRedraw = true;
+      }
+    }
+    else if(currentMenu) // A menu is currently active
+    {
+      auto result = processMenu(currentMenu, &gps, event);
+      if(result == MENU_RESULT_EXIT)
+      {
+        currentMenu = nullptr;
+        ucg.clearScreen();
+        requireFullRedraw = true;
+      }
+    }
+    else if(event.type == BUTTON_LONG_PRESS && event.key == KEY_LEFT)
+    {  
+      //Enter menu on hold
+      currentMenu = menu;
+      menu->reset();
+      menu->initScreen();
+    }
+#ifdef STAGE_TIMING
+    else if(event.type == BUTTON_LONG_PRESS && event.key == KEY_RIGHT)
+    {
+      // Hidden page, not part of the page cycle. Any press leaves it
+      currentDisplay = STAGE_TIMES_PAGE;
+      ucg.clearScreen();
+      requireFullRedraw = true;
+    }
+#endif
+#ifdef LINK_STATS
+    else if(event.type == BUTTON_LONG_PRESS && event.key == KEY_DOWN)
+    {
+      // Hidden page like the stage times
+      currentDisplay = LINK_STATS_PAGE;
+      ucg.clearScreen();
+      requireFullRedraw = true;
+    }
+#endif
+    else if(event.type == BUTTON_PRESS)
+    {
+      // flip status pages. Any press on a hidden diagnostics page (above 2) goes back to the
+      // status page it was opened from
+      if(currentDisplay > 2)
+        currentDisplay = lastStatusPage;
+      else if(event.key == KEY_RIGHT || event.key == KEY_DOWN)
+      {
+        lastStatusPage = currentDisplay;
+        currentDisplay++;
+        if(currentDisplay > 2)
+          currentDisplay = 0;
+      }
+      else if(event.key == KEY_UP || event.key == KEY_LEFT)
+      {
+        lastStatusPage = currentDisplay;
+        currentDisplay--;
+        if(currentDisplay < 0)
+          currentDisplay = 2;
+      }
+      ucg.clearScreen();
+      requireFullRedraw = true;
+    }
+  }
   if(t - lastButtonPressTime > 30000 && !isDisplayOff)
   {
     // Turn display off after 30 seconds of not pressing any button
     isDisplayOff = true;
     ucg.powerDown();
     currentMenu = nullptr;
+    if(!gpsConnectionError)
+      enterHeadless(&gps);
   }
-  else if(newButtonState != KEY_NONE && isDisplayOff)
+  // New data only marks the screen dirty. The scheduler decides when it is actually redrawn
+  if(hasNewData)
+    renderScheduler.requestRedraw();
+  if(requireFullRedraw)
+    renderScheduler.requestRedraw(true);
+  if(renderScheduler.frameDue(t))
   {
-    // A key was pressed -> Turn screen back on
-    isDisplayOff = false;
-    ucg.clearScreen();
-    ucg.powerUp();
-    requireFullRedraw = true;
+    bool fullRedraw = renderScheduler.isFullRedraw();
+    renderScheduler.beginFrame();
+    heapFrameBegin();
+    showDisplay(fullRedraw);
+    heapFrameEnd(fullRedraw);
+    renderScheduler.endFrame();
   }
-  else if(currentMenu == nullptr && newButtonState == KEY_LEFT && buttonState == KEY_LEFT && t - lastButtonPressTime > 1000)
-  {  
-    //Enter menu on hold
-    currentMenu = menu;
-    menu->reset();
-    menu->initScreen();
+#ifdef HEAP_STATS
+  static unsigned long lastHeapReport = 0;
+  if(t - lastHeapReport > 10000)
+  {
+    lastHeapReport = t;
+    printHeapStats(Serial);
   }
-  else if(currentMenu) // A menu is currently active
+#endif
+#ifdef POWER_STATS
+  static unsigned long lastPowerReport = 0;
+  if(t - lastPowerReport > 10000)
   {
-    auto result = processMenu(currentMenu, &gps);
-    if(result == MENU_RESULT_EXIT)
-    {
-      currentMenu = nullptr;
-      ucg.clearScreen();
-      requireFullRedraw = true;
-    }
+    lastPowerReport = t;
+    idleScheduler.printStats(Serial);
   }
-  else if (newButtonState != buttonState && newButtonState != KEY_NONE)
+#endif
+#ifdef STAGE_TIMING
+  static unsigned long lastStageReport = 0;
+  if(t - lastStageReport > 10000)
   {
-    // flip status pages
-    if(newButtonState == KEY_RIGHT || newButtonState == KEY_DOWN)
-    {
-      currentDisplay++;
-      if(currentDisplay > 2)
-        currentDisplay = 0;
-    }
-    else if(newButtonState == KEY_UP || newButtonState == KEY_LEFT)
-    {
-      currentDisplay--;
-      if(currentDisplay < 0)
-        currentDisplay = 2;
-    }
-    ucg.clearScreen();
-    requireFullRedraw = true;
+    lastStageReport = t;
+    printStageTimes(Serial);
+  }
+#endif
+#ifdef LINK_STATS
+  static unsigned long lastLinkReport = 0;
+  if(t - lastLinkReport > 10000)
+  {
+    lastLinkReport = t;
+    printLinkStats(Serial, gps);
+  }
+#endif
+#if defined(LOGGING) && LOG_LEVEL >= LOG_LEVEL_INFO
+  static unsigned long lastLogReport = 0;
+  if(t - lastLogReport > 10000)
+  {
+    lastLogReport = t;
+    logger.printStats(Serial);
+#ifdef LOG_EPOCHS
+    epochBlockLogger.printStats(Serial);
+    epochLogger.printStats(Serial);
+#endif
+#ifdef LOG_INDEX
+    indexBlockLogger.printStats(Serial);
+#endif
   }
-  if(hasNewData || requireFullRedraw)
-    showDisplay(requireFullRedraw);
-  if (newButtonState != buttonState)
-      lastButtonPressTime = t; //reset button press inactivity timer
-  buttonState = newButtonState;
+#endif
+#ifdef DISPLAY_FRAMEBUFFER
+  if(!isDisplayOff)
+    ucg.flush(); // Send whatever the pages and menu changed. displayFrameBuffer.lastFlushBytes has the cost
+#endif
   hasNewData = false;
+
+  // Sleep until the next thing to do
+  idleScheduler.beginIdle();
+  if(!isDisplayOff)
+  {
+    unsigned long frameTime;
+    if(renderScheduler.nextFrameTime(t, frameTime))
+      idleScheduler.wakeAt(frameTime, WAKE_FRAME);
+    idleScheduler.wakeAt(lastButtonPressTime + 30001, WAKE_TIMEOUT);
+#ifdef DISPLAY_FRAMEBUFFER
+    if(displayFrameBuffer.isDirty())
+      idleScheduler.wakeAt(t + 1, WAKE_DISPLAY); // Rest of the flush once the DMA transfer is done
+#endif
+  }
+#ifdef LOGGING
+  bool logPending = logger.writePending();
+#ifdef LOG_EPOCHS
+  logPending = logPending || epochBlockLogger.writePending();
+#endif
+#ifdef LOG_INDEX
+  logPending = logPending || indexBlockLogger.writePending();
+#endif
+  if(logPending)
+    idleScheduler.wakeAt(t + 1, WAKE_LOG); // Writes held back while the display had the bus
+#endif
+  uint32_t buttonTime;
+  if(nextButtonDeadline(buttonTime))
+    idleScheduler.wakeAt(buttonTime, WAKE_BUTTON);
+#ifdef PIN_GNSS_TXREADY
+  if(!gpsConnectionError && digitalRead(PIN_GNSS_TXREADY) == HIGH)
+    idleScheduler.wakeAt(t, WAKE_GNSS); // More data than one poll read
+#else
+  if(!gpsConnectionError)
+    idleScheduler.wakeAt(pollTime + GNSS_POLL_INTERVAL_MS, WAKE_POLL);
+#endif
+  idleScheduler.sleep(isDisplayOff ? POWER_IDLE_DISPLAY_OFF : POWER_IDLE);
 }
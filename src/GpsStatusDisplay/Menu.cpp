@@ -1,11 +1,29 @@
 #include "Menu.h"
+#include "logging.h"
+#include "stagetimer.h"
 
-Menu::Menu(MenuItem* menuItem)
+#define ROW_NORMAL 0
+#define ROW_SELECTED 1
+#define ROW_PRESSED 2
+
+Menu::Menu(const MenuItem* menuItem, uint8_t* values, const char* const* valueText)
 {
   rootMenu = menuItem; 
   currentMenu = menuItem;
-  clearMenuIndex = -1;
   selectedIndex = 0; 
+  invalidateRows();
+  _values = values;
+  _valueText = valueText;
+  initValues(menuItem);
+}
+
+// Set every value slot to its item's default
+void Menu::initValues(const MenuItem* item)
+{
+  if(item->getValueSlot() != MENU_NO_VALUE)
+    _values[item->getValueSlot()] = item->getDefaultValue();
+  for(uint8_t i = 0; i < item->getChildCount(); i++)
+    initValues(item->getChild(i));
 }
     
 void Menu::initScreen()
@@ -13,8 +31,6 @@ void Menu::initScreen()
   drawHeader();
   currentButton = KEY_NONE;
   show(); 
-  if (getButtonState() == KEY_LEFT) // Ensure select isn't triggered when launching if already pressed
-    currentButton = KEY_INITIALIZING;
 }
 void Menu::drawHeader()
 {
@@ -33,6 +49,12 @@ void Menu::drawHeader()
 
   ucg->setColor(0, 0, 0);
   ucg->drawBox(0, yOffset + titleHeight, screen_width, screen_height - yOffset - titleHeight);
+  invalidateRows();
+}
+void Menu::invalidateRows()
+{
+  for(uint8_t i = 0; i < MENU_MAX_ROWS; i++)
+    rows[i].index = MENU_NO_VALUE;
 }
 void Menu::show() 
 {
@@ -41,9 +63,10 @@ void Menu::show()
   auto ascent = ucg->getFontAscent();
   auto descent = -ucg->getFontDescent();
  
-  int count = currentMenu->getChildCount();
+  int count = shownChildCount(currentMenu);
   int maxrows = (screen_height - yOffset - titleHeight + yPadding) / (ascent + descent + yPadding);  
-  Serial.println(("max rows:" + String(maxrows)).c_str());
+  if(maxrows > MENU_MAX_ROWS)
+    maxrows = MENU_MAX_ROWS;
   bool scrollRequired = false;
   if(selectedIndex < scrollOffset)
   {
@@ -55,31 +78,46 @@ void Menu::show()
     scrollOffset = selectedIndex - maxrows + 1;    
     scrollRequired = true;
   }
-  Serial.println(("scrollOffset:" + String(scrollOffset)).c_str());
-  Serial.println(("selectedIndex:" + String(selectedIndex)).c_str());
+  LOG_DEBUG("scrollOffset:", scrollOffset);
+  LOG_DEBUG("selectedIndex:", selectedIndex);
   if(scrollRequired)
   {
     //We need to scroll, so clear menu area
     ucg->setColor(0, 0, 0);
     ucg->drawBox(0, yOffset + titleHeight, screen_width, screen_height - yOffset - titleHeight);
-    clearMenuIndex = -1;    
+    invalidateRows();
   }
   int y = yOffset + titleHeight;
-  for(uint8_t i = 0; i < count; i++)
+  for(uint8_t row = 0; row < maxrows && scrollOffset + row < count; row++)
   {
-    if(i < scrollOffset || i-scrollOffset >= maxrows) continue; //skip rows outside screen
+    uint8_t i = scrollOffset + row;
     y += ascent+descent;
-    if(i == clearMenuIndex)
+    const MenuItem* item = currentMenu->getChild(i);
+    uint8_t state = i != selectedIndex ? ROW_NORMAL : currentButton == KEY_RIGHT ? ROW_PRESSED : ROW_SELECTED;
+    uint8_t value = item->getChildCount() > 0 ? MENU_NO_VALUE : getValue(item);
+    Row &drawn = rows[row];
+    if(drawn.index == i && drawn.state == state && drawn.value == value)
+    {
+      y += yPadding;
+      continue; // Nothing changed
+    }
+    const char* valueText = value == MENU_NO_VALUE ? nullptr : _valueText[value];
+    if(drawn.index != i || drawn.value != value)
+      drawn.valueWidth = valueText != nullptr ? ucg->getStrWidth(valueText) : 0;
+    if(state == ROW_NORMAL && drawn.index != MENU_NO_VALUE)
     {
+      // Remove the old selection background or value
       ucg->setColor(0, 0, 0);
       ucg->drawBox(0, y-ascent-3, screen_width, ascent+6);
-      clearMenuIndex = -1;
     }
-    ucg->setColor(255,255,255);
-    if(i == selectedIndex)
+    drawn.index = i;
+    drawn.state = state;
+    drawn.value = value;
+
+    if(state != ROW_NORMAL)
     {
        // Invert
-      if(currentButton == KEY_RIGHT)
+      if(state == ROW_PRESSED)
       {
         // invert to selection color while button is pressed
         ucg->setColor(255,255,0);
@@ -92,30 +130,22 @@ void Menu::show()
       ucg->setColor(128, 128, 255);
     }
     else {
+      ucg->setColor(255,255,255);
       ucg->setFontMode(UCG_FONT_MODE_SOLID);
     }
-    MenuItem* item = currentMenu->getChild(i);
-    const char* text = item->getTitle();
-    ucg->drawString(2, y, 0, text);
+    ucg->drawString(2, y, 0, item->getTitle());
     if(item->getChildCount() > 0)
       ucg->drawString(120, y, 0, ">");
-    else {
-      auto value = item->getValue();
-      if(value != nullptr)
-      {
-        auto width = ucg->getStrWidth(value.c_str());
-        ucg->drawString(screen_width - width - 1, y, 0, value.c_str());
-      }
-    }
+    else if(valueText != nullptr)
+      ucg->drawString(screen_width - drawn.valueWidth - 1, y, 0, valueText);
     y += yPadding;
   }
 }
 
 void Menu::up()
 { 
-  clearMenuIndex = selectedIndex;
   if(selectedIndex == 0)
-    selectedIndex = currentMenu->getChildCount() - 1;
+    selectedIndex = shownChildCount(currentMenu) - 1;
   else
     selectedIndex--;
   show();
@@ -123,27 +153,19 @@ void Menu::up()
 
 void Menu::down()
 {
-  clearMenuIndex = selectedIndex++;
-  if(selectedIndex >= currentMenu->getChildCount())
+  selectedIndex++;
+  if(selectedIndex >= shownChildCount(currentMenu))
     selectedIndex = 0;
   show();
 }
 
 bool Menu::left()
 {
-  auto parent = currentMenu->getParent();
-  if(parent != nullptr)
+  if(depth > 0)
   {
     auto childmenu = currentMenu;
-    currentMenu = parent;
-    for(int i = 0; i<currentMenu->getChildCount(); i++)
-    {
-      if(currentMenu->getChild(i) == childmenu)
-      {
-        selectedIndex = i;
-        break;
-      }
-    }
+    currentMenu = parents[--depth];
+    selectedIndex = childmenu - currentMenu->getChild(0); // Children are stored in one array
     drawHeader();
     show();
     return true;
@@ -154,8 +176,9 @@ bool Menu::left()
 int Menu::select()
 { 
   auto item = selectedMenuItem();
-  if(item->getChildCount() > 0)
+  if(item->getChildCount() > 0 && depth < MENU_MAX_DEPTH)
   {
+    parents[depth++] = currentMenu;
     selectedIndex = 0;
     currentMenu = item;
     drawHeader();
@@ -164,39 +187,40 @@ int Menu::select()
   return item->getId();
 }
 
-int Menu::processMenu()
+// Up, down and left act when pressed. Right shows the selection color while held and selects
+// on release, so a release that belongs to a press from before the menu opened does nothing.
+int Menu::processMenu(const ButtonEvent &event)
 {
+  STAGE_TIMER(STAGE_MENU);
   int result = -1;
-  int button = getButtonState();
-  if(button == KEY_LEFT && currentButton == KEY_INITIALIZING)
-    button = KEY_INITIALIZING;
-
-  auto oldButton = currentButton;
-  currentButton = button;
-  if (oldButton != currentButton)
+  LOG_DEBUG("Button event: ", event.type);
+  if(event.type == BUTTON_PRESS)
   {
-    Serial.println(("Button pressed: " + String(button)).c_str());
-    // Act on button change
-    if(button == KEY_UP)
+    currentButton = event.key;
+    if(event.key == KEY_UP)
       up();
-    else if(button == KEY_DOWN)
+    else if(event.key == KEY_DOWN)
       down();    
-    else if(button == KEY_LEFT)
+    else if(event.key == KEY_LEFT)
     {
       if(!left())
         result = MENU_RESULT_EXIT;
     }
-    else if(oldButton == KEY_RIGHT && button == KEY_NONE)
-    {
-       //Select item on release
-       result = select();
-    }
-    else if(button == KEY_RIGHT)
+    else if(event.key == KEY_RIGHT)
     {
        // Do nothing, but show() will draw item with selection color
        // We'll act on select on release below
        show();
     }
   }
+  else if(event.type == BUTTON_RELEASE && event.key == currentButton)
+  {
+    currentButton = KEY_NONE;
+    if(event.key == KEY_RIGHT)
+    {
+       //Select item on release
+       result = select();
+    }
+  }
   return result;
 }
@@ -1,63 +1,72 @@
 #ifndef _MENU_H_
 #define _MENU_H_
 
-#define KEY_INITIALIZING 6
 #define MENU_RESULT_EXIT -2
 
 #include <Arduino.h>
 #include <Ucglib.h> //http://librarymanager/All#Ucglib
 #include "buttons.h"
 
+#define MENU_NO_VALUE 0xFF // Value slot of items whose value never changes
+#define MENU_MAX_DEPTH 4
+#define MENU_MAX_ROWS 8 // Rows that fit below the title
+
+// One entry of a menu tree. The tree is declared constexpr so it lives in flash and is ready
+// before any constructor runs. Values that change at runtime are small integers kept in a
+// separate RAM array owned by the Menu, indexed by the item's value slot. Items without a slot
+// always show their default value. A submenu with a slot shows only as many children as its
+// value says.
 class MenuItem
 {
   public:
-    MenuItem(const int id, const char* title, const char* value = nullptr, const uint32_t tag = 0)
-     : _id(id), _title(title), _childCount(0), _tag(tag)
-    {
-      _children = nullptr;
-      _parent = nullptr;
-      _value = value;
-    };
-    MenuItem(const int id, const char* title, MenuItem** children,  const uint8_t childCount)
-     : _id(id), _title(title), _childCount(childCount), _tag(0)
-    {
-      _children = children;
-      _parent = nullptr;
-      for(uint8_t i=0;i<childCount;i++)
-        _children[i]->setParent(this);
-    };
-    const char* getTitle() { return _title; };
-    MenuItem* getParent() { return _parent; };
-    MenuItem* getChild(uint8_t i) { return _children[i]; };
-    const uint8_t getChildCount() { return _childCount; };
-    const int getId() { return _id; };
-    String getValue() { return _value; };
-    const uint32_t getTag() { return _tag; };
-    void setValue(const char *value) { _value = String(value); };
-    void setValue(String value) { _value = value; };
-    void setChildren(MenuItem** children,  const uint8_t childCount) { _children = children, _childCount = childCount; };
-    void setTitle(const char* title) { _title = title; };
+    constexpr MenuItem(const int16_t id, const char* title, const uint8_t valueSlot = MENU_NO_VALUE, const uint8_t defaultValue = 0, const uint32_t tag = 0)
+     : _id(id), _title(title), _children(nullptr), _childCount(0), _valueSlot(valueSlot), _defaultValue(defaultValue), _tag(tag)
+    { };
+    template<size_t N>
+    constexpr MenuItem(const int16_t id, const char* title, const MenuItem (&children)[N])
+     : _id(id), _title(title), _children(children), _childCount(N), _valueSlot(MENU_NO_VALUE), _defaultValue(0), _tag(0)
+    { };
+    template<size_t N>
+    constexpr MenuItem(const int16_t id, const char* title, const MenuItem (&children)[N], const uint8_t countSlot, const uint8_t defaultCount)
+     : _id(id), _title(title), _children(children), _childCount(N), _valueSlot(countSlot), _defaultValue(defaultCount), _tag(0)
+    { };
+    const char* getTitle() const { return _title; };
+    const MenuItem* getChild(uint8_t i) const { return &_children[i]; };
+    uint8_t getChildCount() const { return _childCount; };
+    int getId() const { return _id; };
+    uint8_t getValueSlot() const { return _valueSlot; };
+    uint8_t getDefaultValue() const { return _defaultValue; };
+    uint32_t getTag() const { return _tag; };
   private:
-    void setParent(MenuItem* parent) { _parent=parent; }
-    const int _id;
+    const int16_t _id;
     const char* _title;
-    String _value;
-    uint8_t _childCount;
+    const MenuItem* _children;
+    const uint8_t _childCount;
+    const uint8_t _valueSlot;
+    const uint8_t _defaultValue;
     const uint32_t _tag;
-    MenuItem** _children;
-    MenuItem* _parent;
 };
 
 class Menu
 {
   public:
-    Menu(MenuItem* menuItem);
-    int processMenu();
+    // values holds one entry per value slot, valueText the text shown for each value
+    Menu(const MenuItem* menuItem, uint8_t* values, const char* const* valueText);
+    int processMenu(const ButtonEvent &event);
     void initScreen();
     void setDisplay(Ucglib *display) { _ucg = display; };
-    void reset() { currentMenu = rootMenu; clearMenuIndex = -1; selectedIndex = 0; };
-    MenuItem* selectedMenuItem() { return currentMenu->getChild(selectedIndex); };
+    void reset() { currentMenu = rootMenu; depth = 0; selectedIndex = 0; invalidateRows(); };
+    const MenuItem* selectedMenuItem() { return currentMenu->getChild(selectedIndex); };
     void refresh() { show(); };
+    uint8_t getValue(const MenuItem* item)
+    {
+      return item->getValueSlot() == MENU_NO_VALUE ? item->getDefaultValue() : _values[item->getValueSlot()];
+    };
+    void setValue(const MenuItem* item, uint8_t value)
+    {
+      if(item->getValueSlot() != MENU_NO_VALUE)
+        _values[item->getValueSlot()] = value;
+    };
 
   private:
     void show();
@@ -66,12 +75,33 @@ class Menu
     bool left();
     int select();
     void drawHeader();
+    void invalidateRows();
+    void initValues(const MenuItem* item);
+    uint8_t shownChildCount(const MenuItem* item)
+    {
+      uint8_t count = item->getChildCount();
+      if(count > 0 && item->getValueSlot() != MENU_NO_VALUE && _values[item->getValueSlot()] < count)
+        count = _values[item->getValueSlot()];
+      return count;
+    };
     //state
     uint8_t selectedIndex;
-    MenuItem* rootMenu;
-    MenuItem* currentMenu;
+    const MenuItem* rootMenu;
+    const MenuItem* currentMenu;
+    const MenuItem* parents[MENU_MAX_DEPTH]; // Path from the root to currentMenu
+    uint8_t depth = 0;
+    uint8_t* _values;
+    const char* const* _valueText;
     int currentButton = KEY_NONE;    
-    int clearMenuIndex = -1;
+    // What each visible row shows, so show() only redraws rows that changed
+    struct Row
+    {
+      uint8_t index;      // Child shown in the row, MENU_NO_VALUE if nothing has been drawn
+      uint8_t state;      // ROW_NORMAL, ROW_SELECTED or ROW_PRESSED
+      uint8_t value;      // Value shown, MENU_NO_VALUE for submenus
+      uint8_t valueWidth; // Width of the value text in pixels
+    };
+    Row rows[MENU_MAX_ROWS];
     // display settings
     uint8_t yOffset = 10;
     uint8_t yPadding = 3;
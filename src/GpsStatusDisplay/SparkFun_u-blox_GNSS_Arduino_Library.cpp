@@ -41,6 +41,7 @@
 */
 
 #include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+#include "stagetimer.h"
 
 SFE_UBLOX_GNSS::SFE_UBLOX_GNSS(void)
 {
@@ -716,8 +717,10 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
     _i2cPort->beginTransmission(_gpsI2Caddress);
     _i2cPort->write(0xFD);                     //0xFD (MSB) and 0xFE (LSB) are the registers that contain number of bytes available
     uint8_t i2cError = _i2cPort->endTransmission(false); //Send a restart command. Do not release bus.
+    linkStats.polls++;
     if (i2cError != 0)
     {
+      linkStats.busErrors++;
       if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
       {
         _debugSerial->print(F("checkUbloxI2C: I2C error: endTransmission returned "));
@@ -726,9 +729,14 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
       return (false);                          //Sensor did not ACK
     }
 
-    uint8_t bytesReturned = _i2cPort->requestFrom((uint8_t)_gpsI2Caddress, (uint8_t)2);
+    uint8_t bytesReturned;
+    {
+      STAGE_TIMER(STAGE_I2C);
+      bytesReturned = _i2cPort->requestFrom((uint8_t)_gpsI2Caddress, (uint8_t)2);
+    }
     if (bytesReturned != 2)
     {
+      linkStats.busErrors++;
       if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
       {
         _debugSerial->print(F("checkUbloxI2C: I2C error: requestFrom 0xFD returned "));
@@ -743,6 +751,7 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
       if (lsb == 0xFF)
       {
         //I believe this is a u-blox bug. Device should never present an 0xFF.
+        linkStats.lengthLsbFF++;
         if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
         {
           _debugSerial->print(F("checkUbloxI2C: u-blox bug? Length lsb is 0xFF. i2cPollingWait is "));
@@ -779,6 +788,7 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
 
     if (bytesAvailable == 0)
     {
+      linkStats.emptyPolls++;
 #ifndef SFE_UBLOX_REDUCED_PROG_MEM
       if (_printDebug == true)
       {
@@ -796,6 +806,7 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
     {
       //Clear the MSbit
       bytesAvailable &= ~((uint16_t)1 << 15);
+      linkStats.lengthMsbSet++;
 
       // if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
       // {
@@ -836,7 +847,10 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
       _i2cPort->beginTransmission(_gpsI2Caddress);
       _i2cPort->write(0xFF);                     //0xFF is the register to read data from
       if (_i2cPort->endTransmission(false) != 0) //Send a restart command. Do not release bus.
+      {
+        linkStats.busErrors++;
         return (false);                          //Sensor did not ACK
+      }
 
       //Limit to 32 bytes or whatever the buffer limit is for given platform
       uint16_t bytesToRead = bytesAvailable;
@@ -845,9 +859,13 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
 
     TRY_AGAIN:
 
-      _i2cPort->requestFrom((uint8_t)_gpsI2Caddress, (uint8_t)bytesToRead);
+      {
+        STAGE_TIMER(STAGE_I2C);
+        _i2cPort->requestFrom((uint8_t)_gpsI2Caddress, (uint8_t)bytesToRead);
+      }
       if (_i2cPort->available())
       {
+        STAGE_TIMER(STAGE_PARSE);
         for (uint16_t x = 0; x < bytesToRead; x++)
         {
           uint8_t incoming = _i2cPort->read(); //Grab the actual character
@@ -858,6 +876,7 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
           {
             if ((incoming == 0x7F) && (ubx7FcheckDisabled == false))
             {
+              linkStats.notReadyRetries++;
               if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
               {
                 _debugSerial->println(F("checkUbloxU2C: u-blox error, module not ready with data (7F error)"));
@@ -877,7 +896,10 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
         }
       }
       else
+      {
+        linkStats.busErrors++;
         return (false); //Sensor did not respond
+      }
 
       bytesAvailable -= bytesToRead;
     }
@@ -890,6 +912,9 @@ boolean SFE_UBLOX_GNSS::checkUbloxI2C(ubxPacket *incomingUBX, uint8_t requestedC
 //Checks Serial for data, passing any new bytes to process()
 boolean SFE_UBLOX_GNSS::checkUbloxSerial(ubxPacket *incomingUBX, uint8_t requestedClass, uint8_t requestedID)
 {
+  if (!_serialPort->available())
+    return (true);
+  STAGE_TIMER(STAGE_PARSE);
   while (_serialPort->available())
   {
     process(_serialPort->read(), incomingUBX, requestedClass, requestedID);
@@ -1201,6 +1226,7 @@ uint16_t SFE_UBLOX_GNSS::getMaxPayloadSize(uint8_t Class, uint8_t ID)
 //Take a given byte and file it into the proper array
 void SFE_UBLOX_GNSS::process(uint8_t incoming, ubxPacket *incomingUBX, uint8_t requestedClass, uint8_t requestedID)
 {
+  linkStats.bytesRead++;
   if ((currentSentence == NONE) || (currentSentence == NMEA))
   {
     if (incoming == 0xB5) //UBX binary frames start with 0xB5, aka μ
@@ -1238,7 +1264,10 @@ void SFE_UBLOX_GNSS::process(uint8_t incoming, ubxPacket *incomingUBX, uint8_t r
     if ((ubxFrameCounter == 0) && (incoming != 0xB5))      //ISO 'μ'
       currentSentence = NONE;                              //Something went wrong. Reset.
     else if ((ubxFrameCounter == 1) && (incoming != 0x62)) //ASCII 'b'
+    {
       currentSentence = NONE;                              //Something went wrong. Reset.
+      linkStats.resyncs++;
+    }
     // Note to future self:
     // There may be some duplication / redundancy in the next few lines as processUBX will also
     // load information into packetBuf, but we'll do it here too for clarity
@@ -1303,6 +1332,7 @@ void SFE_UBLOX_GNSS::process(uint8_t incoming, ubxPacket *incomingUBX, uint8_t r
           packetAuto.payload = payloadAuto;
           if (payloadAuto == NULL) // Check if the alloc failed
           {
+            linkStats.allocFailures++;
             if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
             {
               _debugSerial->print(F("process: memory allocation failed for \"automatic\" message: Class: 0x"));
@@ -1450,6 +1480,7 @@ void SFE_UBLOX_GNSS::process(uint8_t incoming, ubxPacket *incomingUBX, uint8_t r
     else if ((nmeaByteCounter == 1) && (incoming != 'G'))
     {
       currentSentence = NONE; //Something went wrong. Reset.
+      linkStats.resyncs++;
     }
     else if ((nmeaByteCounter >= 0) && (nmeaByteCounter <= 5))
     {
@@ -1489,10 +1520,16 @@ void SFE_UBLOX_GNSS::process(uint8_t incoming, ubxPacket *incomingUBX, uint8_t r
     nmeaByteCounter++; // Increment the byte counter
 
     if (nmeaByteCounter == maxNMEAByteCount) // Check if we have processed too many bytes
+    {
       currentSentence = NONE; //Something went wrong. Reset.
+      linkStats.overruns++;
+    }
 
     if (nmeaByteCounter == 0) // Check if we are done
+    {
       currentSentence = NONE; // All done!
+      linkStats.nmeaSentences++;
+    }
   }
   else if (currentSentence == RTCM)
   {
@@ -1613,6 +1650,7 @@ void SFE_UBLOX_GNSS::processRTCMframe(uint8_t incoming)
   {
     //We're done!
     currentSentence = NONE; //Reset and start looking for next sentence type
+    linkStats.rtcmFrames++;
   }
 }
 
@@ -1707,6 +1745,7 @@ void SFE_UBLOX_GNSS::processUBX(uint8_t incoming, ubxPacket *incomingUBX, uint8_
     if ((incomingUBX->checksumA == rollingChecksumA) && (incomingUBX->checksumB == rollingChecksumB))
     {
       incomingUBX->valid = SFE_UBLOX_PACKET_VALIDITY_VALID; // Flag the packet as valid
+      countUBXmessage(incomingUBX->cls, incomingUBX->id);
 
       // Let's check if the class and ID match the requestedClass and requestedID
       // Remember - this could be a data packet or an ACK packet
@@ -1789,6 +1828,7 @@ void SFE_UBLOX_GNSS::processUBX(uint8_t incoming, ubxPacket *incomingUBX, uint8_
     else // Checksum failure
     {
       incomingUBX->valid = SFE_UBLOX_PACKET_VALIDITY_NOT_VALID;
+      linkStats.checksumFailures++;
 
       // Let's check if the class and ID match the requestedClass and requestedID.
       // This is potentially risky as we are saying that we saw the requested Class and ID
@@ -1867,6 +1907,7 @@ void SFE_UBLOX_GNSS::processUBX(uint8_t incoming, ubxPacket *incomingUBX, uint8_
   {
     //Something has gone very wrong
     currentSentence = NONE; //Reset the sentence to being looking for a new start char
+    linkStats.overruns++;
     if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
     {
       if (overrun)
@@ -1887,6 +1928,7 @@ void SFE_UBLOX_GNSS::processUBX(uint8_t incoming, ubxPacket *incomingUBX, uint8_
 //Once a packet has been received and validated, identify this packet's class/id and update internal flags
 void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
 {
+  STAGE_TIMER(STAGE_DECODE);
   switch (msg->cls)
   {
   case UBX_CLASS_NAV:
@@ -1911,6 +1953,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVPOSECEF->callbackData->iTOW, &packetUBXNAVPOSECEF->data.iTOW, sizeof(UBX_NAV_POSECEF_data_t));
           packetUBXNAVPOSECEF->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVPOSECEF->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVPOSECEF->automaticFlags.flags.bits.addToFileBuffer)
@@ -1942,6 +1986,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVSTATUS->callbackData->iTOW, &packetUBXNAVSTATUS->data.iTOW, sizeof(UBX_NAV_STATUS_data_t));
           packetUBXNAVSTATUS->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVSTATUS->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVSTATUS->automaticFlags.flags.bits.addToFileBuffer)
@@ -1974,6 +2020,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVDOP->callbackData->iTOW, &packetUBXNAVDOP->data.iTOW, sizeof(UBX_NAV_DOP_data_t));
           packetUBXNAVDOP->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVDOP->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVDOP->automaticFlags.flags.bits.addToFileBuffer)
@@ -2006,6 +2054,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVATT->callbackData->iTOW, &packetUBXNAVATT->data.iTOW, sizeof(UBX_NAV_ATT_data_t));
           packetUBXNAVATT->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVATT->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVATT->automaticFlags.flags.bits.addToFileBuffer)
@@ -2063,6 +2113,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVPVT->callbackData->iTOW, &packetUBXNAVPVT->data.iTOW, sizeof(UBX_NAV_PVT_data_t));
           packetUBXNAVPVT->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVPVT->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVPVT->automaticFlags.flags.bits.addToFileBuffer)
@@ -2092,6 +2144,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVODO->callbackData->version, &packetUBXNAVODO->data.version, sizeof(UBX_NAV_ODO_data_t));
           packetUBXNAVODO->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVODO->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVODO->automaticFlags.flags.bits.addToFileBuffer)
@@ -2121,6 +2175,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVVELECEF->callbackData->iTOW, &packetUBXNAVVELECEF->data.iTOW, sizeof(UBX_NAV_VELECEF_data_t));
           packetUBXNAVVELECEF->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVVELECEF->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVVELECEF->automaticFlags.flags.bits.addToFileBuffer)
@@ -2154,6 +2210,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVVELNED->callbackData->iTOW, &packetUBXNAVVELNED->data.iTOW, sizeof(UBX_NAV_VELNED_data_t));
           packetUBXNAVVELNED->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVVELNED->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVVELNED->automaticFlags.flags.bits.addToFileBuffer)
@@ -2188,6 +2246,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVHPPOSECEF->callbackData->version, &packetUBXNAVHPPOSECEF->data.version, sizeof(UBX_NAV_HPPOSECEF_data_t));
           packetUBXNAVHPPOSECEF->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVHPPOSECEF->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVHPPOSECEF->automaticFlags.flags.bits.addToFileBuffer)
@@ -2225,6 +2285,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVHPPOSLLH->callbackData->version, &packetUBXNAVHPPOSLLH->data.version, sizeof(UBX_NAV_HPPOSLLH_data_t));
           packetUBXNAVHPPOSLLH->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVHPPOSLLH->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVHPPOSLLH->automaticFlags.flags.bits.addToFileBuffer)
@@ -2254,6 +2316,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVCLOCK->callbackData->iTOW, &packetUBXNAVCLOCK->data.iTOW, sizeof(UBX_NAV_CLOCK_data_t));
           packetUBXNAVCLOCK->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVCLOCK->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVCLOCK->automaticFlags.flags.bits.addToFileBuffer)
@@ -2364,6 +2428,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXNAVRELPOSNED->callbackData->version, &packetUBXNAVRELPOSNED->data.version, sizeof(UBX_NAV_RELPOSNED_data_t));
           packetUBXNAVRELPOSNED->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXNAVRELPOSNED->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXNAVRELPOSNED->automaticFlags.flags.bits.addToFileBuffer)
@@ -2405,6 +2471,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXRXMSFRBX->callbackData->gnssId, &packetUBXRXMSFRBX->data.gnssId, sizeof(UBX_RXM_SFRBX_data_t));
           packetUBXRXMSFRBX->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXRXMSFRBX->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXRXMSFRBX->automaticFlags.flags.bits.addToFileBuffer)
@@ -2462,6 +2530,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXRXMRAWX->callbackData->header.rcvTow[0], &packetUBXRXMRAWX->data.header.rcvTow[0], sizeof(UBX_RXM_RAWX_data_t));
           packetUBXRXMRAWX->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXRXMRAWX->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXRXMRAWX->automaticFlags.flags.bits.addToFileBuffer)
@@ -2513,6 +2583,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXTIMTM2->callbackData->ch, &packetUBXTIMTM2->data.ch, sizeof(UBX_TIM_TM2_data_t));
           packetUBXTIMTM2->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXTIMTM2->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXTIMTM2->automaticFlags.flags.bits.addToFileBuffer)
@@ -2546,6 +2618,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXESFALG->callbackData->iTOW, &packetUBXESFALG->data.iTOW, sizeof(UBX_ESF_ALG_data_t));
           packetUBXESFALG->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXESFALG->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXESFALG->automaticFlags.flags.bits.addToFileBuffer)
@@ -2578,6 +2652,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXESFINS->callbackData->bitfield0.all, &packetUBXESFINS->data.bitfield0.all, sizeof(UBX_ESF_INS_data_t));
           packetUBXESFINS->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXESFINS->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXESFINS->automaticFlags.flags.bits.addToFileBuffer)
@@ -2612,6 +2688,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXESFMEAS->callbackData->timeTag, &packetUBXESFMEAS->data.timeTag, sizeof(UBX_ESF_MEAS_data_t));
           packetUBXESFMEAS->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXESFMEAS->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXESFMEAS->automaticFlags.flags.bits.addToFileBuffer)
@@ -2641,6 +2719,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXESFRAW->callbackData->data[0].data.all, &packetUBXESFRAW->data.data[0].data.all, sizeof(UBX_ESF_RAW_data_t));
           packetUBXESFRAW->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXESFRAW->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXESFRAW->automaticFlags.flags.bits.addToFileBuffer)
@@ -2677,6 +2757,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXESFSTATUS->callbackData->iTOW, &packetUBXESFSTATUS->data.iTOW, sizeof(UBX_ESF_STATUS_data_t));
           packetUBXESFSTATUS->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXESFSTATUS->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXESFSTATUS->automaticFlags.flags.bits.addToFileBuffer)
@@ -2726,6 +2808,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXHNRPVT->callbackData->iTOW, &packetUBXHNRPVT->data.iTOW, sizeof(UBX_HNR_PVT_data_t));
           packetUBXHNRPVT->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXHNRPVT->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXHNRPVT->automaticFlags.flags.bits.addToFileBuffer)
@@ -2758,6 +2842,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXHNRATT->callbackData->iTOW, &packetUBXHNRATT->data.iTOW, sizeof(UBX_HNR_ATT_data_t));
           packetUBXHNRATT->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXHNRATT->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXHNRATT->automaticFlags.flags.bits.addToFileBuffer)
@@ -2790,6 +2876,8 @@ void SFE_UBLOX_GNSS::processUBXpacket(ubxPacket *msg)
           memcpy(&packetUBXHNRINS->callbackData->bitfield0.all, &packetUBXHNRINS->data.bitfield0.all, sizeof(UBX_HNR_INS_data_t));
           packetUBXHNRINS->automaticFlags.flags.bits.callbackCopyValid = true;
         }
+        else if (packetUBXHNRINS->callbackData != NULL) // The previous copy is still waiting for checkCallbacks
+          linkStats.droppedCallbacks++;
 
         //Check if we need to copy the data into the file buffer
         if (packetUBXHNRINS->automaticFlags.flags.bits.addToFileBuffer)
@@ -3447,6 +3535,7 @@ void SFE_UBLOX_GNSS::checkCallbacks(void)
 {
   if (checkCallbacksReentrant == true) // Check for reentry (i.e. checkCallbacks has been called from inside a callback)
     return;
+  STAGE_TIMER(STAGE_CALLBACKS);
 
   checkCallbacksReentrant = true;
 
@@ -3769,13 +3858,17 @@ boolean SFE_UBLOX_GNSS::pushRawData(uint8_t *dataBytes, size_t numDataBytes, boo
 // Support for data logging
 
 //Set the file buffer size. This must be called _before_ .begin
-void SFE_UBLOX_GNSS::setFileBufferSize(uint16_t bufferSize)
+//The size is rounded down to a power of two, so positions in the buffer are a simple mask
+void SFE_UBLOX_GNSS::setFileBufferSize(uint32_t bufferSize)
 {
-  fileBufferSize = bufferSize;
+  uint32_t powerOfTwo = 1;
+  while (powerOfTwo <= bufferSize / 2)
+    powerOfTwo <<= 1;
+  fileBufferSize = (bufferSize == 0) ? 0 : powerOfTwo;
 }
 
 //Return the file buffer size
-uint16_t SFE_UBLOX_GNSS::getFileBufferSize(void)
+uint32_t SFE_UBLOX_GNSS::getFileBufferSize(void)
 {
   return (fileBufferSize);
 }
@@ -3783,45 +3876,57 @@ uint16_t SFE_UBLOX_GNSS::getFileBufferSize(void)
 // Extract numBytes of data from the file buffer. Copy it to destination.
 // It is the user's responsibility to ensure destination is large enough.
 // Returns the number of bytes extracted - which may be less than numBytes.
-uint16_t SFE_UBLOX_GNSS::extractFileBufferData(uint8_t *destination, uint16_t numBytes)
+uint32_t SFE_UBLOX_GNSS::extractFileBufferData(uint8_t *destination, uint32_t numBytes)
 {
-  // Check how many bytes are available in the buffer
-  uint16_t bytesAvailable = fileBufferSpaceUsed();
-  if (numBytes > bytesAvailable) // Limit numBytes if required
-    numBytes = bytesAvailable;
-
-  // Start copying at fileBufferTail. Wrap-around if required.
-  uint16_t bytesBeforeWrapAround = fileBufferSize - fileBufferTail; // How much space is available 'above' Tail?
-  if (bytesBeforeWrapAround > numBytes) // Will we need to wrap-around?
+  uint32_t bytesExtracted = 0;
+  const uint8_t *span;
+  uint32_t spanLength;
+  // At most two spans: up to the end of the buffer, then from its start
+  while ((bytesExtracted < numBytes) && ((spanLength = getFileBufferSpan(&span)) > 0))
   {
-    bytesBeforeWrapAround = numBytes; // We need to wrap-around
+    if (spanLength > numBytes - bytesExtracted)
+      spanLength = numBytes - bytesExtracted;
+    memcpy(&destination[bytesExtracted], span, spanLength);
+    consumeFileBufferData(spanLength);
+    bytesExtracted += spanLength;
   }
-  memcpy(destination, &ubxFileBuffer[fileBufferTail], bytesBeforeWrapAround); // Copy the data out of the buffer
+  return (bytesExtracted); // Return the number of bytes extracted
+}
 
-  // Is there any data leftover which we need to copy from the 'bottom' of the buffer?
-  uint16_t bytesLeftToCopy = numBytes - bytesBeforeWrapAround; // Calculate if there are any bytes left to copy
-  if (bytesLeftToCopy > 0) // If there are bytes left to copy
-  {
-    memcpy(&destination[bytesBeforeWrapAround], &ubxFileBuffer[0], bytesLeftToCopy); // Copy the remaining data out of the buffer
-    fileBufferTail = bytesLeftToCopy; // Update Tail. The next byte to be read will be read from here.
-  }
-  else
-  {
-    fileBufferTail += numBytes; // Only update Tail. The next byte to be read will be read from here.
-  }
+// Point span at the oldest unread data and return how many bytes are contiguous there.
+// The data stays in the buffer, and its space stays in use, until consumeFileBufferData.
+uint32_t SFE_UBLOX_GNSS::getFileBufferSpan(const uint8_t **span)
+{
+  if ((ubxFileBuffer == NULL) || (fileBufferSize == 0))
+    return (0);
+  uint32_t tail = __atomic_load_n(&fileBufferTail, __ATOMIC_RELAXED); // Only the consumer writes tail
+  uint32_t head = __atomic_load_n(&fileBufferHead, __ATOMIC_ACQUIRE); // The data before head is complete
+  uint32_t position = tail & (fileBufferSize - 1);
+  uint32_t bytesBeforeWrapAround = fileBufferSize - position;
+  uint32_t bytesAvailable = head - tail;
+  *span = &ubxFileBuffer[position];
+  return ((bytesAvailable < bytesBeforeWrapAround) ? bytesAvailable : bytesBeforeWrapAround);
+}
 
-  return (numBytes); // Return the number of bytes extracted
+// Free numBytes of data at the start of the buffer for new packets
+void SFE_UBLOX_GNSS::consumeFileBufferData(uint32_t numBytes)
+{
+  uint32_t tail = __atomic_load_n(&fileBufferTail, __ATOMIC_RELAXED);
+  uint32_t bytesAvailable = __atomic_load_n(&fileBufferHead, __ATOMIC_ACQUIRE) - tail;
+  if (numBytes > bytesAvailable)
+    numBytes = bytesAvailable;
+  __atomic_store_n(&fileBufferTail, tail + numBytes, __ATOMIC_RELEASE); // Done reading the data before the new tail
 }
 
 // Returns the number of bytes available in file buffer which are waiting to be read
-uint16_t SFE_UBLOX_GNSS::fileBufferAvailable(void)
+uint32_t SFE_UBLOX_GNSS::fileBufferAvailable(void)
 {
   return (fileBufferSpaceUsed());
 }
 
 // Returns the maximum number of bytes which the file buffer contained.
 // Handy for checking the buffer is large enough to handle all the incoming data.
-uint16_t SFE_UBLOX_GNSS::getMaxFileBufferAvail(void)
+uint32_t SFE_UBLOX_GNSS::getMaxFileBufferAvail(void)
 {
   return (fileBufferMaxAvail);
 }
@@ -3831,7 +3936,7 @@ void SFE_UBLOX_GNSS::clearFileBuffer(void)
 {
   if (fileBufferSize == 0) // Bail if the user has not called setFileBufferSize (probably redundant)
     return;
-  fileBufferTail = fileBufferHead;
+  __atomic_store_n(&fileBufferTail, __atomic_load_n(&fileBufferHead, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
 }
 
 // Reset fileBufferMaxAvail
@@ -3840,6 +3945,41 @@ void SFE_UBLOX_GNSS::clearMaxFileBufferAvail(void)
   fileBufferMaxAvail = 0;
 }
 
+// Returns the number of packets which were discarded because the file buffer was full
+uint32_t SFE_UBLOX_GNSS::getFileBufferDropped(void)
+{
+  return (fileBufferDropped);
+}
+
+// Reset all the link and parser statistics
+void SFE_UBLOX_GNSS::clearLinkStats(void)
+{
+  memset(&linkStats, 0, sizeof(linkStats));
+}
+
+// PRIVATE: Count a valid UBX frame. The message types get a table entry each until the table is full
+void SFE_UBLOX_GNSS::countUBXmessage(uint8_t cls, uint8_t id)
+{
+  linkStats.ubxFrames++;
+  for (uint8_t i = 0; i < linkStats.messageTypes; i++)
+  {
+    if ((linkStats.messages[i].cls == cls) && (linkStats.messages[i].id == id))
+    {
+      linkStats.messages[i].count++;
+      return;
+    }
+  }
+  if (linkStats.messageTypes < SFE_UBLOX_LINK_STATS_MESSAGES)
+  {
+    sfe_ublox_message_count_t &message = linkStats.messages[linkStats.messageTypes++];
+    message.cls = cls;
+    message.id = id;
+    message.count = 1;
+  }
+  else
+    linkStats.otherMessages++;
+}
+
 // PRIVATE: Create the file buffer. Called by .begin
 boolean SFE_UBLOX_GNSS::createFileBuffer(void)
 {
@@ -3891,24 +4031,16 @@ boolean SFE_UBLOX_GNSS::createFileBuffer(void)
 }
 
 // PRIVATE: Check how much space is available in the buffer
-uint16_t SFE_UBLOX_GNSS::fileBufferSpaceAvailable(void)
+uint32_t SFE_UBLOX_GNSS::fileBufferSpaceAvailable(void)
 {
   return (fileBufferSize - fileBufferSpaceUsed());
 }
 
 // PRIVATE: Check how much space is used in the buffer
-uint16_t SFE_UBLOX_GNSS::fileBufferSpaceUsed(void)
+uint32_t SFE_UBLOX_GNSS::fileBufferSpaceUsed(void)
 {
-  if (fileBufferHead >= fileBufferTail) // Check if wrap-around has occurred
-  {
-    // Wrap-around has not occurred so do a simple subtraction
-    return (fileBufferHead - fileBufferTail);
-  }
-  else
-  {
-    // Wrap-around has occurred so do a simple subtraction but add in the fileBufferSize
-    return ((uint16_t)(((uint32_t)fileBufferHead + (uint32_t)fileBufferSize) - (uint32_t)fileBufferTail));
-  }
+  // The indices run freely and wrap at 2^32, so the difference is always the fill
+  return (__atomic_load_n(&fileBufferHead, __ATOMIC_ACQUIRE) - __atomic_load_n(&fileBufferTail, __ATOMIC_ACQUIRE));
 }
 
 // PRIVATE: Add a UBX packet to the file buffer
@@ -3927,36 +4059,41 @@ boolean SFE_UBLOX_GNSS::storePacket(ubxPacket *msg)
   }
 
   // Now, check if there is enough space in the buffer for all of the data
-  uint16_t totalLength = msg->len + 8; // Total length. Include sync chars, class, id, length and checksum bytes
+  uint32_t totalLength = (uint32_t)msg->len + 8; // Total length. Include sync chars, class, id, length and checksum bytes
   if (totalLength > fileBufferSpaceAvailable())
   {
     if ((_printDebug == true) || (_printLimitedDebug == true)) // This is important. Print this if doing limited debugging
     {
       _debugSerial->println(F("storePacket: insufficient space available! Data will be lost!"));
     }
+    fileBufferDropped++;
     return(false);
   }
 
   //Store the two sync chars
   uint8_t sync_chars[] = {0xB5, 0x62};
-  writeToFileBuffer(sync_chars, 2);
+  uint32_t head = __atomic_load_n(&fileBufferHead, __ATOMIC_RELAXED); // Only the producer writes head
+  head = writeToFileBuffer(head, sync_chars, 2);
 
   //Store the Class & ID
-  writeToFileBuffer(&msg->cls, 1);
-  writeToFileBuffer(&msg->id, 1);
+  head = writeToFileBuffer(head, &msg->cls, 1);
+  head = writeToFileBuffer(head, &msg->id, 1);
 
   //Store the length. Ensure length is little-endian
   uint8_t msg_length[2];
   msg_length[0] = msg->len & 0xFF;
   msg_length[1] = msg->len >> 8;
-  writeToFileBuffer(msg_length, 2);
+  head = writeToFileBuffer(head, msg_length, 2);
 
   //Store the payload
-  writeToFileBuffer(msg->payload, msg->len);
+  head = writeToFileBuffer(head, msg->payload, msg->len);
 
   //Store the checksum
-  writeToFileBuffer(&msg->checksumA, 1);
-  writeToFileBuffer(&msg->checksumB, 1);
+  head = writeToFileBuffer(head, &msg->checksumA, 1);
+  head = writeToFileBuffer(head, &msg->checksumB, 1);
+
+  //Make the whole packet visible to the consumer at once
+  publishFileBuffer(head);
 
   return (true);
 }
@@ -3983,40 +4120,44 @@ boolean SFE_UBLOX_GNSS::storeFileBytes(uint8_t *theBytes, uint16_t numBytes)
     {
       _debugSerial->println(F("storeFileBytes: insufficient space available! Data will be lost!"));
     }
+    fileBufferDropped++;
     return(false);
   }
 
   // There is room for all the data in the buffer so copy the data into the buffer
-  writeToFileBuffer(theBytes, numBytes);
+  publishFileBuffer(writeToFileBuffer(__atomic_load_n(&fileBufferHead, __ATOMIC_RELAXED), theBytes, numBytes));
 
   return (true);
 }
 
-// PRIVATE: Write theBytes to the file buffer
-void SFE_UBLOX_GNSS::writeToFileBuffer(uint8_t *theBytes, uint16_t numBytes)
+// PRIVATE: Write theBytes to the file buffer at head. Returns the head after them.
+// The consumer does not see them until publishFileBuffer.
+uint32_t SFE_UBLOX_GNSS::writeToFileBuffer(uint32_t head, const uint8_t *theBytes, uint16_t numBytes)
 {
-  // Start writing at fileBufferHead. Wrap-around if required.
-  uint16_t bytesBeforeWrapAround = fileBufferSize - fileBufferHead; // How much space is available 'above' Head?
+  // Start writing at head. Wrap-around if required.
+  uint32_t position = head & (fileBufferSize - 1);
+  uint32_t bytesBeforeWrapAround = fileBufferSize - position; // How much space is available 'above' Head?
   if (bytesBeforeWrapAround > numBytes) // Is there enough room for all the data?
   {
     bytesBeforeWrapAround = numBytes; // There is enough room for all the data
   }
-  memcpy(&ubxFileBuffer[fileBufferHead], theBytes, bytesBeforeWrapAround); // Copy the data into the buffer
+  memcpy(&ubxFileBuffer[position], theBytes, bytesBeforeWrapAround); // Copy the data into the buffer
 
   // Is there any data leftover which we need to copy to the 'bottom' of the buffer?
-  uint16_t bytesLeftToCopy = numBytes - bytesBeforeWrapAround; // Calculate if there are any bytes left to copy
-  if (bytesLeftToCopy > 0) // If there are bytes left to copy
-  {
-    memcpy(&ubxFileBuffer[0], &theBytes[bytesBeforeWrapAround], bytesLeftToCopy); // Copy the remaining data into the buffer
-    fileBufferHead = bytesLeftToCopy; // Update Head. The next byte written will be written here.
-  }
-  else
+  if (numBytes > bytesBeforeWrapAround)
   {
-    fileBufferHead += numBytes; // Only update Head. The next byte written will be written here.
+    memcpy(&ubxFileBuffer[0], &theBytes[bytesBeforeWrapAround], numBytes - bytesBeforeWrapAround); // Copy the remaining data into the buffer
   }
+  return (head + numBytes);
+}
+
+// PRIVATE: Hand everything written before head to the consumer
+void SFE_UBLOX_GNSS::publishFileBuffer(uint32_t head)
+{
+  __atomic_store_n(&fileBufferHead, head, __ATOMIC_RELEASE); // The data is written before head moves
 
   //Update fileBufferMaxAvail if required
-  uint16_t bytesInBuffer = fileBufferSpaceUsed();
+  uint32_t bytesInBuffer = head - __atomic_load_n(&fileBufferTail, __ATOMIC_ACQUIRE);
   if (bytesInBuffer > fileBufferMaxAvail)
     fileBufferMaxAvail = bytesInBuffer;
 }
@@ -521,6 +521,39 @@ struct ubxPacket
 	sfe_ublox_packet_validity_e classAndIDmatch; // Goes from NOT_DEFINED to VALID or NOT_VALID when the Class and ID match the requestedClass and requestedID
 };
 
+// Number of UBX message types counted one by one in sfe_ublox_link_stats_t, in the order they are first seen
+#define SFE_UBLOX_LINK_STATS_MESSAGES 16
+
+typedef struct
+{
+	uint8_t cls;
+	uint8_t id;
+	uint32_t count;
+} sfe_ublox_message_count_t;
+
+// Struct to hold the link and parser statistics (see getLinkStats). All counts are since begin or clearLinkStats
+typedef struct
+{
+	uint32_t bytesRead;			 // Bytes passed to process() from any port
+	uint32_t polls;				 // I2C reads of the bytes available registers
+	uint32_t emptyPolls;		 // ... that found no bytes waiting. Many of these mean i2cPollingWait is shorter than it needs to be
+	uint32_t busErrors;			 // I2C transactions the module did not ACK or answer
+	uint32_t notReadyRetries;	 // Reads that started with 0x7F (module not ready) and were retried
+	uint32_t lengthLsbFF;		 // Polls abandoned because the length LSB was 0xFF (u-blox bug?)
+	uint32_t lengthMsbSet;		 // Polls where bit 15 of bytes available was set and had to be cleared
+	uint32_t ubxFrames;			 // Complete UBX frames with a valid checksum
+	uint32_t nmeaSentences;		 // Complete NMEA sentences
+	uint32_t rtcmFrames;		 // Complete RTCM frames (the CRC is not checked)
+	uint32_t checksumFailures;	 // UBX frames with a bad checksum
+	uint32_t resyncs;			 // Frames abandoned after their start character because the next byte was wrong
+	uint32_t overruns;			 // UBX frames longer than their buffer and NMEA sentences longer than maxNMEAByteCount
+	uint32_t allocFailures;		 // Automatic messages that could not get RAM for their payload
+	uint32_t droppedCallbacks;	 // Automatic messages not handed to their callback because the previous one was still waiting for checkCallbacks
+	sfe_ublox_message_count_t messages[SFE_UBLOX_LINK_STATS_MESSAGES]; // Valid UBX frames per class and ID
+	uint8_t messageTypes;		 // Entries used in messages
+	uint32_t otherMessages;		 // Valid UBX frames of types that did not fit in messages
+} sfe_ublox_link_stats_t;
+
 // Struct to hold the results returned by getGeofenceState (returned by UBX-NAV-GEOFENCE)
 typedef struct
 {
@@ -673,13 +706,21 @@ public:
 	boolean pushRawData(uint8_t *dataBytes, size_t numDataBytes, boolean stop = false);
 
 	// Support for data logging
-	void setFileBufferSize(uint16_t bufferSize); // Set the size of the file buffer. This must be called _before_ .begin.
-	uint16_t getFileBufferSize(void); // Return the size of the file buffer
-	uint16_t extractFileBufferData(uint8_t *destination, uint16_t numBytes); // Extract numBytes of data from the file buffer. Copy it to destination. It is the user's responsibility to ensure destination is large enough.
-	uint16_t fileBufferAvailable(void);		// Returns the number of bytes available in file buffer which are waiting to be read
-	uint16_t getMaxFileBufferAvail(void);	// Returns the maximum number of bytes which the file buffer has contained. Handy for checking the buffer is large enough to handle all the incoming data.
+	// The file buffer is a single producer, single consumer ring: packets may be stored from an interrupt while the loop drains it.
+	void setFileBufferSize(uint32_t bufferSize); // Set the size of the file buffer, rounded down to a power of two. This must be called _before_ .begin.
+	uint32_t getFileBufferSize(void); // Return the size of the file buffer
+	uint32_t extractFileBufferData(uint8_t *destination, uint32_t numBytes); // Extract numBytes of data from the file buffer. Copy it to destination. It is the user's responsibility to ensure destination is large enough.
+	uint32_t getFileBufferSpan(const uint8_t **span); // Zero-copy read: point span at the oldest data and return the number of contiguous bytes there
+	void consumeFileBufferData(uint32_t numBytes); // Discard numBytes from the start of the file buffer, e.g. once a span has been written out
+	uint32_t fileBufferAvailable(void);		// Returns the number of bytes available in file buffer which are waiting to be read
+	uint32_t getMaxFileBufferAvail(void);	// Returns the maximum number of bytes which the file buffer has contained. Handy for checking the buffer is large enough to handle all the incoming data.
 	void clearFileBuffer(void);				// Empty the file buffer - discard all contents
 	void clearMaxFileBufferAvail(void);		// Reset fileBufferMaxAvail
+	uint32_t getFileBufferDropped(void);	// Returns the number of packets discarded because the file buffer was full
+
+	// Link and parser statistics: bytes, frames per message type, checksum failures, resyncs, I2C retries and errors...
+	const sfe_ublox_link_stats_t &getLinkStats(void) { return linkStats; } // The counters themselves, no copy
+	void clearLinkStats(void);				// Reset all counters to zero
 
 	// Specific commands
 
@@ -1380,16 +1421,24 @@ private:
 
 	// Support for data logging
 	uint8_t *ubxFileBuffer = NULL; // Pointer to the file buffer. RAM is allocated for this if required in .begin
-	uint16_t fileBufferSize = 0; // The size of the file buffer. This can be changed by calling setFileBufferSize _before_ .begin
-	uint16_t fileBufferHead; // The incoming byte is written into the file buffer at this location
-	uint16_t fileBufferTail; // The next byte to be read from the buffer will be read from this location
-	uint16_t fileBufferMaxAvail = 0; // The maximum number of bytes the file buffer has contained. Handy for checking the buffer is large enough to handle all the incoming data.
+	uint32_t fileBufferSize = 0; // The size of the file buffer, a power of two. This can be changed by calling setFileBufferSize _before_ .begin
+	// Head and tail run freely and wrap at 2^32: head - tail is the fill and index & (fileBufferSize - 1) the location.
+	// Only the producer (storePacket) writes head and only the consumer (extract/consume) writes tail, each with release ordering.
+	uint32_t fileBufferHead; // The incoming byte is written into the file buffer at this index
+	uint32_t fileBufferTail; // The next byte to be read from the buffer will be read from this index
+	uint32_t fileBufferMaxAvail = 0; // The maximum number of bytes the file buffer has contained. Handy for checking the buffer is large enough to handle all the incoming data.
+	uint32_t fileBufferDropped = 0; // The number of packets which did not fit in the file buffer
 	boolean createFileBuffer(void); // Create the file buffer. Called by .begin
-	uint16_t fileBufferSpaceAvailable(void); // Check how much space is available in the buffer
-	uint16_t fileBufferSpaceUsed(void); // Check how much space is used in the buffer
+	uint32_t fileBufferSpaceAvailable(void); // Check how much space is available in the buffer
+	uint32_t fileBufferSpaceUsed(void); // Check how much space is used in the buffer
 	boolean storePacket(ubxPacket *msg); // Add a UBX packet to the file buffer
 	boolean storeFileBytes(uint8_t *theBytes, uint16_t numBytes); // Add theBytes to the file buffer
-	void writeToFileBuffer(uint8_t *theBytes, uint16_t numBytes); // Write theBytes to the file buffer
+	uint32_t writeToFileBuffer(uint32_t head, const uint8_t *theBytes, uint16_t numBytes); // Write theBytes to the file buffer at head. Returns the new head
+	void publishFileBuffer(uint32_t head); // Make the bytes before head visible to the consumer
+
+	// Link and parser statistics
+	sfe_ublox_link_stats_t linkStats = {};
+	void countUBXmessage(uint8_t cls, uint8_t id); // Count a valid UBX frame in linkStats.messages
 };
 
 #endif
@@ -1,7 +1,12 @@
 #ifndef __bitmaps_h__
 #define __bitmaps_h__
 
-const unsigned char satBitmap[] PROGMEM = { //10x6
+#include <stdint.h>
+
+// Icons are authored as one byte per pixel (0x00 = off, anything else = on) below,
+// and packed to 1 bit per pixel at compile time for blitting (see the end of this file).
+
+constexpr unsigned char satBitmap[] PROGMEM = { //10x6
     0xff, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0xff,
     0xff, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff,
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
@@ -9,7 +14,7 @@ const unsigned char satBitmap[] PROGMEM = { //10x6
     0xff, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff,
     0xff, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0xff,
 };
-const unsigned char plusminus[] PROGMEM = { //5x7
+constexpr unsigned char plusminus[] PROGMEM = { //5x7
     0x00, 0x00, 0xff, 0x00, 0x00,
     0x00, 0x00, 0xff, 0x00, 0x00,
     0xff, 0xff, 0xff, 0xff, 0xff,
@@ -18,7 +23,7 @@ const unsigned char plusminus[] PROGMEM = { //5x7
     0x00, 0x00, 0x00, 0x00, 0x00,
     0xff, 0xff, 0xff, 0xff, 0xff
 };
-const unsigned char mountainBitmap[] PROGMEM = { //12x10
+constexpr unsigned char mountainBitmap[] PROGMEM = { //12x10
     0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -30,4 +35,38 @@ const unsigned char mountainBitmap[] PROGMEM = { //12x10
     0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
     0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff
 };
+
+// 1 bit per pixel, most significant bit first, each row padded to a whole byte
+template<int W, int H>
+struct PackedBitmap
+{
+  uint8_t width;
+  uint8_t height;
+  uint8_t bits[((W + 7) / 8) * H];
+};
+
+template<int... I> struct IndexList {};
+template<int N, int... I> struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+template<int... I> struct MakeIndexList<0, I...> { typedef IndexList<I...> type; };
+
+constexpr uint8_t packBitmapByte(const unsigned char* bitmap, int width, int y, int x, int bit)
+{
+  return bit == 8 ? 0 :
+    ((x + bit < width && bitmap[y * width + x + bit] > 0) ? (0x80 >> bit) : 0) | packBitmapByte(bitmap, width, y, x, bit + 1);
+}
+template<int W, int H, int... I>
+constexpr PackedBitmap<W, H> packBitmap(const unsigned char* bitmap, IndexList<I...>)
+{
+  return PackedBitmap<W, H> { W, H, { packBitmapByte(bitmap, W, I / ((W + 7) / 8), (I % ((W + 7) / 8)) * 8, 0)... } };
+}
+template<int W, int H>
+constexpr PackedBitmap<W, H> packBitmap(const unsigned char* bitmap)
+{
+  return packBitmap<W, H>(bitmap, typename MakeIndexList<((W + 7) / 8) * H>::type());
+}
+
+constexpr PackedBitmap<10, 6> satBitmapPacked PROGMEM = packBitmap<10, 6>(satBitmap);
+constexpr PackedBitmap<5, 7> plusminusPacked PROGMEM = packBitmap<5, 7>(plusminus);
+constexpr PackedBitmap<12, 10> mountainBitmapPacked PROGMEM = packBitmap<12, 10>(mountainBitmap);
+
 #endif
@@ -1,24 +1,141 @@
 #include "buttons.h"
+#include "eventqueue.h"
 #include <Arduino.h>
 
-void initButtons()
+#define BUTTON_COUNT 4
+
+// In getButtonState() priority order
+static const uint8_t buttonPins[BUTTON_COUNT] = { PIN_BUTTON_LEFT, PIN_BUTTON_RIGHT, PIN_BUTTON_UP, PIN_BUTTON_DOWN };
+static const uint8_t buttonKeys[BUTTON_COUNT] = { KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+
+static EventQueue<ButtonEvent, BUTTON_QUEUE_SIZE> buttonEvents;
+// One bit per button
+static volatile uint8_t pressedMask = 0;   // Debounced state
+static volatile uint8_t settlingMask = 0;  // Changed less than debounceTime ago
+static volatile uint8_t longPressMask = 0; // Long press already sent for the current press
+static volatile uint32_t edgeTime[BUTTON_COUNT];
+static volatile uint32_t pressTime[BUTTON_COUNT];
+static uint16_t debounceTime = BUTTON_DEBOUNCE_MS;
+static uint16_t longPressTime = BUTTON_LONG_PRESS_MS;
+uint32_t droppedButtonEvents = 0;
+
+static void queueEvent(uint8_t button, uint8_t type, uint32_t time)
+{
+  ButtonEvent event = { buttonKeys[button], type, time };
+  if(!buttonEvents.push(event))
+    droppedButtonEvents++;
+}
+
+// Runs in the interrupt handler, or in updateButtons() with interrupts disabled
+static void setPressed(uint8_t button, bool pressed, uint32_t time)
+{
+  uint8_t bit = 1 << button;
+  if(pressed == ((pressedMask & bit) != 0))
+    return;
+  if(pressed)
+  {
+    pressedMask |= bit;
+    longPressMask &= ~bit;
+    pressTime[button] = time;
+    queueEvent(button, BUTTON_PRESS, time);
+  }
+  else
+  {
+    pressedMask &= ~bit;
+    queueEvent(button, BUTTON_RELEASE, time);
+  }
+}
+
+static void onButtonEdge(uint8_t button)
+{
+  uint8_t bit = 1 << button;
+  if(settlingMask & bit)
+    return; // Bouncing. updateButtons() reads the pin once it has settled
+  uint32_t now = millis();
+  settlingMask |= bit;
+  edgeTime[button] = now;
+  setPressed(button, digitalRead(buttonPins[button]) == LOW, now);
+}
+
+static void onLeftEdge() { onButtonEdge(0); }
+static void onRightEdge() { onButtonEdge(1); }
+static void onUpEdge() { onButtonEdge(2); }
+static void onDownEdge() { onButtonEdge(3); }
+
+void initButtons(uint16_t debounceMs, uint16_t longPressMs)
 {
-  pinMode(PIN_BUTTON_UP, INPUT_PULLUP);
-  pinMode(PIN_BUTTON_DOWN, INPUT_PULLUP);
-  pinMode(PIN_BUTTON_LEFT, INPUT_PULLUP);
-  pinMode(PIN_BUTTON_RIGHT, INPUT_PULLUP);
+  debounceTime = debounceMs;
+  longPressTime = longPressMs;
+  static void (* const handlers[BUTTON_COUNT])() = { onLeftEdge, onRightEdge, onUpEdge, onDownEdge };
+  for(uint8_t i = 0; i < BUTTON_COUNT; i++)
+  {
+    pinMode(buttonPins[i], INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(buttonPins[i]), handlers[i], CHANGE);
+  }
 };
 
+void updateButtons()
+{
+  if(settlingMask == 0 && (pressedMask & ~longPressMask) == 0)
+    return;
+  uint32_t now = millis();
+  noInterrupts();
+  for(uint8_t i = 0; i < BUTTON_COUNT; i++)
+  {
+    uint8_t bit = 1 << i;
+    if((settlingMask & bit) && now - edgeTime[i] >= debounceTime)
+    {
+      // Edges during the settle time were ignored, so take whatever level the pin ended at
+      settlingMask &= ~bit;
+      setPressed(i, digitalRead(buttonPins[i]) == LOW, now);
+    }
+    if((pressedMask & bit) && !(longPressMask & bit) && now - pressTime[i] >= longPressTime)
+    {
+      longPressMask |= bit;
+      queueEvent(i, BUTTON_LONG_PRESS, now);
+    }
+  }
+  interrupts();
+}
+
+bool getButtonEvent(ButtonEvent &event)
+{
+  return buttonEvents.pop(event);
+}
+
+bool buttonsIdle()
+{
+  return buttonEvents.isEmpty();
+}
+
+bool nextButtonDeadline(uint32_t &time)
+{
+  bool found = false;
+  uint32_t now = millis();
+  noInterrupts();
+  for(uint8_t i = 0; i < BUTTON_COUNT; i++)
+  {
+    uint8_t bit = 1 << i;
+    uint32_t due;
+    if(settlingMask & bit)
+      due = edgeTime[i] + debounceTime;
+    else if((pressedMask & bit) && !(longPressMask & bit))
+      due = pressTime[i] + longPressTime;
+    else
+      continue;
+    if(!found || (int32_t)(due - now) < (int32_t)(time - now))
+      time = due;
+    found = true;
+  }
+  interrupts();
+  return found;
+}
+
 int getButtonState()
 {
-  if ( digitalRead(PIN_BUTTON_LEFT) == LOW )
-    return KEY_LEFT;
-  else if ( digitalRead(PIN_BUTTON_RIGHT) == LOW )
-    return KEY_RIGHT;
-  else if ( digitalRead(PIN_BUTTON_UP) == LOW )
-    return KEY_UP;
-  else if ( digitalRead(PIN_BUTTON_DOWN) == LOW )
-    return KEY_DOWN;
-  else
-    return KEY_NONE;
+  uint8_t pressed = pressedMask;
+  for(uint8_t i = 0; i < BUTTON_COUNT; i++)
+    if(pressed & (1 << i))
+      return buttonKeys[i];
+  return KEY_NONE;
 };
@@ -1,21 +1,56 @@
-
 #ifndef __buttons_h__
 #define __buttons_h__
 
-// Defines which pins the buttons are connected to
+#include <stdint.h>
+
+// Defines which pins the buttons are connected to.
+// Each pin needs its own external interrupt line (EXTINT 0, 2, 3 and 4 on the Feather M4).
 #define PIN_BUTTON_UP 9
 #define PIN_BUTTON_LEFT 10
 #define PIN_BUTTON_DOWN 6
 #define PIN_BUTTON_RIGHT 5
 
-// Values returned by getButtonState()
+// Values returned by getButtonState() and used in ButtonEvent::key
 #define KEY_NONE 0
 #define KEY_LEFT 1
 #define KEY_RIGHT 2
 #define KEY_UP 3
 #define KEY_DOWN 4
 
-void initButtons();
+// ButtonEvent::type
+#define BUTTON_PRESS 1
+#define BUTTON_RELEASE 2
+#define BUTTON_LONG_PRESS 3 // Button still held longPressMs after its press
+
+#define BUTTON_DEBOUNCE_MS 20
+#define BUTTON_LONG_PRESS_MS 1000
+#define BUTTON_QUEUE_SIZE 16
+
+struct ButtonEvent
+{
+  uint8_t key;
+  uint8_t type;
+  uint32_t time; // millis() when it happened
+};
+
+// Buttons are read by pin change interrupts, which queue press and release events as they
+// happen, so nothing is lost while loop() is blocked. An edge is taken right away and further
+// edges on that pin are ignored until the contact has settled for debounceMs.
+void initButtons(uint16_t debounceMs = BUTTON_DEBOUNCE_MS, uint16_t longPressMs = BUTTON_LONG_PRESS_MS);
+// Call from loop(). Finishes debouncing and queues long presses. Returns immediately
+// when no button is settling or held.
+void updateButtons();
+// Next queued event. Returns false if there is none.
+bool getButtonEvent(ButtonEvent &event);
+// True when no event is queued, so the CPU can sleep until the next button interrupt or
+// nextButtonDeadline()
+bool buttonsIdle();
+// When updateButtons() next has something to do: a button finished settling or a long press
+// became due. Returns false if nothing is pending.
+bool nextButtonDeadline(uint32_t &time);
+// Debounced state of the buttons, KEY_NONE if none is pressed
 int getButtonState();
 
+extern uint32_t droppedButtonEvents; // Events lost because the queue was full
+
 #endif
@@ -0,0 +1,111 @@
+#ifndef __compass_h__
+#define __compass_h__
+
+#include <Ucglib.h> //http://librarymanager/All#Ucglib
+#include "drawhelpers.h"
+
+// The N/E/S/W markers sit ~33px from the center, where one pixel is ~1.7 degrees.
+// Courses are quantised to that resolution and anything finer never causes a redraw.
+#define COMPASS_STEP_DEGREES 2
+#define COMPASS_STEPS (360 / COMPASS_STEP_DEGREES)
+
+// sin() of 0..90 degrees in COMPASS_STEP_DEGREES steps, Q14 fixed point (16384 = 1.0)
+const int16_t compassSinTable[COMPASS_STEPS / 4 + 1] PROGMEM = {
+  0, 572, 1143, 1713, 2280, 2845, 3406, 3964, 4516, 5063,
+  5604, 6138, 6664, 7182, 7692, 8192, 8682, 9162, 9630, 10087,
+  10531, 10963, 11381, 11786, 12176, 12551, 12911, 13255, 13583, 13894,
+  14189, 14466, 14726, 14968, 15191, 15396, 15582, 15749, 15897, 16026,
+  16135, 16225, 16294, 16344, 16374, 16384,
+};
+
+int16_t compassSin(uint16_t step)
+{
+  step %= COMPASS_STEPS;
+  const uint16_t quarter = COMPASS_STEPS / 4;
+  if(step <= quarter)
+    return compassSinTable[step];
+  if(step <= 2 * quarter)
+    return compassSinTable[2 * quarter - step];
+  if(step <= 3 * quarter)
+    return -compassSinTable[step - 2 * quarter];
+  return -compassSinTable[COMPASS_STEPS - step];
+}
+int16_t compassCos(uint16_t step) { return compassSin(step + COMPASS_STEPS / 4); }
+
+// Scale a Q14 value by an integer distance, rounded to the nearest pixel
+int16_t compassScale(int16_t q14, int16_t distance) { return ((int32_t)q14 * distance + 8192) >> 14; }
+
+// Compass ring with rotating N/E/S/W markers.
+// The ring and the markers are drawn once per page. After that a course change only
+// erases the previous markers and draws the new ones - nothing else on screen is touched.
+class CompassWidget
+{
+  public:
+    CompassWidget(int16_t cx, int16_t cy, int16_t radius) : _cx(cx), _cy(cy), _radius(radius) {};
+    void draw(bool newPage, float course);
+  private:
+    void drawMarkers(uint16_t step, bool erase);
+    int16_t _cx;
+    int16_t _cy;
+    int16_t _radius;
+    int16_t _step = -1; // Step the markers are drawn at. -1 when nothing is drawn
+    float _drawnCourse = 0; // Course the markers were last drawn for
+};
+
+void CompassWidget::drawMarkers(uint16_t step, bool erase)
+{
+  static const char* const labels[] = { "S", "E", "N", "W" };
+  int16_t const charoffset = _radius + 9;
+  ucg.setFont(ucg_font_helvR08_hr);
+  auto ascent = ucg.getFontAscent();
+  auto descent = ucg.getFontDescent();
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    uint16_t angle = step + i * COMPASS_STEPS / 4;
+    int16_t sn = compassSin(angle);
+    int16_t cn = compassCos(angle);
+    int16_t x = compassScale(sn, charoffset) + _cx;
+    int16_t y = compassScale(cn, charoffset) + _cy;
+    if(erase)
+    {
+      ucg.setColor(0, 0, 0);
+      auto width = ucg.getStrWidth(labels[i]);
+      ucg.drawBox(x - width / 2, y + ascent / 2 - ascent, width, ascent - descent);
+    }
+    else
+      ucg.setColor(255, 255, 255);
+    ucg.drawLine(compassScale(sn, _radius - 2) + _cx, compassScale(cn, _radius - 2) + _cy,
+                 compassScale(sn, _radius + 3) + _cx, compassScale(cn, _radius + 3) + _cy);
+    if(!erase)
+      drawStringCenterCenter(x, y, labels[i]);
+  }
+}
+
+void CompassWidget::draw(bool newPage, float course)
+{
+  if(newPage)
+    _step = -1;
+  else if(_step >= 0)
+  {
+    float diff = fabs(course - _drawnCourse);
+    if(diff > 180)
+      diff = 360 - diff;
+    if(diff < COMPASS_STEP_DEGREES)
+      return; // Jitter below the display's resolution
+  }
+  int16_t step = (int16_t)lroundf(course / COMPASS_STEP_DEGREES) % COMPASS_STEPS;
+  if(step < 0)
+    step += COMPASS_STEPS;
+  _drawnCourse = course;
+  if(step == _step)
+    return;
+  if(_step >= 0)
+    drawMarkers(_step, true);
+  // Erasing the ticks cuts into the ring, and it's cheaper to redraw it than to avoid that
+  ucg.setColor(255, 255, 255);
+  ucg.drawCircle(_cx, _cy, _radius, UCG_DRAW_ALL);
+  drawMarkers(step, false);
+  _step = step;
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef __displaydma_h__
+#define __displaydma_h__
+
+#include <Ucglib.h> //http://librarymanager/All#Ucglib
+#include "ssd1351.h"
+
+// Command queue for sending framebuffer updates to the SSD1351 with DMA.
+// Enable with DISPLAY_DMA (requires DISPLAY_FRAMEBUFFER).
+// The flush packs address windows and pixels into a RAM buffer and returns immediately. The DMA
+// controller clocks the buffer out to the panel while loop() keeps polling the receiver.
+// The panel's CD line must change between command and data bytes, which DMA can't do, so the
+// buffer is a list of segments that each have one CD level. The transfer complete interrupt
+// sets CD for the next segment and starts it, and clears the busy flag after the last one.
+// Pixels are copied into the buffer, so drawing can continue while a transfer is running.
+
+#define DISPLAY_DMA_BUFFER_SIZE 6144 // Holds at least four full-width rows of tiles
+#define DISPLAY_DMA_MAX_SEGMENTS 96  // Six per address window
+
+void dmaEngineBegin();
+void dmaEngineStart(const uint8_t *data, uint16_t length);
+void dmaEngineWaitIdle();
+
+class DisplayDmaQueue
+{
+  public:
+    // Room for an address window followed by 'pixels' pixels?
+    bool canQueueWindow(uint16_t pixels)
+    {
+      return !_busy && _segmentCount + 6 <= DISPLAY_DMA_MAX_SEGMENTS &&
+        _length + SSD1351_WINDOW_BYTES + (uint32_t)pixels * SSD1351_BYTES_PER_PIXEL <= DISPLAY_DMA_BUFFER_SIZE;
+    };
+    // Queue an address window and return where to put its pixels (3 bytes each)
+    uint8_t* queueWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint16_t pixels)
+    {
+      queueByte(0, SSD1351_SET_COLUMN);
+      queueByte(1, x0);
+      queueByte(1, x1);
+      queueByte(0, SSD1351_SET_ROW);
+      queueByte(1, y0);
+      queueByte(1, y1);
+      queueByte(0, SSD1351_WRITE_RAM);
+      uint8_t *out = &_buffer[_length];
+      beginSegment(1);
+      _length += pixels * SSD1351_BYTES_PER_PIXEL;
+      _segments[_segmentCount - 1].length += pixels * SSD1351_BYTES_PER_PIXEL;
+      return out;
+    };
+    // Start sending the queue. Returns immediately.
+    void start(ucg_t *ucg)
+    {
+      if(_busy || _segmentCount == 0)
+        return;
+      if(!_initialized)
+      {
+        dmaEngineBegin();
+        _initialized = true;
+      }
+      _ucg = ucg;
+      _busy = true;
+      _current = 0;
+      bytesQueued += _length;
+      ucg_com_SetCSLineStatus(_ucg, 0);
+      startSegment();
+    };
+    bool isBusy() { return _busy; };
+    // Block until the queue has been sent. Needed before anything else uses the SPI bus.
+    void wait()
+    {
+      while(_busy)
+        waitStep();
+    };
+    ucg_t* getUcg() { return _ucg; };
+
+    // Called from the DMA transfer complete interrupt
+    void onTransferComplete()
+    {
+      segmentsSent++;
+      if(++_current < _segmentCount)
+      {
+        dmaEngineWaitIdle(); // The last byte must be out of the shift register before CD changes
+        startSegment();
+        return;
+      }
+      dmaEngineWaitIdle();
+      ucg_com_SetCSLineStatus(_ucg, 1);
+      _segmentCount = 0;
+      _length = 0;
+      completedTransfers++;
+      _busy = false;
+    };
+
+    // Statistics since startup
+    uint32_t bytesQueued = 0;
+    uint32_t segmentsSent = 0;
+    uint32_t completedTransfers = 0;
+    uint32_t busyFlushes = 0; // Flushes that found the previous transfer still running
+
+  private:
+    struct Segment
+    {
+      uint16_t offset;
+      uint16_t length;
+      uint8_t cd;
+    };
+    void beginSegment(uint8_t cd)
+    {
+      Segment &segment = _segments[_segmentCount++];
+      segment.offset = _length;
+      segment.length = 0;
+      segment.cd = cd;
+    };
+    void queueByte(uint8_t cd, uint8_t value)
+    {
+      if(_segmentCount == 0 || _segments[_segmentCount - 1].cd != cd)
+        beginSegment(cd);
+      _buffer[_length++] = value;
+      _segments[_segmentCount - 1].length++;
+    };
+    void startSegment()
+    {
+      const Segment &segment = _segments[_current];
+      ucg_com_SetCDLineStatus(_ucg, segment.cd);
+      dmaEngineStart(&_buffer[segment.offset], segment.length);
+    };
+    void waitStep();
+
+    uint8_t _buffer[DISPLAY_DMA_BUFFER_SIZE];
+    Segment _segments[DISPLAY_DMA_MAX_SEGMENTS];
+    uint16_t _length = 0;
+    uint8_t _segmentCount = 0;
+    volatile uint8_t _current = 0;
+    volatile bool _busy = false;
+    bool _initialized = false;
+    ucg_t *_ucg = nullptr;
+};
+
+DisplayDmaQueue displayDma;
+
+#if defined(DISPLAY_DMA_MOCK)
+// Host stand-in for the DMA controller. Nothing moves until step() is called, so a test decides
+// how much bus time passes between other work. Bytes go to Ucglib's com layer one at a time,
+// which on the host build is the emulated panel.
+class MockDmaEngine
+{
+  public:
+    void start(const uint8_t *data, uint16_t length) { _data = data; _remaining = length; };
+    // Send up to maxBytes. Returns false once nothing is left to send.
+    bool step(uint16_t maxBytes)
+    {
+      while(_remaining > 0 && maxBytes-- > 0)
+      {
+        ucg_com_SendByte(displayDma.getUcg(), *_data++);
+        bytesSent++;
+        if(--_remaining == 0)
+          displayDma.onTransferComplete(); // May start the next segment
+      }
+      return _remaining > 0;
+    };
+    uint32_t bytesSent = 0;
+  private:
+    const uint8_t *_data = nullptr;
+    uint16_t _remaining = 0;
+};
+MockDmaEngine mockDma;
+
+void dmaEngineBegin() { }
+void dmaEngineStart(const uint8_t *data, uint16_t length) { mockDma.start(data, length); }
+void dmaEngineWaitIdle() { }
+void DisplayDmaQueue::waitStep() { mockDma.step(64); }
+
+#elif defined(__SAMD51__)
+#include <Adafruit_ZeroDMA.h> //http://librarymanager/All#Adafruit_ZeroDMA
+#include <SPI.h>
+
+// TX-only transfer to the SERCOM behind the SPI object Ucglib uses
+Adafruit_ZeroDMA displayDmaChannel;
+DmacDescriptor *displayDmaDescriptor = nullptr;
+
+void displayDmaCallback(Adafruit_ZeroDMA *) { displayDma.onTransferComplete(); }
+
+void dmaEngineBegin()
+{
+  displayDmaChannel.setTrigger(PERIPH_SPI.getDMAC_ID_TX());
+  displayDmaChannel.setAction(DMA_TRIGGER_ACTON_BEAT);
+  displayDmaChannel.allocate();
+  displayDmaDescriptor = displayDmaChannel.addDescriptor(nullptr, PERIPH_SPI.getDataRegister(), 0, DMA_BEAT_SIZE_BYTE, true, false);
+  displayDmaChannel.setCallback(displayDmaCallback);
+}
+void dmaEngineStart(const uint8_t *data, uint16_t length)
+{
+  displayDmaChannel.changeDescriptor(displayDmaDescriptor, (void*)data, nullptr, length);
+  displayDmaChannel.startJob();
+}
+void dmaEngineWaitIdle()
+{
+  while(!PERIPH_SPI.isTransmitCompleteSPI());
+}
+void DisplayDmaQueue::waitStep() { }
+
+#else
+#error "DISPLAY_DMA needs a SAMD51, or DISPLAY_DMA_MOCK on the host"
+#endif
+
+#endif
@@ -2,6 +2,9 @@
 #define __drawhelpers_h__
 
 #include <Ucglib.h> //http://librarymanager/All#Ucglib
+#include "bitmaps.h"
+#include "ssd1351.h"
+#include "format.h"
 
 int8_t getLineHeight()
 {
@@ -29,51 +32,35 @@ void drawStringCenterCenter(int x, int y, const char* text)
   ucg.print(text);
 }
 
-void drawString(int x, int y, String text, bool rightAlign)
-{
-   drawString(x,y, text.c_str(), rightAlign);
-}
-
-void drawString(int x, int y, String text)
-{
-   drawString(x,y, text, false);
-}
-
 void drawString(int x, int y, const char* text)
 {
   drawString(x,y,text,false);
 }
 
-void writepair(const String lefttext, const String righttext, const int row)
+void writepair(const char* lefttext, const char* righttext, const int row)
 {
   uint8_t y = row*getLineHeight() + 1;
   drawString(0, y, lefttext);  
   drawString(128, y, righttext, true);
 }
 
-void writepair(const String lefttext, const float righttext, const int decimals, const int row)
+void writepair(const char* lefttext, const float righttext, const int decimals, const int row)
 {
-  if(isnan(righttext))
-    writepair(lefttext, "---", row);
-  else
-    writepair(lefttext, String(righttext, decimals), row);
+  TextBuffer<16> text;
+  writepair(lefttext, text.appendMeasure(righttext, decimals, "").c_str(), row);
 }
 /*
-void writepair(const String lefttext, const float righttext, const String unit, const int decimals, const int row)
+void writepair(const char* lefttext, const float righttext, const char* unit, const int decimals, const int row)
 {
-  if(isnan(righttext))
-    writepair(lefttext, "---", row);
-  else
-    writepair(lefttext, String(righttext, decimals) + unit, row);
+  TextBuffer<16> text;
+  writepair(lefttext, text.appendMeasure(righttext, decimals, unit).c_str(), row);
 }
 */
-void writepair(const String lefttext, const float righttext, const int row)
+void writepair(const char* lefttext, const float righttext, const int row)
 {
-  if(isnan(righttext))
-    writepair(lefttext, "---", row);
-  else
-    writepair(lefttext, String(righttext), row);
+  writepair(lefttext, righttext, 2, row);
 }
+// Per-pixel reference implementation for byte-per-pixel bitmaps. Sends a full address window for every pixel.
 void drawBitmap(int ox, int oy, int width, int height, const unsigned char* bitmap, uint8_t r, uint8_t g, uint8_t b)
 {
   int count = 0;
@@ -89,4 +76,74 @@ void drawBitmap(int ox, int oy, int width, int height, const unsigned char* bitm
    }
 }
 
+#define BLIT_CHUNK_PIXELS 64
+
+// Draw a packed 1 bit per pixel bitmap with set bits in the given color and clear bits black.
+// Opens a single address window on the panel and streams all pixels in one burst.
+void blitBitmap(int ox, int oy, int width, int height, const uint8_t* bits, uint8_t r, uint8_t g, uint8_t b)
+{
+  if(ox < 0 || oy < 0 || ox + width > 128 || oy + height > 128)
+    return; // Blits are not clipped
+  uint8_t stride = (width + 7) / 8;
+#ifdef DISPLAY_FRAMEBUFFER
+  uint16_t color = rgb565(r, g, b);
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      displayFrameBuffer.setPixel(ox + x, oy + y, (bits[y * stride + x / 8] & (0x80 >> (x & 7))) ? color : 0);
+#else
+  uint8_t burst[BLIT_CHUNK_PIXELS * SSD1351_BYTES_PER_PIXEL];
+  uint16_t length = 0;
+  ucg_t *panel = ucg.getUcg();
+  ssd1351SetWindow(panel, ox, oy, ox + width - 1, oy + height - 1);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      bool set = bits[y * stride + x / 8] & (0x80 >> (x & 7));
+      burst[length++] = set ? r >> 2 : 0;
+      burst[length++] = set ? g >> 2 : 0;
+      burst[length++] = set ? b >> 2 : 0;
+      if(length == sizeof(burst)) {
+        ucg_com_SendString(panel, length, burst);
+        length = 0;
+      }
+    }
+  }
+  if(length > 0)
+    ucg_com_SendString(panel, length, burst);
+  ucg_com_SetCSLineStatus(panel, 1);
+#endif
+}
+
+template<int W, int H>
+void drawBitmap(int ox, int oy, const PackedBitmap<W, H>& bitmap, uint8_t r, uint8_t g, uint8_t b)
+{
+  blitBitmap(ox, oy, W, H, bitmap.bits, r, g, b);
+}
+
+#ifdef BENCHMARK_BITMAPS
+// Compare the per-pixel and blit paths for each icon on the target and print the time per draw
+void benchmarkBitmap(const char* name, int width, int height, const unsigned char* bitmap, const uint8_t* packed)
+{
+  const int iterations = 20;
+  auto t0 = micros();
+  for(int i = 0; i < iterations; i++)
+    drawBitmap(0, 20, width, height, bitmap, 255, 255, 255);
+  auto t1 = micros();
+  for(int i = 0; i < iterations; i++)
+    blitBitmap(0, 20, width, height, packed, 255, 255, 255);
+  auto t2 = micros();
+  Serial.print(name);
+  Serial.print(": per-pixel ");
+  Serial.print((t1 - t0) / iterations);
+  Serial.print("us, blit ");
+  Serial.print((t2 - t1) / iterations);
+  Serial.println("us");
+}
+void benchmarkBitmaps()
+{
+  benchmarkBitmap("satBitmap", 10, 6, satBitmap, satBitmapPacked.bits);
+  benchmarkBitmap("plusminus", 5, 7, plusminus, plusminusPacked.bits);
+  benchmarkBitmap("mountainBitmap", 12, 10, mountainBitmap, mountainBitmapPacked.bits);
+}
+#endif
+
 #endif
@@ -0,0 +1,337 @@
+#ifndef __epochlog_h__
+#define __epochlog_h__
+
+#include <stdint.h>
+#include <string.h>
+
+// Compact epoch log: one record per navigation epoch with the solution's integers, delta
+// encoded against the previous epoch.
+//
+// File: "EPL2", then records. Every record ends with a CRC-16 of its other bytes.
+// Keyframe record: EPOCH_TAG_KEYFRAME, then every field as an absolute value. One is written
+// every keyframeInterval epochs, so a reader can start decoding at any keyframe.
+// Delta record: a tag byte with the EPOCH_CHANGED_* bits of the slow fields that changed,
+// then the differences of the fast fields from the previous epoch, then the changed slow
+// fields. Time is stored as the change of its difference, which is 0 at a steady rate.
+// Numbers are varints, 7 bits per byte with the high bit set on all but the last. Signed
+// numbers are zigzag mapped first (0, -1, 1, -2... become 0, 1, 2, 3...), so small
+// differences of either sign take one or two bytes.
+//
+// The CRC lets a reader throw out a damaged record. The records after it depend on it, so the
+// reader then skips ahead to the next keyframe. A damaged byte can move where the varints
+// end and with it the bytes taken for the CRC, which a CRC-8 then passes one time in 256.
+// The CRC starts from all ones, so zeroed bytes don't pass.
+//
+// Fast fields, in order: iTOW, lat, lon, height, hMSL, hAcc, vAcc.
+// Slow fields, in order: fixType, carrSoln, numSV, date (year, month, day), flags.
+// A static survey epoch is around 11 bytes, 2 of them the CRC, against 144 for the PVT and
+// HPPOSLLH frames (tools/host/epochroundtrip.cpp).
+
+#define EPOCH_LOG_MAGIC "EPL2"
+#define EPOCH_LOG_MAGIC_LENGTH 4
+#define EPOCH_TAG_KEYFRAME 0xE5
+#define EPOCH_RECORD_MAX 96 // Longest possible record
+#ifndef EPOCH_KEYFRAME_INTERVAL
+#define EPOCH_KEYFRAME_INTERVAL 60
+#endif
+
+#define EPOCH_CHANGED_FIX 0x01
+#define EPOCH_CHANGED_CARRSOLN 0x02
+#define EPOCH_CHANGED_NUMSV 0x04
+#define EPOCH_CHANGED_DATE 0x08
+#define EPOCH_CHANGED_FLAGS 0x10
+#define EPOCH_CHANGED_ALL 0x1F
+
+#define EPOCH_FLAG_FIX_OK 0x01
+#define EPOCH_FLAG_HIGH_PRECISION 0x02 // Position and accuracy from HPPOSLLH, otherwise from PVT
+
+struct EpochRecord
+{
+  uint32_t iTOW;    // ms
+  int64_t lat;      // 1e-9 degrees
+  int64_t lon;      // 1e-9 degrees
+  int64_t height;   // Above the ellipsoid, 0.1mm
+  int64_t hMSL;     // Above mean sea level, 0.1mm
+  uint32_t hAcc;    // 0.1mm
+  uint32_t vAcc;    // 0.1mm
+  uint8_t fixType;
+  uint8_t carrSoln;
+  uint8_t numSV;
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t flags;    // EPOCH_FLAG_*
+};
+
+// CRC-16 with polynomial 0x1021 (CCITT) from 0xFFFF. Bitwise, as a record is only a few bytes
+// once a second.
+static inline uint16_t epochCrc16(const uint8_t *data, size_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for(size_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for(uint8_t bit = 0; bit < 8; bit++)
+      crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+static inline uint8_t *epochPutVarint(uint8_t *out, uint64_t value)
+{
+  while(value >= 0x80)
+  {
+    *out++ = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+  return out;
+}
+static inline uint8_t *epochPutSigned(uint8_t *out, int64_t value)
+{
+  return epochPutVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+static inline bool epochGetVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value)
+{
+  value = 0;
+  for(uint8_t shift = 0; shift < 64; shift += 7)
+  {
+    if(in == end)
+      return false;
+    uint8_t b = *in++;
+    value |= (uint64_t)(b & 0x7F) << shift;
+    if(!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+static inline bool epochGetSigned(const uint8_t *&in, const uint8_t *end, int64_t &value)
+{
+  uint64_t zigzag;
+  if(!epochGetVarint(in, end, zigzag))
+    return false;
+  value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  return true;
+}
+
+static inline uint8_t epochChanges(const EpochRecord &a, const EpochRecord &b)
+{
+  uint8_t changed = 0;
+  if(a.fixType != b.fixType)
+    changed |= EPOCH_CHANGED_FIX;
+  if(a.carrSoln != b.carrSoln)
+    changed |= EPOCH_CHANGED_CARRSOLN;
+  if(a.numSV != b.numSV)
+    changed |= EPOCH_CHANGED_NUMSV;
+  if(a.year != b.year || a.month != b.month || a.day != b.day)
+    changed |= EPOCH_CHANGED_DATE;
+  if(a.flags != b.flags)
+    changed |= EPOCH_CHANGED_FLAGS;
+  return changed;
+}
+
+class EpochEncoder
+{
+  public:
+    EpochEncoder(uint16_t keyframeInterval = EPOCH_KEYFRAME_INTERVAL) : _keyframeInterval(keyframeInterval) {};
+
+    // Encodes r into out, which must have room for EPOCH_RECORD_MAX bytes. Returns the length.
+    uint8_t encode(const EpochRecord &r, uint8_t *out)
+    {
+      uint8_t *p = out;
+      if(_sinceKeyframe == 0)
+      {
+        *p++ = EPOCH_TAG_KEYFRAME;
+        p = epochPutVarint(p, r.iTOW);
+        p = epochPutSigned(p, r.lat);
+        p = epochPutSigned(p, r.lon);
+        p = epochPutSigned(p, r.height);
+        p = epochPutSigned(p, r.hMSL);
+        p = epochPutVarint(p, r.hAcc);
+        p = epochPutVarint(p, r.vAcc);
+        p = putSlowFields(p, r, EPOCH_CHANGED_ALL);
+        _timeDelta = 0;
+        keyframes++;
+      }
+      else
+      {
+        uint8_t changed = epochChanges(r, _last);
+        *p++ = changed;
+        int64_t timeDelta = (int64_t)r.iTOW - _last.iTOW;
+        p = epochPutSigned(p, timeDelta - _timeDelta);
+        _timeDelta = timeDelta;
+        p = epochPutSigned(p, r.lat - _last.lat);
+        p = epochPutSigned(p, r.lon - _last.lon);
+        p = epochPutSigned(p, r.height - _last.height);
+        p = epochPutSigned(p, r.hMSL - _last.hMSL);
+        p = epochPutSigned(p, (int64_t)r.hAcc - _last.hAcc);
+        p = epochPutSigned(p, (int64_t)r.vAcc - _last.vAcc);
+        p = putSlowFields(p, r, changed);
+      }
+      p = putCrc(out, p);
+      _last = r;
+      if(++_sinceKeyframe >= _keyframeInterval)
+        _sinceKeyframe = 0;
+      epochs++;
+      return p - out;
+    };
+    // Make the next record a keyframe, e.g. after data was lost
+    void forceKeyframe() { _sinceKeyframe = 0; };
+
+    uint32_t epochs = 0;
+    uint32_t keyframes = 0;
+
+  private:
+    // Appends the CRC of the record from out to p, little-endian
+    static uint8_t *putCrc(uint8_t *out, uint8_t *p)
+    {
+      uint16_t crc = epochCrc16(out, p - out);
+      *p++ = crc & 0xFF;
+      *p++ = crc >> 8;
+      return p;
+    };
+    uint8_t *putSlowFields(uint8_t *p, const EpochRecord &r, uint8_t changed)
+    {
+      if(changed & EPOCH_CHANGED_FIX)
+        *p++ = r.fixType;
+      if(changed & EPOCH_CHANGED_CARRSOLN)
+        *p++ = r.carrSoln;
+      if(changed & EPOCH_CHANGED_NUMSV)
+        *p++ = r.numSV;
+      if(changed & EPOCH_CHANGED_DATE)
+      {
+        p = epochPutVarint(p, r.year);
+        *p++ = r.month;
+        *p++ = r.day;
+      }
+      if(changed & EPOCH_CHANGED_FLAGS)
+        *p++ = r.flags;
+      return p;
+    };
+    EpochRecord _last = EpochRecord();
+    int64_t _timeDelta = 0;
+    uint16_t _keyframeInterval;
+    uint16_t _sinceKeyframe = 0;
+};
+
+// Reverses EpochEncoder. Records before the first keyframe can't be decoded and are reported
+// as errors. So are the records after one that failed its CRC, up to the next keyframe.
+class EpochDecoder
+{
+  public:
+    // Decode only keyframes until the next one, e.g. to skip damaged data
+    void reset() { _synced = false; };
+    // True if data starts with the file header
+    static bool isEpochLog(const uint8_t *data, size_t length)
+    {
+      return length >= EPOCH_LOG_MAGIC_LENGTH && memcmp(data, EPOCH_LOG_MAGIC, EPOCH_LOG_MAGIC_LENGTH) == 0;
+    };
+    // Decodes the record at in and moves in past it. Returns false at a truncated or invalid
+    // record, with in unchanged. After an invalid one only a keyframe is decoded next.
+    bool decode(const uint8_t *&in, const uint8_t *end, EpochRecord &r)
+    {
+      const uint8_t *p = in;
+      if(p == end)
+        return false;
+      uint8_t tag = *p++;
+      EpochRecord next = _last;
+      int64_t timeDelta = 0;
+      uint64_t u;
+      int64_t d;
+      if(tag == EPOCH_TAG_KEYFRAME)
+      {
+        if(!epochGetVarint(p, end, u))
+          return false;
+        next.iTOW = (uint32_t)u;
+        if(!epochGetSigned(p, end, next.lat) || !epochGetSigned(p, end, next.lon) ||
+          !epochGetSigned(p, end, next.height) || !epochGetSigned(p, end, next.hMSL))
+          return false;
+        if(!epochGetVarint(p, end, u))
+          return false;
+        next.hAcc = (uint32_t)u;
+        if(!epochGetVarint(p, end, u))
+          return false;
+        next.vAcc = (uint32_t)u;
+        if(!getSlowFields(p, end, next, EPOCH_CHANGED_ALL))
+          return false;
+      }
+      else if(tag <= EPOCH_CHANGED_ALL && _synced)
+      {
+        if(!epochGetSigned(p, end, d))
+          return false;
+        timeDelta = _timeDelta + d;
+        next.iTOW = (uint32_t)(_last.iTOW + timeDelta);
+        int64_t lat, lon, height, hMSL, hAcc, vAcc;
+        if(!epochGetSigned(p, end, lat) || !epochGetSigned(p, end, lon) ||
+          !epochGetSigned(p, end, height) || !epochGetSigned(p, end, hMSL) ||
+          !epochGetSigned(p, end, hAcc) || !epochGetSigned(p, end, vAcc))
+          return false;
+        next.lat += lat;
+        next.lon += lon;
+        next.height += height;
+        next.hMSL += hMSL;
+        next.hAcc = (uint32_t)(next.hAcc + hAcc);
+        next.vAcc = (uint32_t)(next.vAcc + vAcc);
+        if(!getSlowFields(p, end, next, tag))
+          return false;
+      }
+      else
+      {
+        _synced = false;
+        return false;
+      }
+      if(!checkCrc(in, p, end))
+        return false;
+      _timeDelta = timeDelta;
+      _synced = true;
+      _last = next;
+      r = next;
+      in = p;
+      return true;
+    };
+
+  private:
+    static bool getByte(const uint8_t *&p, const uint8_t *end, uint8_t &value)
+    {
+      if(p == end)
+        return false;
+      value = *p++;
+      return true;
+    };
+    // Reads the CRC at p of the record from in to p. Drops the sync if it doesn't match.
+    bool checkCrc(const uint8_t *in, const uint8_t *&p, const uint8_t *end)
+    {
+      size_t length = p - in;
+      uint8_t low, high;
+      if(!getByte(p, end, low) || !getByte(p, end, high))
+        return false;
+      if((low | (high << 8)) == epochCrc16(in, length))
+        return true;
+      _synced = false;
+      return false;
+    };
+    bool getSlowFields(const uint8_t *&p, const uint8_t *end, EpochRecord &r, uint8_t changed)
+    {
+      if((changed & EPOCH_CHANGED_FIX) && !getByte(p, end, r.fixType))
+        return false;
+      if((changed & EPOCH_CHANGED_CARRSOLN) && !getByte(p, end, r.carrSoln))
+        return false;
+      if((changed & EPOCH_CHANGED_NUMSV) && !getByte(p, end, r.numSV))
+        return false;
+      if(changed & EPOCH_CHANGED_DATE)
+      {
+        uint64_t year;
+        if(!epochGetVarint(p, end, year) || !getByte(p, end, r.month) || !getByte(p, end, r.day))
+          return false;
+        r.year = (uint16_t)year;
+      }
+      if((changed & EPOCH_CHANGED_FLAGS) && !getByte(p, end, r.flags))
+        return false;
+      return true;
+    };
+    EpochRecord _last = EpochRecord();
+    int64_t _timeDelta = 0;
+    bool _synced = false;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __eventqueue_h__
+#define __eventqueue_h__
+
+#include <stdint.h>
+
+// Fixed-size ring buffer for one producer and one consumer, typically an interrupt handler
+// feeding loop(). Neither side ever blocks or disables interrupts. When the queue is full
+// push() fails and the event is dropped, so the producer decides what to count or log.
+// A second producer is fine as long as its pushes can't interleave with the first one's,
+// e.g. because it runs with interrupts disabled.
+//
+// Head and tail run freely and wrap at 256. N must be a power of two, at most 128.
+template <typename T, uint8_t N>
+class EventQueue
+{
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "EventQueue size must be a power of two up to 128");
+  public:
+    EventQueue() : _head(0), _tail(0) {}
+
+    // Producer side. Returns false if the queue is full.
+    bool push(const T& event)
+    {
+      uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+      if ((uint8_t)(head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) == N)
+        return false;
+      _items[head & (N - 1)] = event;
+      __atomic_store_n(&_head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool pop(T& event)
+    {
+      uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+      if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+        return false;
+      event = _items[tail & (N - 1)];
+      __atomic_store_n(&_tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+    bool isEmpty() const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) == __atomic_load_n(&_tail, __ATOMIC_RELAXED); }
+
+  private:
+    T _items[N];
+    uint8_t _head;
+    uint8_t _tail;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef __format_h__
+#define __format_h__
+
+#include <Arduino.h>
+
+// Fixed-size text buffer for building display strings on the stack.
+// Replaces Arduino String concatenation in the render path: it never touches the heap,
+// and anything that doesn't fit is silently truncated.
+//
+//   TextBuffer<16> text;
+//   text.appendFloat(err, 2).append('m');
+//   drawString(0, y, text.c_str());
+template<uint8_t N>
+class TextBuffer
+{
+  public:
+    TextBuffer() { clear(); };
+    TextBuffer(const char* text) { clear(); append(text); };
+    TextBuffer& clear() { _length = 0; _text[0] = 0; return *this; };
+    const char* c_str() const { return _text; };
+    uint8_t length() const { return _length; };
+
+    TextBuffer& append(char c)
+    {
+      if(_length < N - 1)
+      {
+        _text[_length++] = c;
+        _text[_length] = 0;
+      }
+      return *this;
+    };
+    TextBuffer& append(const char* text)
+    {
+      while(*text)
+        append(*text++);
+      return *this;
+    };
+    TextBuffer& appendInt(int32_t value)
+    {
+      if(value < 0)
+      {
+        append('-');
+        return appendUInt(-(uint32_t)value, 1);
+      }
+      return appendUInt(value, 1);
+    };
+    // Unsigned integer, zero-padded to at least minDigits
+    TextBuffer& appendUInt(uint32_t value, uint8_t minDigits)
+    {
+      char digits[10];
+      uint8_t count = 0;
+      do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+      } while(value > 0);
+      for(uint8_t i = count; i < minDigits; i++)
+        append('0');
+      while(count > 0)
+        append(digits[--count]);
+      return *this;
+    };
+    // Fixed-point decimal with the given number of decimals, rounded like String(value, decimals)
+    TextBuffer& appendFloat(double value, uint8_t decimals)
+    {
+      if(isnan(value))
+        return append("nan");
+      if(value < 0)
+      {
+        append('-');
+        value = -value;
+      }
+      double rounding = 0.5;
+      for(uint8_t i = 0; i < decimals; i++)
+        rounding /= 10.0;
+      value += rounding;
+      uint32_t integer = (uint32_t)value;
+      appendUInt(integer, 1);
+      if(decimals > 0)
+        append('.');
+      double remainder = value - integer;
+      while(decimals-- > 0)
+      {
+        remainder *= 10.0;
+        uint8_t digit = (uint8_t)remainder;
+        append('0' + digit);
+        remainder -= digit;
+      }
+      return *this;
+    };
+    // Value with a unit suffix, or "---" if the value isn't known
+    TextBuffer& appendMeasure(double value, uint8_t decimals, const char* unit)
+    {
+      if(isnan(value))
+        return append("---");
+      return appendFloat(value, decimals).append(unit);
+    };
+    // H:MM:SS
+    TextBuffer& appendTime(uint8_t hour, uint8_t minute, uint8_t second)
+    {
+      appendUInt(hour, 1).append(':');
+      appendUInt(minute, 2).append(':');
+      return appendUInt(second, 2);
+    };
+
+  private:
+    char _text[N];
+    uint8_t _length;
+};
+
+#endif
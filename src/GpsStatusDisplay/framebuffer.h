@@ -0,0 +1,213 @@
+#ifndef __framebuffer_h__
+#define __framebuffer_h__
+
+#include <Ucglib.h> //http://librarymanager/All#Ucglib
+#include "ssd1351.h"
+#ifdef DISPLAY_DMA
+#include "displaydma.h"
+#endif
+
+// Shadow framebuffer for the 128x128 SSD1351 OLED.
+// Ucglib renders into RAM instead of the panel. Pixels that are written with the color they
+// already have are not marked dirty, so redrawing unchanged text costs no SPI traffic at all.
+// flush() merges the dirty 4x4 tiles into rectangles and sends each one using the
+// controller's column/row address window.
+// With DISPLAY_DMA the rectangles are queued for DMA instead, see displaydma.h.
+
+#define FB_WIDTH 128
+#define FB_HEIGHT 128
+#define FB_TILE_SIZE 4
+#define FB_TILES_X (FB_WIDTH / FB_TILE_SIZE)  // Must fit the bits of a uint32_t
+#define FB_TILES_Y (FB_HEIGHT / FB_TILE_SIZE)
+
+class DisplayFrameBuffer
+{
+  public:
+    DisplayFrameBuffer() { invalidate(); };
+    void setPixel(ucg_int_t x, ucg_int_t y, uint16_t color)
+    {
+      uint16_t &pixel = pixels[y * FB_WIDTH + x];
+      if(pixel == color)
+        return;
+      pixel = color;
+      dirtyTiles[y / FB_TILE_SIZE] |= (uint32_t)1 << (x / FB_TILE_SIZE);
+    };
+    uint16_t getPixel(ucg_int_t x, ucg_int_t y) { return pixels[y * FB_WIDTH + x]; };
+    // Force the whole screen to be sent on the next flush (panel content is unknown)
+    void invalidate() { for(uint8_t i = 0; i < FB_TILES_Y; i++) dirtyTiles[i] = 0xFFFFFFFF; };
+    bool isDirty()
+    {
+      for(uint8_t i = 0; i < FB_TILES_Y; i++)
+        if(dirtyTiles[i]) return true;
+      return false;
+    };
+    void flush(ucg_t *ucg);
+#ifdef DISPLAY_DMA
+    // Queue as much as fits into the DMA buffer and start sending it. Tiles that didn't fit stay
+    // dirty for the next call. Returns false if the previous transfer is still running.
+    bool queueFlush(ucg_t *ucg);
+#endif
+
+    // Statistics for the last flush and since startup
+    uint32_t lastFlushBytes = 0;
+    uint16_t lastFlushRects = 0;
+    uint32_t totalBytes = 0;
+    uint32_t flushCount = 0;
+
+  private:
+    bool nextDirtyRect(uint8_t &tx, uint8_t &ty, uint8_t &tw, uint8_t &th);
+    void clearDirtyRect(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th);
+    void sendRect(ucg_t *ucg, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+    uint16_t pixels[FB_WIDTH * FB_HEIGHT];
+    uint32_t dirtyTiles[FB_TILES_Y]; // One bit per tile, one word per row of tiles
+    uint8_t lineBuffer[FB_WIDTH * SSD1351_BYTES_PER_PIXEL];
+};
+
+DisplayFrameBuffer displayFrameBuffer;
+
+void DisplayFrameBuffer::sendRect(ucg_t *ucg, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+  ssd1351SetWindow(ucg, x, y, x + width - 1, y + height - 1);
+  for(uint8_t row = y; row < y + height; row++)
+  {
+    ssd1351PackPixels(&pixels[row * FB_WIDTH + x], width, lineBuffer);
+    ucg_com_SendString(ucg, width * SSD1351_BYTES_PER_PIXEL, lineBuffer);
+  }
+  ucg_com_SetCSLineStatus(ucg, 1);
+  lastFlushBytes += SSD1351_WINDOW_BYTES + (uint32_t)width * height * SSD1351_BYTES_PER_PIXEL;
+  lastFlushRects++;
+}
+
+// Find the next rectangle of dirty tiles, in tiles. Returns false if nothing is dirty.
+bool DisplayFrameBuffer::nextDirtyRect(uint8_t &tx, uint8_t &ty, uint8_t &tw, uint8_t &th)
+{
+  for(ty = 0; ty < FB_TILES_Y; ty++)
+  {
+    if(!dirtyTiles[ty])
+      continue;
+    // Take the first horizontal run of dirty tiles in this row...
+    tx = __builtin_ctz(dirtyTiles[ty]);
+    tw = 0;
+    while(tx + tw < FB_TILES_X && (dirtyTiles[ty] & ((uint32_t)1 << (tx + tw))))
+      tw++;
+    uint32_t runMask = (tw == 32 ? 0xFFFFFFFF : (((uint32_t)1 << tw) - 1)) << tx;
+    // ...and grow it downwards while the rows below are dirty across the same span
+    th = 1;
+    while(ty + th < FB_TILES_Y && (dirtyTiles[ty + th] & runMask) == runMask)
+      th++;
+    return true;
+  }
+  return false;
+}
+
+void DisplayFrameBuffer::clearDirtyRect(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th)
+{
+  uint32_t runMask = (tw == 32 ? 0xFFFFFFFF : (((uint32_t)1 << tw) - 1)) << tx;
+  for(uint8_t i = 0; i < th; i++)
+    dirtyTiles[ty + i] &= ~runMask;
+}
+
+void DisplayFrameBuffer::flush(ucg_t *ucg)
+{
+  lastFlushBytes = 0;
+  lastFlushRects = 0;
+  uint8_t tx, ty, tw, th;
+  while(nextDirtyRect(tx, ty, tw, th))
+  {
+    clearDirtyRect(tx, ty, tw, th);
+    sendRect(ucg, tx * FB_TILE_SIZE, ty * FB_TILE_SIZE, tw * FB_TILE_SIZE, th * FB_TILE_SIZE);
+  }
+  totalBytes += lastFlushBytes;
+  flushCount++;
+}
+
+#ifdef DISPLAY_DMA
+bool DisplayFrameBuffer::queueFlush(ucg_t *ucg)
+{
+  if(displayDma.isBusy())
+  {
+    displayDma.busyFlushes++;
+    return false;
+  }
+  lastFlushBytes = 0;
+  lastFlushRects = 0;
+  uint8_t tx, ty, tw, th;
+  while(nextDirtyRect(tx, ty, tw, th))
+  {
+    // Only take the rows of tiles that still fit
+    while(th > 0 && !displayDma.canQueueWindow(tw * th * FB_TILE_SIZE * FB_TILE_SIZE))
+      th--;
+    if(th == 0)
+      break;
+    clearDirtyRect(tx, ty, tw, th);
+    uint8_t x = tx * FB_TILE_SIZE, y = ty * FB_TILE_SIZE;
+    uint8_t width = tw * FB_TILE_SIZE, height = th * FB_TILE_SIZE;
+    uint8_t *out = displayDma.queueWindow(x, y, x + width - 1, y + height - 1, width * height);
+    for(uint8_t row = y; row < y + height; row++)
+    {
+      ssd1351PackPixels(&pixels[row * FB_WIDTH + x], width, out);
+      out += width * SSD1351_BYTES_PER_PIXEL;
+    }
+    lastFlushBytes += SSD1351_WINDOW_BYTES + (uint32_t)width * height * SSD1351_BYTES_PER_PIXEL;
+    lastFlushRects++;
+  }
+  totalBytes += lastFlushBytes;
+  flushCount++;
+  displayDma.start(ucg);
+  return true;
+}
+#endif
+
+// Ucglib device callback that draws into displayFrameBuffer.
+// Everything that isn't drawing (power, dimensions, clipping) goes to the real panel driver.
+ucg_int_t ucg_dev_ssd1351_18x128x128_fb(ucg_t *ucg, ucg_int_t msg, void *data)
+{
+  switch(msg)
+  {
+    case UCG_MSG_DEV_POWER_UP:
+      displayFrameBuffer.invalidate();
+      break;
+    case UCG_MSG_DRAW_PIXEL:
+      if(ucg_clip_is_pixel_visible(ucg) != 0)
+        displayFrameBuffer.setPixel(ucg->arg.pixel.pos.x, ucg->arg.pixel.pos.y,
+          rgb565(ucg->arg.pixel.rgb.color[0], ucg->arg.pixel.rgb.color[1], ucg->arg.pixel.rgb.color[2]));
+      return 1;
+    case UCG_MSG_DRAW_L90FX:
+      ucg_handle_l90fx(ucg, ucg_dev_ssd1351_18x128x128_fb);
+      return 1;
+    case UCG_MSG_DRAW_L90TC:
+      ucg_handle_l90tc(ucg, ucg_dev_ssd1351_18x128x128_fb);
+      return 1;
+    case UCG_MSG_DRAW_L90BF:
+      ucg_handle_l90bf(ucg, ucg_dev_ssd1351_18x128x128_fb);
+      return 1;
+    case UCG_MSG_DRAW_L90SE:
+      ucg_handle_l90se(ucg, ucg_dev_ssd1351_18x128x128_fb);
+      return 1;
+  }
+#ifdef DISPLAY_DMA
+  displayDma.wait(); // The panel driver is about to use the SPI bus
+#endif
+  return ucg_dev_ssd1351_18x128x128_ft(ucg, msg, data);
+}
+
+// Drop-in replacement for Ucglib_SSD1351_18x128x128_FT_HWSPI that renders through the framebuffer.
+// Call flush() once per loop to push the changes to the panel. With DISPLAY_DMA it doesn't block.
+class Ucglib_SSD1351_18x128x128_FB_HWSPI : public Ucglib4WireHWSPI
+{
+  public:
+    Ucglib_SSD1351_18x128x128_FB_HWSPI(uint8_t cd, uint8_t cs = UCG_PIN_VAL_NONE, uint8_t reset = UCG_PIN_VAL_NONE)
+      : Ucglib4WireHWSPI(ucg_dev_ssd1351_18x128x128_fb, ucg_ext_none, cd, cs, reset)
+    { };
+    void flush()
+    {
+      if(displayFrameBuffer.isDirty())
+#ifdef DISPLAY_DMA
+        displayFrameBuffer.queueFlush(getUcg());
+#else
+        displayFrameBuffer.flush(getUcg());
+#endif
+    };
+};
+
+#endif
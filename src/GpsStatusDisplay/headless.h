@@ -0,0 +1,56 @@
+#ifndef __headless_h__
+#define __headless_h__
+
+#include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+#include "GnssMonitor.h"
+
+// Profile for while the display is off.
+// The receiver stops sending DOP and HPPOSLLH over I2C, since only the pages use them, and the
+// monitor skips formatting texts. PVT keeps coming because the LED and everything else that
+// runs without a display needs it.
+// Only the I2C output rates change, so NMEA and RTCM on USB and Bluetooth carry on untouched.
+// The rates in use when the display went off are restored on wake.
+// With LOGGING, HPPOSLLH goes to the log and keeps coming.
+struct HeadlessProfile
+{
+  bool active = false;
+  uint8_t dopRate = 1;
+  uint8_t hpposllhRate = 1;
+  uint32_t entered = 0; // Number of times the display went off
+};
+HeadlessProfile headless;
+
+// Current I2C rate of a message. The sketch enables these at 1, and getVal8() returns 0
+// when the read fails, so 0 is taken as 1.
+uint8_t headlessRate(SFE_UBLOX_GNSS *gps, uint32_t key)
+{
+  uint8_t rate = gps->getVal8(key);
+  return rate > 0 ? rate : 1;
+}
+
+void enterHeadless(SFE_UBLOX_GNSS *gps)
+{
+  if(headless.active)
+    return;
+  headless.active = true;
+  headless.entered++;
+  headless.dopRate = headlessRate(gps, UBLOX_CFG_MSGOUT_UBX_NAV_DOP_I2C);
+  headless.hpposllhRate = headlessRate(gps, UBLOX_CFG_MSGOUT_UBX_NAV_HPPOSLLH_I2C);
+  gps->setAutoDOPrate(0);
+#ifndef LOGGING
+  gps->setAutoHPPOSLLHrate(0);
+#endif
+  setMonitorHeadless(true);
+}
+
+void leaveHeadless(SFE_UBLOX_GNSS *gps)
+{
+  if(!headless.active)
+    return;
+  headless.active = false;
+  gps->setAutoDOPrate(headless.dopRate);
+  gps->setAutoHPPOSLLHrate(headless.hpposllhRate);
+  setMonitorHeadless(false);
+}
+
+#endif
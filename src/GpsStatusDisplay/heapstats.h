@@ -0,0 +1,72 @@
+#ifndef __heapstats_h__
+#define __heapstats_h__
+
+#include <Arduino.h>
+
+// Heap usage and fragmentation counters, enabled with HEAP_STATS on newlib targets (SAMD51).
+// Every malloc/free/realloc takes newlib's malloc lock, so overriding the lock gives an exact
+// count of heap operations. A rendered frame that isn't a full redraw should cause none.
+// Without HEAP_STATS all functions compile to nothing.
+
+struct HeapStats
+{
+  uint32_t used = 0;        // Bytes currently allocated
+  uint32_t free = 0;        // Free bytes inside the heap that can be reused
+  uint32_t freeBlocks = 0;  // Number of free chunks. More than one means the heap is fragmented
+  uint32_t arena = 0;       // Total heap size taken from the system. The heap never shrinks, so this is the high-water mark
+  uint32_t maxUsed = 0;
+  uint32_t lastFrameOps = 0;          // Heap operations during the last rendered frame
+  uint32_t steadyStateFrameAllocs = 0; // Frames other than full redraws that touched the heap
+};
+
+#if defined(HEAP_STATS) && defined(__NEWLIB__)
+#include <malloc.h>
+
+HeapStats heapStats;
+volatile uint32_t heapOperations = 0;
+uint32_t heapOpsAtFrameStart = 0;
+
+extern "C" void __malloc_lock(struct _reent *) { heapOperations++; }
+extern "C" void __malloc_unlock(struct _reent *) { }
+
+void sampleHeapStats()
+{
+  struct mallinfo info = mallinfo();
+  heapStats.used = info.uordblks;
+  heapStats.free = info.fordblks;
+  heapStats.freeBlocks = info.ordblks;
+  heapStats.arena = info.arena;
+  if(heapStats.used > heapStats.maxUsed)
+    heapStats.maxUsed = heapStats.used;
+}
+void heapFrameBegin() { heapOpsAtFrameStart = heapOperations; }
+void heapFrameEnd(bool fullRedraw)
+{
+  heapStats.lastFrameOps = heapOperations - heapOpsAtFrameStart;
+  if(!fullRedraw && heapStats.lastFrameOps > 0)
+    heapStats.steadyStateFrameAllocs++;
+}
+void printHeapStats(Print &out)
+{
+  sampleHeapStats();
+  out.print("heap used:");
+  out.print(heapStats.used);
+  out.print(" max:");
+  out.print(heapStats.maxUsed);
+  out.print(" arena:");
+  out.print(heapStats.arena);
+  out.print(" free:");
+  out.print(heapStats.free);
+  out.print(" freeBlocks:");
+  out.print(heapStats.freeBlocks);
+  out.print(" steadyStateFrameAllocs:");
+  out.println(heapStats.steadyStateFrameAllocs);
+}
+#else
+void sampleHeapStats() { }
+void heapFrameBegin() { }
+void heapFrameEnd(bool) { }
+void printHeapStats(Print &) { }
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef __idle_h__
+#define __idle_h__
+
+#include <Arduino.h>
+#include "buttons.h"
+
+// Puts the CPU to sleep between passes through loop() until something needs attention.
+// Wake conditions:
+//  - a button event (the button interrupts queue them)
+//  - wake(), called from an interrupt such as the receiver's TX ready pin
+//  - the earliest deadline registered with wakeAt(): the next frame, the display timeout,
+//    the next receiver poll, log writes held back for the bus
+// On the SAMD51 this uses the IDLE sleep mode. The core stops on WFI but clocks and
+// peripherals keep running, so SysTick keeps millis() counting and SPI, I2C, DMA and USB keep
+// working. SysTick still wakes the core every millisecond. Each of these wakeups only checks
+// the conditions above and goes back to sleep, without running loop().
+// STANDBY would stop SysTick and the peripherals, and would need the RTC for timed wakeups.
+//
+// Time is accounted per power state, and wakeups are counted per reason.
+
+enum PowerState : uint8_t
+{
+  POWER_ACTIVE,           // Running loop()
+  POWER_IDLE,             // Sleeping with the display on
+  POWER_IDLE_DISPLAY_OFF, // Sleeping with the display powered down
+  POWER_STATE_COUNT
+};
+
+enum WakeReason : uint8_t
+{
+  WAKE_BUTTON,
+  WAKE_GNSS,    // Receiver has data (TX ready)
+  WAKE_POLL,    // Time to poll the receiver
+  WAKE_FRAME,   // A frame is due
+  WAKE_TIMEOUT, // Display timeout
+  WAKE_DISPLAY, // Display transfer needs more data
+  WAKE_LOG,     // Log buffers are waiting for the bus
+  WAKE_REASON_COUNT
+};
+
+// One sleep until the next interrupt. Implemented per platform below.
+void idleCpuSleep();
+
+class IdleScheduler
+{
+  public:
+    // Start collecting the deadlines for the next sleep
+    void beginIdle()
+    {
+      _hasDeadline = false;
+    };
+    // Wake no later than 'time' (millis())
+    void wakeAt(unsigned long time, WakeReason reason)
+    {
+      if(!_hasDeadline || (long)(time - _deadline) < 0)
+      {
+        _deadline = time;
+        _deadlineReason = reason;
+        _hasDeadline = true;
+      }
+    };
+    // End the current sleep, or the next one if not sleeping. Safe to call from an interrupt.
+    void wake(WakeReason reason)
+    {
+      _wakeReason = reason;
+      _wakeRequested = true;
+    };
+    // Sleep until one of the wake conditions is met. Returns immediately if one already is.
+    WakeReason sleep(PowerState state)
+    {
+      unsigned long start = micros();
+      stateMicros[POWER_ACTIVE] += start - _lastWake;
+      bool slept = false;
+      WakeReason reason;
+      for(;;)
+      {
+        if(_wakeRequested)
+        {
+          _wakeRequested = false;
+          reason = _wakeReason;
+          break;
+        }
+        if(!buttonsIdle())
+        {
+          reason = WAKE_BUTTON;
+          break;
+        }
+        if(_hasDeadline && (long)(millis() - _deadline) >= 0)
+        {
+          reason = _deadlineReason;
+          break;
+        }
+        idleCpuSleep();
+        slept = true;
+      }
+      _lastWake = micros();
+      stateMicros[state] += _lastWake - start;
+      if(slept)
+        wakeups[reason]++;
+      else
+        skippedSleeps++;
+      return reason;
+    };
+
+    void printStats(Print &out)
+    {
+      static const char *stateNames[POWER_STATE_COUNT] = { "active", "idle", "idle, display off" };
+      static const char *reasonNames[WAKE_REASON_COUNT] = { "button", "gnss", "poll", "frame", "timeout", "display", "log" };
+      uint64_t total = 0;
+      for(uint8_t i = 0; i < POWER_STATE_COUNT; i++)
+        total += stateMicros[i];
+      for(uint8_t i = 0; i < POWER_STATE_COUNT; i++)
+      {
+        out.print(stateNames[i]);
+        out.print(": ");
+        out.print((unsigned long)(stateMicros[i] / 1000));
+        out.print("ms (");
+        out.print(total > 0 ? (unsigned long)(stateMicros[i] * 100 / total) : 0UL);
+        out.println("%)");
+      }
+      out.print("wakeups:");
+      for(uint8_t i = 0; i < WAKE_REASON_COUNT; i++)
+      {
+        out.print(' ');
+        out.print(reasonNames[i]);
+        out.print('=');
+        out.print(wakeups[i]);
+      }
+      out.print(", without sleeping=");
+      out.println(skippedSleeps);
+    };
+
+    uint64_t stateMicros[POWER_STATE_COUNT] = { };
+    uint32_t wakeups[WAKE_REASON_COUNT] = { };
+    uint32_t skippedSleeps = 0; // Calls to sleep() that found a wake condition already met
+
+  private:
+    unsigned long _deadline = 0;
+    unsigned long _lastWake = 0;
+    WakeReason _deadlineReason = WAKE_POLL;
+    volatile WakeReason _wakeReason = WAKE_GNSS;
+    volatile bool _wakeRequested = false;
+    bool _hasDeadline = false;
+};
+
+IdleScheduler idleScheduler;
+
+#if defined(IDLE_HOST)
+// Host simulations provide idleCpuSleep() and advance their clock in it
+#elif defined(__SAMD51__)
+void idleCpuSleep()
+{
+  static bool configured = false;
+  if(!configured)
+  {
+    PM->SLEEPCFG.bit.SLEEPMODE = PM_SLEEPCFG_SLEEPMODE_IDLE_Val;
+    while(PM->SLEEPCFG.bit.SLEEPMODE != PM_SLEEPCFG_SLEEPMODE_IDLE_Val);
+    configured = true;
+  }
+  __DSB();
+  __WFI();
+}
+#else
+// No sleep mode support: wait one tick like the loop used to
+void idleCpuSleep() { delay(1); }
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __linkstats_h__
+#define __linkstats_h__
+
+#include <Arduino.h>
+#include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+
+// Output of the library's link and parser counters (SFE_UBLOX_GNSS::getLinkStats()), for tuning
+// the polling interval, bus speed and message rates under real load:
+//  - emptyPolls close to polls: i2cPollingWait could be longer
+//  - notReadyRetries, lengthLsbFF, lengthMsbSet, busErrors: the bus is too fast or marginal
+//  - droppedCallbacks: messages arrive faster than the loop calls checkCallbacks()
+//  - checksumFailures, resyncs, overruns: corrupt or lost bytes
+// The counters are always kept. LINK_STATS prints them every 10 seconds and adds a hidden page.
+
+void printLinkStats(Print &out, SFE_UBLOX_GNSS &gps)
+{
+  const sfe_ublox_link_stats_t &stats = gps.getLinkStats();
+  out.print("link bytes:");
+  out.print(stats.bytesRead);
+  out.print(" polls:");
+  out.print(stats.polls);
+  out.print(" empty:");
+  out.print(stats.emptyPolls);
+  out.print(" busErrors:");
+  out.print(stats.busErrors);
+  out.print(" notReady:");
+  out.print(stats.notReadyRetries);
+  out.print(" lengthLsbFF:");
+  out.print(stats.lengthLsbFF);
+  out.print(" lengthMsbSet:");
+  out.println(stats.lengthMsbSet);
+  out.print("parser ubx:");
+  out.print(stats.ubxFrames);
+  out.print(" nmea:");
+  out.print(stats.nmeaSentences);
+  out.print(" rtcm:");
+  out.print(stats.rtcmFrames);
+  out.print(" checksum:");
+  out.print(stats.checksumFailures);
+  out.print(" resyncs:");
+  out.print(stats.resyncs);
+  out.print(" overruns:");
+  out.print(stats.overruns);
+  out.print(" allocFailures:");
+  out.print(stats.allocFailures);
+  out.print(" droppedCallbacks:");
+  out.print(stats.droppedCallbacks);
+  out.print(" logDropped:");
+  out.println(gps.getFileBufferDropped());
+  out.print("ubx messages:");
+  for(uint8_t i = 0; i < stats.messageTypes; i++)
+  {
+    out.print(' ');
+    if(stats.messages[i].cls < 0x10)
+      out.print('0');
+    out.print(stats.messages[i].cls, HEX);
+    out.print('-');
+    if(stats.messages[i].id < 0x10)
+      out.print('0');
+    out.print(stats.messages[i].id, HEX);
+    out.print(':');
+    out.print(stats.messages[i].count);
+  }
+  out.print(" other:");
+  out.println(stats.otherMessages);
+}
+
+#endif
@@ -0,0 +1,609 @@
+#ifndef __logger_h__
+#define __logger_h__
+
+#include <Arduino.h>
+#include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+#include "epochlog.h"
+#include "logindex.h"
+
+// Drains the receiver library's file buffer (the UBX frames enabled with logNAVPVT() and
+// friends) to storage in whole blocks.
+// Frames are copied into one of two block aligned buffers. When it is full the other one
+// takes over and the full one goes to the device as a single multi-block write, so the
+// device never sees a partial or unaligned sector until the log is closed. When nothing is
+// buffered and a whole buffer's worth is contiguous in the file buffer, that span is written
+// as it is, without the copy. The file buffer keeps taking frames while a write is in
+// progress; getMaxFileBufferAvail() shows how close it came to overflowing and
+// getFileBufferDropped() whether it did.
+// Started without a receiver, a logger writes whatever is passed to append() instead.
+
+#define LOG_BLOCK_SIZE 512
+#ifndef LOGGER_BUFFER_BLOCKS
+#define LOGGER_BUFFER_BLOCKS 4 // Per buffer
+#endif
+#define LOGGER_BUFFER_SIZE (LOG_BLOCK_SIZE * LOGGER_BUFFER_BLOCKS)
+#ifndef LOGGER_SYNC_MS
+#define LOGGER_SYNC_MS 10000 // How much logging a power loss can cost
+#endif
+
+// Storage the logger writes to. Blocks are appended in order.
+class LogBlockDevice
+{
+  public:
+    virtual ~LogBlockDevice() {}
+    virtual bool begin() = 0;
+    // Append count blocks of LOG_BLOCK_SIZE bytes
+    virtual bool writeBlocks(const uint8_t *data, uint16_t count) = 0;
+    // Append the last, partial block when the log is closed
+    virtual bool writeTail(const uint8_t *data, uint16_t length) = 0;
+    // Make everything written so far survive a power loss
+    virtual bool sync() = 0;
+    virtual void end() = 0;
+};
+
+// Sees every byte that goes into a log, in order
+class LogScanner
+{
+  public:
+    virtual ~LogScanner() {}
+    // offset is the position of data[0] in the log
+    virtual void scan(const uint8_t *data, uint32_t length, uint64_t offset) = 0;
+};
+
+class UbxLogger
+{
+  public:
+    UbxLogger(LogBlockDevice *device, LogScanner *scanner = nullptr) : _device(device), _scanner(scanner) {};
+
+    bool begin(SFE_UBLOX_GNSS *gps = nullptr)
+    {
+      _gps = gps;
+      _fill = 0;
+      _active = 0;
+      _next = 0;
+      _full[0] = _full[1] = false;
+      _offset = 0;
+      _started = _device->begin();
+      startMillis = millis();
+      lastSyncMillis = startMillis;
+      return _started;
+    };
+    // Call from loop(). Moves what the file buffer holds into the block buffers and writes
+    // every full buffer, so the file buffer is empty again however rarely loop() runs.
+    // With allowWrite false only the copy happens, for when the bus is in use. writePending()
+    // then says that the writes are still to do.
+    void service(bool allowWrite = true)
+    {
+      if(!_started)
+        return;
+      for(;;)
+      {
+        if(allowWrite && writeDirect())
+          continue;
+        fill();
+        if(!allowWrite || !writeNext())
+          break;
+      }
+    };
+    // True while full buffers wait for service() to write them
+    bool writePending() { return _started && (_full[0] || _full[1]); };
+    // Adds data to the block buffers. It is written by the following calls to service().
+    // Returns false, and drops the data, if both buffers are waiting for the device.
+    bool append(const uint8_t *data, uint16_t length)
+    {
+      if(!_started)
+        return false;
+      uint32_t space = _full[_active] ? 0 : LOGGER_BUFFER_SIZE - _fill + (_full[_active ^ 1] ? 0 : LOGGER_BUFFER_SIZE);
+      if(length > space)
+      {
+        droppedBytes += length;
+        return false;
+      }
+      bytesLogged += length;
+      while(length > 0)
+      {
+        uint16_t count = LOGGER_BUFFER_SIZE - _fill;
+        if(count > length)
+          count = length;
+        memcpy(&_buffers[_active][_fill], data, count);
+        scan(data, count);
+        _fill += count;
+        data += count;
+        length -= count;
+        if(_fill == LOGGER_BUFFER_SIZE)
+        {
+          _full[_active] = true;
+          _active ^= 1;
+          _fill = 0;
+        }
+      }
+      return true;
+    };
+    // Writes out everything buffered, including the partial block, and closes the device
+    void end()
+    {
+      if(!_started)
+        return;
+      do
+      {
+        service(false);
+        while(writeNext());
+      } while(_gps != nullptr && _gps->fileBufferAvailable() > 0);
+      if(_fill > 0 && !_device->writeTail(_buffers[_active], _fill))
+        failedWrites++;
+      _fill = 0;
+      _device->sync();
+      _device->end();
+      _started = false;
+    };
+    bool isStarted() { return _started; };
+
+    // Bytes per second written since begin()
+    uint32_t throughput()
+    {
+      unsigned long elapsed = millis() - startMillis;
+      return elapsed > 0 ? (uint32_t)((uint64_t)blocksWritten * LOG_BLOCK_SIZE * 1000 / elapsed) : 0;
+    };
+    // Bytes per second the device takes while writing
+    uint32_t deviceThroughput()
+    {
+      return writeMicros > 0 ? (uint32_t)((uint64_t)blocksWritten * LOG_BLOCK_SIZE * 1000000 / writeMicros) : 0;
+    };
+
+    void printStats(Print &out)
+    {
+      if(!_started && bytesLogged == 0)
+      {
+        out.println("log: not started");
+        return;
+      }
+      out.print("log: ");
+      out.print(bytesLogged);
+      out.print(" bytes, ");
+      out.print(blocksWritten);
+      out.print(" blocks (");
+      out.print(directWrites);
+      out.print(" of ");
+      out.print(writes);
+      out.print(" writes direct), ");
+      out.print(throughput());
+      out.print(" B/s, device ");
+      out.print(deviceThroughput());
+      out.print(" B/s, max write ");
+      out.print(maxWriteMicros);
+      out.print("us, failed writes ");
+      out.print(failedWrites);
+      out.print(", dropped ");
+      out.println(droppedBytes);
+      if(_gps == nullptr)
+        return;
+      out.print("file buffer: max ");
+      out.print(_gps->getMaxFileBufferAvail());
+      out.print(" of ");
+      out.print(_gps->getFileBufferSize());
+      out.print(" bytes, dropped ");
+      out.println(_gps->getFileBufferDropped());
+    };
+
+    uint32_t bytesLogged = 0;   // Taken from the file buffer
+    uint32_t blocksWritten = 0;
+    uint32_t writes = 0;
+    uint32_t directWrites = 0;  // Of writes, those straight from the file buffer
+    uint32_t failedWrites = 0;
+    uint32_t droppedBytes = 0;  // Passed to append() while both buffers were full
+    uint64_t writeMicros = 0;   // Time spent in writes and syncs
+    uint32_t maxWriteMicros = 0;
+    unsigned long startMillis = 0;
+    unsigned long lastSyncMillis = 0;
+
+  private:
+    LogBlockDevice *_device;
+    SFE_UBLOX_GNSS *_gps = nullptr;
+    // Word aligned, so DMA capable SPI drivers can send them as they are
+    uint8_t _buffers[2][LOGGER_BUFFER_SIZE] __attribute__((aligned(4)));
+    uint16_t _fill = 0;  // Bytes in the active buffer
+    uint8_t _active = 0; // Buffer being filled
+    uint8_t _next = 0;   // Oldest full buffer, written next
+    bool _full[2] = { false, false };
+    bool _started = false;
+    LogScanner *_scanner;
+    uint64_t _offset = 0; // Bytes in the log so far
+
+    void scan(const uint8_t *data, uint32_t length)
+    {
+      if(_scanner != nullptr)
+        _scanner->scan(data, length, _offset);
+      _offset += length;
+    };
+
+    // Copies from the file buffer until it is empty or both block buffers are full
+    void fill()
+    {
+      while(_gps != nullptr && !_full[_active])
+      {
+        uint32_t count = _gps->extractFileBufferData(&_buffers[_active][_fill], LOGGER_BUFFER_SIZE - _fill);
+        if(count == 0)
+          break;
+        scan(&_buffers[_active][_fill], count);
+        _fill += count;
+        bytesLogged += count;
+        if(_fill == LOGGER_BUFFER_SIZE)
+        {
+          _full[_active] = true;
+          _active ^= 1;
+          _fill = 0;
+        }
+      }
+    };
+    // Writes the oldest full buffer. Returns false if there was none.
+    bool writeNext()
+    {
+      if(!_full[_next])
+        return false;
+      write(_buffers[_next]);
+      _full[_next] = false;
+      _next ^= 1;
+      return true;
+    };
+    // Writes a buffer's worth straight from the file buffer if that is where the oldest data is.
+    // Returns false if not.
+    bool writeDirect()
+    {
+      if(_gps == nullptr || _fill > 0 || _full[0] || _full[1])
+        return false;
+      const uint8_t *span;
+      if(_gps->getFileBufferSpan(&span) < LOGGER_BUFFER_SIZE)
+        return false;
+      write(span);
+      scan(span, LOGGER_BUFFER_SIZE);
+      _gps->consumeFileBufferData(LOGGER_BUFFER_SIZE);
+      bytesLogged += LOGGER_BUFFER_SIZE;
+      directWrites++;
+      return true;
+    };
+    void write(const uint8_t *data)
+    {
+      unsigned long start = micros();
+      if(_device->writeBlocks(data, LOGGER_BUFFER_BLOCKS))
+        blocksWritten += LOGGER_BUFFER_BLOCKS;
+      else
+        failedWrites++;
+      if(millis() - lastSyncMillis >= LOGGER_SYNC_MS)
+      {
+        _device->sync();
+        lastSyncMillis = millis();
+      }
+      unsigned long elapsed = micros() - start;
+      writeMicros += elapsed;
+      if(elapsed > maxWriteMicros)
+        maxWriteMicros = elapsed;
+      writes++;
+    };
+};
+
+// Writes the compact epoch log (epochlog.h) through a logger started without a receiver.
+// An epoch is PVT for time, fix and satellites plus HPPOSLLH for the position, matched by
+// iTOW. Whichever arrives second completes it. An epoch that never gets its HPPOSLLH is
+// written with the PVT position when the next epoch starts.
+class EpochLogger
+{
+  public:
+    EpochLogger(UbxLogger *logger, uint16_t keyframeInterval = EPOCH_KEYFRAME_INTERVAL) :
+      _logger(logger), _encoder(keyframeInterval) {};
+
+    bool begin()
+    {
+      if(!_logger->begin())
+        return false;
+      return _logger->append((const uint8_t *)EPOCH_LOG_MAGIC, EPOCH_LOG_MAGIC_LENGTH);
+    };
+    void addPVT(const UBX_NAV_PVT_data_t &pvt)
+    {
+      if(!_logger->isStarted())
+        return;
+      if(_havePvt || (_haveHp && _record.iTOW != pvt.iTOW))
+        flush();
+      _record.iTOW = pvt.iTOW;
+      _record.fixType = pvt.fixType;
+      _record.carrSoln = pvt.flags.bits.carrSoln;
+      _record.numSV = pvt.numSV;
+      _record.year = pvt.year;
+      _record.month = pvt.month;
+      _record.day = pvt.day;
+      _record.flags = (_record.flags & EPOCH_FLAG_HIGH_PRECISION) | (pvt.flags.bits.gnssFixOK ? EPOCH_FLAG_FIX_OK : 0);
+      if(!_haveHp)
+      {
+        _record.lat = (int64_t)pvt.lat * 100;
+        _record.lon = (int64_t)pvt.lon * 100;
+        _record.height = (int64_t)pvt.height * 10;
+        _record.hMSL = (int64_t)pvt.hMSL * 10;
+        _record.hAcc = pvt.hAcc * 10;
+        _record.vAcc = pvt.vAcc * 10;
+      }
+      _havePvt = true;
+      if(_haveHp)
+        flush();
+    };
+    void addHPPOSLLH(const UBX_NAV_HPPOSLLH_data_t &hp)
+    {
+      if(!_logger->isStarted())
+        return;
+      if(_haveHp || (_havePvt && _record.iTOW != hp.iTOW))
+        flush();
+      if(hp.flags.bits.invalidLlh)
+        return;
+      _record.iTOW = hp.iTOW;
+      _record.lat = (int64_t)hp.lat * 100 + hp.latHp;
+      _record.lon = (int64_t)hp.lon * 100 + hp.lonHp;
+      _record.height = (int64_t)hp.height * 10 + hp.heightHp;
+      _record.hMSL = (int64_t)hp.hMSL * 10 + hp.hMSLHp;
+      _record.hAcc = hp.hAcc;
+      _record.vAcc = hp.vAcc;
+      _haveHp = true;
+      if(_havePvt)
+        flush();
+    };
+
+    void printStats(Print &out)
+    {
+      out.print("epochs: ");
+      out.print(_encoder.epochs);
+      out.print(", keyframes ");
+      out.print(_encoder.keyframes);
+      out.print(", ");
+      out.print(_logger->bytesLogged);
+      out.print(" bytes, ");
+      out.print(_encoder.epochs > 0 ? (float)_logger->bytesLogged / _encoder.epochs : 0.0f, 1);
+      out.println(" per epoch");
+    };
+
+  private:
+    void flush()
+    {
+      if(!_havePvt && !_haveHp)
+        return;
+      _record.flags = (_record.flags & ~EPOCH_FLAG_HIGH_PRECISION) | (_haveHp ? EPOCH_FLAG_HIGH_PRECISION : 0);
+      uint8_t record[EPOCH_RECORD_MAX];
+      uint8_t length = _encoder.encode(_record, record);
+      if(!_logger->append(record, length))
+        _encoder.forceKeyframe(); // The next record must not depend on the lost one
+      _havePvt = _haveHp = false;
+    };
+    UbxLogger *_logger;
+    EpochEncoder _encoder;
+    EpochRecord _record = EpochRecord();
+    bool _havePvt = false;
+    bool _haveHp = false;
+};
+
+// Writes the time index (logindex.h) of a UBX log through a logger started without a
+// receiver. Pass it to the UBX log's logger as its scanner. It follows the UBX framing of
+// the log, skipping payloads by their length, and only reads the start of NAV-PVT payloads.
+class UbxLogIndexer : public LogScanner
+{
+  public:
+    UbxLogIndexer(UbxLogger *logger, uint16_t intervalSeconds = LOG_INDEX_INTERVAL_S) :
+      _logger(logger), _intervalSeconds(intervalSeconds) {};
+
+    bool begin()
+    {
+      if(!_logger->begin())
+        return false;
+      uint8_t header[LOG_INDEX_HEADER_SIZE];
+      logIndexPutHeader(header, _intervalSeconds);
+      return _logger->append(header, sizeof(header));
+    };
+    void scan(const uint8_t *data, uint32_t length, uint64_t offset) override
+    {
+      while(length > 0)
+      {
+        if(_skip > 0)
+        {
+          uint32_t count = _skip < length ? _skip : length;
+          data += count;
+          length -= count;
+          offset += count;
+          _skip -= count;
+          continue;
+        }
+        if(_headerLength == 0)
+        {
+          if(*data != 0xB5)
+          {
+            data++;
+            length--;
+            offset++;
+            resyncBytes++;
+            continue;
+          }
+          _frameOffset = offset;
+        }
+        else if(_headerLength == 1 && *data != 0x62)
+        {
+          _headerLength = 0; // Not a frame. Look at this byte again as a sync char
+          resyncBytes++;
+          continue;
+        }
+        _header[_headerLength++] = *data++;
+        length--;
+        offset++;
+        if(_headerLength == 6)
+        {
+          uint16_t payloadLength = _header[4] | (_header[5] << 8);
+          if(_header[2] != UBX_CLASS_NAV || _header[3] != UBX_NAV_PVT || payloadLength < PVT_INDEX_BYTES)
+          {
+            _skip = payloadLength + 2; // And the checksum
+            _headerLength = 0;
+          }
+        }
+        else if(_headerLength == 6 + PVT_INDEX_BYTES)
+        {
+          indexPvt(&_header[6]);
+          uint16_t payloadLength = _header[4] | (_header[5] << 8);
+          _skip = payloadLength - PVT_INDEX_BYTES + 2;
+          _headerLength = 0;
+        }
+      }
+    };
+
+    uint32_t entries = 0;
+    uint32_t resyncBytes = 0; // Bytes outside UBX frames, e.g. NMEA
+
+  private:
+    static const uint8_t PVT_INDEX_BYTES = 12; // iTOW, date, time and validity flags
+
+    void indexPvt(const uint8_t *payload)
+    {
+      if((payload[11] & 0x03) != 0x03)
+        return; // Date or time not valid yet
+      uint32_t iTOW = payload[0] | (payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+      uint16_t year = payload[4] | (payload[5] << 8);
+      LogIndexEntry entry;
+      entry.week = gpsWeek(year, payload[6], payload[7], payload[8], payload[9], payload[10], iTOW);
+      entry.iTOW = iTOW;
+      entry.offset = _frameOffset;
+      // Only ever forward, so the index stays sorted
+      uint32_t interval = (uint32_t)(gpsMillis(entry.week, iTOW) / (_intervalSeconds * 1000UL));
+      if(entries > 0 && interval <= _lastInterval)
+        return;
+      uint8_t record[LOG_INDEX_ENTRY_SIZE];
+      logIndexPutEntry(record, entry);
+      if(_logger->append(record, sizeof(record)))
+      {
+        _lastInterval = interval;
+        entries++;
+      }
+    };
+    UbxLogger *_logger;
+    uint16_t _intervalSeconds;
+    uint8_t _header[6 + PVT_INDEX_BYTES];
+    uint8_t _headerLength = 0;
+    uint32_t _skip = 0;
+    uint64_t _frameOffset = 0;
+    uint32_t _lastInterval = 0;
+};
+
+#if defined(LOGGER_POSIX)
+// A file on the host, for the simulations and tools
+#include <fcntl.h>
+#include <unistd.h>
+
+class PosixLogFile : public LogBlockDevice
+{
+  public:
+    PosixLogFile(const char *path) : _path(path) {};
+    bool begin() override
+    {
+      _fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      return _fd >= 0;
+    };
+    bool writeBlocks(const uint8_t *data, uint16_t count) override
+    {
+      return writeAll(data, (size_t)count * LOG_BLOCK_SIZE);
+    };
+    bool writeTail(const uint8_t *data, uint16_t length) override { return writeAll(data, length); };
+    bool sync() override { return _fd >= 0 && fsync(_fd) == 0; };
+    void end() override
+    {
+      if(_fd >= 0)
+        close(_fd);
+      _fd = -1;
+    };
+
+  private:
+    bool writeAll(const uint8_t *data, size_t length)
+    {
+      while(length > 0)
+      {
+        ssize_t written = write(_fd, data, length);
+        if(written <= 0)
+          return false;
+        data += written;
+        length -= written;
+      }
+      return true;
+    };
+    const char *_path;
+    int _fd = -1;
+};
+
+#else
+// An SD card on SPI, or any other volume SdFat can mount
+#include <SdFat.h> //http://librarymanager/All#SdFat
+
+#ifndef LOGGER_PREALLOCATE
+#define LOGGER_PREALLOCATE (64UL * 1024 * 1024) // Several hours of PVT + HPPOSLLH + RAWX at 1Hz
+#endif
+
+// Writes to LOGnnn.<extension>. The file is preallocated, so its clusters are contiguous and
+// block writes go straight to consecutive sectors without FAT updates.
+// Files on the same card share one volume and one number: the first file opened picks the first
+// nnn that no UBX, IDX or EPL file has, so LOGnnn.IDX and LOGnnn.EPL belong to LOGnnn.UBX even
+// when earlier runs didn't write all three.
+class SdLogFile : public LogBlockDevice
+{
+  public:
+    SdLogFile(uint8_t csPin, const char *extension = "UBX", uint32_t preallocate = LOGGER_PREALLOCATE) :
+      _csPin(csPin), _extension(extension), _preallocate(preallocate) {};
+    bool begin() override
+    {
+      static SdFs sd;
+      static bool mounted = false;
+      // The display shares the SPI bus
+      if(!mounted && !sd.begin(SdSpiConfig(_csPin, SHARED_SPI, SD_SCK_MHZ(24))))
+        return false;
+      mounted = true;
+      static int16_t number = -1;
+      if(number < 0)
+        number = freeNumber(sd);
+      char name[13];
+      snprintf(name, sizeof(name), "LOG%03u.%s", (unsigned)number, _extension);
+      if(!_file.open(&sd, name, O_WRONLY | O_CREAT | O_EXCL))
+        return false;
+      _file.preAllocate(_preallocate); // Falls back to a growing file if there is no room
+      return true;
+    };
+    bool writeBlocks(const uint8_t *data, uint16_t count) override
+    {
+      size_t length = (size_t)count * LOG_BLOCK_SIZE;
+      return _file.write(data, length) == length;
+    };
+    bool writeTail(const uint8_t *data, uint16_t length) override
+    {
+      return _file.write(data, length) == length;
+    };
+    bool sync() override { return _file.sync(); };
+    void end() override
+    {
+      _file.truncate(); // Give back the unused part of the preallocation
+      _file.close();
+    };
+
+  private:
+    static int16_t freeNumber(SdFs &sd)
+    {
+      static const char *const extensions[] = { "UBX", "IDX", "EPL" };
+      char name[13];
+      int16_t i = 0;
+      for(; i < 999; i++)
+      {
+        bool used = false;
+        for(uint8_t e = 0; e < sizeof(extensions) / sizeof(extensions[0]) && !used; e++)
+        {
+          snprintf(name, sizeof(name), "LOG%03u.%s", (unsigned)i, extensions[e]);
+          used = sd.exists(name);
+        }
+        if(!used)
+          break;
+      }
+      return i;
+    };
+
+    uint8_t _csPin;
+    const char *_extension;
+    uint32_t _preallocate;
+    FsFile _file;
+};
+#endif
+
+#endif
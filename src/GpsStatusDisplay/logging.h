@@ -0,0 +1,39 @@
+#ifndef __logging_h__
+#define __logging_h__
+
+#include <Arduino.h>
+
+// Diagnostic output on Serial with a compile-time level. Messages above LOG_LEVEL compile to
+// nothing, arguments included, so leaving log lines in drawing and input code is free.
+// Each message is a constant label followed by one value, printed without building Strings.
+// Build with -DLOG_LEVEL=LOG_LEVEL_DEBUG (or change the default below) to see everything.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_ERROR
+#endif
+
+#define LOG_PRINT(label, value) do { Serial.print(label); Serial.println(value); } while(0)
+#define LOG_SKIP(label, value) do { } while(0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(label, value) LOG_PRINT(label, value)
+#else
+#define LOG_ERROR(label, value) LOG_SKIP(label, value)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(label, value) LOG_PRINT(label, value)
+#else
+#define LOG_INFO(label, value) LOG_SKIP(label, value)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(label, value) LOG_PRINT(label, value)
+#else
+#define LOG_DEBUG(label, value) LOG_SKIP(label, value)
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __logindex_h__
+#define __logindex_h__
+
+#include <stdint.h>
+#include <string.h>
+
+// Time index for a UBX log (LOGnnn.IDX next to LOGnnn.UBX): where in the log each stretch of
+// intervalSeconds of GPS time starts, so a reader can seek to a time without scanning the
+// log for sync bytes.
+//
+// File: "UBXI", version (uint16), intervalSeconds (uint16), then fixed size entries in time
+// order. Everything is little-endian.
+// An entry is written for the first NAV-PVT with a valid date and time in each interval and
+// points at the first byte of that PVT frame. Frames the receiver sends before the PVT of
+// the same epoch are just before the offset.
+
+#define LOG_INDEX_MAGIC "UBXI"
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_HEADER_SIZE 8
+#define LOG_INDEX_ENTRY_SIZE 16
+#ifndef LOG_INDEX_INTERVAL_S
+#define LOG_INDEX_INTERVAL_S 10
+#endif
+
+#define GPS_WEEK_MS 604800000UL
+
+struct LogIndexEntry
+{
+  uint16_t week;   // GPS week
+  uint32_t iTOW;   // GPS time of week, ms
+  uint64_t offset; // Byte offset of the NAV-PVT frame in the log
+};
+
+// Milliseconds since the GPS epoch, the key the index is sorted by
+static inline uint64_t gpsMillis(uint16_t week, uint32_t iTOW)
+{
+  return (uint64_t)week * GPS_WEEK_MS + iTOW;
+}
+
+// Days from 1970-01-01 to a date of the proleptic Gregorian calendar
+static inline int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day)
+{
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  uint32_t yearOfEra = (uint32_t)(year - era * 400);
+  uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+// GPS week of a NAV-PVT solution. The date is UTC, which runs behind GPS time by the leap
+// seconds, so right after the week starts the date can still be the last day of the previous
+// week. iTOW, which is GPS time, tells the two apart.
+static inline uint16_t gpsWeek(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second, uint32_t iTOW)
+{
+  int32_t days = daysFromCivil(year, month, day) - daysFromCivil(1980, 1, 6);
+  uint16_t week = days / 7;
+  uint32_t utcSecondOfWeek = (days % 7) * 86400UL + hour * 3600UL + minute * 60UL + second;
+  if(iTOW / 1000 + GPS_WEEK_MS / 2000 < utcSecondOfWeek)
+    week++; // GPS time is already in the next week
+  return week;
+}
+
+static inline void logIndexPutHeader(uint8_t *out, uint16_t intervalSeconds)
+{
+  memcpy(out, LOG_INDEX_MAGIC, 4);
+  out[4] = LOG_INDEX_VERSION & 0xFF;
+  out[5] = LOG_INDEX_VERSION >> 8;
+  out[6] = intervalSeconds & 0xFF;
+  out[7] = intervalSeconds >> 8;
+}
+
+static inline void logIndexPutEntry(uint8_t *out, const LogIndexEntry &entry)
+{
+  out[0] = entry.week & 0xFF;
+  out[1] = entry.week >> 8;
+  out[2] = 0;
+  out[3] = 0;
+  for(uint8_t i = 0; i < 4; i++)
+    out[4 + i] = (uint8_t)(entry.iTOW >> (8 * i));
+  for(uint8_t i = 0; i < 8; i++)
+    out[8 + i] = (uint8_t)(entry.offset >> (8 * i));
+}
+
+static inline LogIndexEntry logIndexGetEntry(const uint8_t *in)
+{
+  LogIndexEntry entry;
+  entry.week = in[0] | (in[1] << 8);
+  entry.iTOW = 0;
+  for(uint8_t i = 0; i < 4; i++)
+    entry.iTOW |= (uint32_t)in[4 + i] << (8 * i);
+  entry.offset = 0;
+  for(uint8_t i = 0; i < 8; i++)
+    entry.offset |= (uint64_t)in[8 + i] << (8 * i);
+  return entry;
+}
+
+#endif
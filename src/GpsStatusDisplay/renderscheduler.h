@@ -0,0 +1,102 @@
+#ifndef __renderscheduler_h__
+#define __renderscheduler_h__
+
+#include <Arduino.h>
+
+// Decides when the screen is redrawn, independently of how often the GNSS delivers data.
+// Data updates only mark the screen as pending, and all updates that arrive between two
+// frames are coalesced into a single redraw at the target frame rate. Full redraws
+// (page change, menu exit, display wake) are drawn on the next loop.
+// If the last frame or the last round of GNSS ingestion took longer than the frame budget,
+// the next frame is flagged so pages can skip fields that aren't critical.
+class RenderScheduler
+{
+  public:
+    RenderScheduler(uint8_t framesPerSecond, uint16_t frameBudgetMs)
+    {
+      setFrameRate(framesPerSecond);
+      setFrameBudget(frameBudgetMs);
+    };
+    void setFrameRate(uint8_t framesPerSecond) { _frameInterval = 1000 / (framesPerSecond > 0 ? framesPerSecond : 1); };
+    void setFrameBudget(uint16_t ms) { _frameBudget = (uint32_t)ms * 1000; };
+    uint16_t getFrameInterval() { return _frameInterval; };
+
+    // Something changed on screen. Multiple requests before the next frame become one redraw.
+    void requestRedraw(bool fullRedraw = false)
+    {
+      if(_pending && !fullRedraw)
+        coalescedUpdates++;
+      _pending = true;
+      _fullRedraw |= fullRedraw;
+    };
+    // How long the last checkUblox/checkCallbacks round took
+    void ingestDone(unsigned long durationMicros)
+    {
+      if(durationMicros > _frameBudget)
+        _behind = true;
+    };
+    bool frameDue(unsigned long now)
+    {
+      if(!_pending)
+        return false;
+      return _fullRedraw || now - _lastFrame >= _frameInterval;
+    };
+    // When frameDue() becomes true. Returns false if no frame is pending.
+    bool nextFrameTime(unsigned long now, unsigned long &time)
+    {
+      if(!_pending)
+        return false;
+      time = _fullRedraw ? now : _lastFrame + _frameInterval;
+      return true;
+    };
+    bool isFullRedraw() { return _fullRedraw; };
+    // True while ingestion is falling behind. Pages should skip non-critical fields this frame.
+    bool deferNonCritical() { return _deferring; };
+
+    void beginFrame()
+    {
+      _frameStart = micros();
+      _lastFrame = millis();
+      _deferring = _behind && !_fullRedraw;
+      _behind = false;
+      if(_deferring)
+        deferredFrames++;
+    };
+    void endFrame()
+    {
+      lastFrameMicros = micros() - _frameStart;
+      if(lastFrameMicros > maxFrameMicros)
+        maxFrameMicros = lastFrameMicros;
+      avgFrameMicros = frames == 0 ? lastFrameMicros : (avgFrameMicros * 7 + lastFrameMicros) / 8;
+      frames++;
+      if(lastFrameMicros > _frameBudget)
+      {
+        framesOverBudget++;
+        _behind = true;
+      }
+      _pending = false;
+      _fullRedraw = false;
+      _deferring = false;
+    };
+
+    // Measured frame statistics
+    uint32_t lastFrameMicros = 0;
+    uint32_t avgFrameMicros = 0; // Running average over roughly the last 8 frames
+    uint32_t maxFrameMicros = 0;
+    uint32_t frames = 0;
+    uint32_t framesOverBudget = 0;
+    uint32_t deferredFrames = 0;
+    uint32_t coalescedUpdates = 0; // Data updates that didn't need a frame of their own
+
+  private:
+    uint16_t _frameInterval;
+    uint32_t _frameBudget;
+    unsigned long _lastFrame = 0;
+    unsigned long _frameStart = 0;
+    bool _pending = false;
+    bool _fullRedraw = false;
+    bool _behind = false;
+    bool _deferring = false;
+};
+
+#endif
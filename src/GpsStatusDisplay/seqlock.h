@@ -0,0 +1,55 @@
+#ifndef __seqlock_h__
+#define __seqlock_h__
+
+#include <stdint.h>
+
+// Double-buffered sequence lock for one producer and any number of readers.
+// The producer (callback, interrupt or DMA-completion handler) never waits: it always
+// writes into the back buffer and then flips the sequence so the back becomes the front.
+// Readers copy the front buffer and only retry if the producer lapped them and started
+// overwriting the buffer they were copying from.
+//
+// Sequence is even when idle and odd while a write is in progress.
+// Front buffer index is (sequence / 2) & 1.
+template <typename T>
+class SeqLock
+{
+  public:
+    SeqLock() : _seq(0), _retries(0) {}
+
+    // Publish a new value. Must only ever be called from a single context.
+    void write(const T& value)
+    {
+      uint32_t seq = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+      __atomic_store_n(&_seq, seq + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      _buffers[((seq >> 1) + 1) & 1] = value;
+      __atomic_store_n(&_seq, seq + 2, __ATOMIC_RELEASE);
+    }
+
+    // Copy the most recently published value into 'value'
+    void read(T& value) const
+    {
+      for (;;)
+      {
+        uint32_t seq = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE) & ~(uint32_t)1;
+        value = _buffers[(seq >> 1) & 1];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        // Our buffer is only overwritten once the producer has published once more
+        // and started the write after that (sequence + 3)
+        if (__atomic_load_n(&_seq, __ATOMIC_RELAXED) - seq < 3)
+          return;
+        __atomic_fetch_add(&_retries, 1, __ATOMIC_RELAXED);
+      }
+    }
+
+    uint32_t writes() const { return __atomic_load_n(&_seq, __ATOMIC_RELAXED) >> 1; }
+    uint32_t retries() const { return __atomic_load_n(&_retries, __ATOMIC_RELAXED); } // Number of torn reads detected and retried
+
+  private:
+    T _buffers[2];
+    uint32_t _seq;
+    mutable uint32_t _retries;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define __settingsMenu_h__
 
 #include "ubloxextensions.h"
+#include "logging.h"
 
 const int CONNECTIONSMENUID=10;
 const int NMEAMENUID=20;
@@ -10,157 +11,215 @@ const int GNSSMENUID=50;
 const int ABOUTMENUID=80;
 const int USBSETTINGSMENUID = CONNECTIONSMENUID+100;
 const int BLUETOOTHSETTINGSMENUID = CONNECTIONSMENUID+200;
-  MenuItem *gnssMenuItems[] =
+// Values shown in the menu. settingsValueText must list the text for each in the same order.
+enum SettingsValue : uint8_t
+{
+  VALUE_NONE,
+  VALUE_UNKNOWN,
+  VALUE_UNSET,
+  VALUE_SUBMENU,
+  VALUE_OFF,
+  VALUE_ON,
+  VALUE_DISABLED,
+  VALUE_ENABLED,
+  VALUE_OUTPUT_NMEA,
+  VALUE_OUTPUT_RTCM,
+  VALUE_OUTPUT_NMEA_RTCM,
+  VALUE_OUTPUT_USB,
+  VALUE_OUTPUT_BT,
+  VALUE_OUTPUT_USB_BT,
+  VALUE_NMEA_V21,
+  VALUE_NMEA_V23,
+  VALUE_NMEA_V40,
+  VALUE_NMEA_V41,
+  VALUE_NMEA_V411,
+  VALUE_NMEA_VUNKNOWN,
+  VALUE_RATE_1000,
+  VALUE_RATE_500,
+  VALUE_RATE_250,
+  VALUE_RATE_100,
+  VALUE_APP_VERSION,
+  VALUE_COUNT
+};
+const char* const settingsValueText[] =
+{
+  nullptr, "---", "--", ">", "Off", "On", "Disabled", "Enabled",
+  "NMEA", "RTCM", "NMEA+RTCM", "USB", "BT", "USB+BT",
+  "v2.1", "v2.3", "v4.0", "v4.1", "v4.11", "v?.?",
+  "1000 ms", "500 ms", "250 ms", "100 ms",
+  "1.0",
+};
+static_assert(sizeof(settingsValueText) / sizeof(settingsValueText[0]) == VALUE_COUNT, "settingsValueText doesn't match SettingsValue");
+
+// RAM for the values that can change. Everything else about the menu is constant.
+enum SettingsSlot : uint8_t
+{
+  SLOT_USB_OUTPUT,
+  SLOT_BT_OUTPUT,
+  SLOT_NMEA_VERSION,
+  SLOT_NMEA_HIGHPREC,
+  SLOT_NMEA_COMPAT,
+  SLOT_NMEA_LIMIT82,
+  SLOT_SBAS,
+  SLOT_RATE,
+  SLOT_PRIVACY,
+  SLOT_DEVICE_INFO_ROWS,
+  SLOT_NMEA_MESSAGES, // One per NMEA message, 13 in total
+  SLOT_COUNT = SLOT_NMEA_MESSAGES + 13
+};
+uint8_t settingsValues[SLOT_COUNT];
+
+  constexpr MenuItem gnssMenuItems[] =
+  {
+    MenuItem(GNSSMENUID + 6, "Rate", SLOT_RATE, VALUE_UNKNOWN),
+    MenuItem(GNSSMENUID + 5, "High Precision", MENU_NO_VALUE, VALUE_ON),
+    MenuItem(GNSSMENUID + 1, "GPS", MENU_NO_VALUE, VALUE_ENABLED),
+    MenuItem(GNSSMENUID + 2, "GLONASS", MENU_NO_VALUE, VALUE_ENABLED),
+    MenuItem(GNSSMENUID + 3, "Galileo", MENU_NO_VALUE, VALUE_ENABLED),
+    MenuItem(GNSSMENUID + 4, "Beidou", MENU_NO_VALUE, VALUE_ENABLED),
+  };
+  // The receiver's MON-VER strings, filled in by initSettingsMenu(). The rows past the versions
+  // are the extensions it reported.
+  constexpr MenuItem deviceInfoMenuItems[] =
   {
-    new MenuItem(GNSSMENUID + 6, "Rate", "---"),
-    new MenuItem(GNSSMENUID + 5, "High Precision", "On"),
-    new MenuItem(GNSSMENUID + 1, "GPS", "Enabled"),
-    new MenuItem(GNSSMENUID + 2, "GLONASS", "Enabled"),
-    new MenuItem(GNSSMENUID + 3, "Galileo", "Enabled"),
-    new MenuItem(GNSSMENUID + 4, "Beidou", "Enabled"),
+    MenuItem(0, "Hardware Version"),
+    MenuItem(0, minfo.hwVersion),
+    MenuItem(0, "Software Version"),
+    MenuItem(0, minfo.swVersion),
+    MenuItem(0, minfo.extension[0]),
+    MenuItem(0, minfo.extension[1]),
+    MenuItem(0, minfo.extension[2]),
+    MenuItem(0, minfo.extension[3]),
+    MenuItem(0, minfo.extension[4]),
+    MenuItem(0, minfo.extension[5]),
+    MenuItem(0, minfo.extension[6]),
+    MenuItem(0, minfo.extension[7]),
+    MenuItem(0, minfo.extension[8]),
+    MenuItem(0, minfo.extension[9]),
   };
-  MenuItem *aboutMenuItems[] =
+  constexpr MenuItem aboutMenuItems[] =
   {
-    new MenuItem(ABOUTMENUID + 1, "Version", "1.0"),
-    new MenuItem(ABOUTMENUID + 2, "Device Info"),
-    new MenuItem(ABOUTMENUID + 3, "Reset"),
-    new MenuItem(ABOUTMENUID + 4, "Privacy Mode", "Off"),
+    MenuItem(ABOUTMENUID + 1, "Version", MENU_NO_VALUE, VALUE_APP_VERSION),
+    MenuItem(ABOUTMENUID + 2, "Device Info", deviceInfoMenuItems, SLOT_DEVICE_INFO_ROWS, 4),
+    MenuItem(ABOUTMENUID + 3, "Reset"),
+    MenuItem(ABOUTMENUID + 4, "Privacy Mode", SLOT_PRIVACY, VALUE_OFF),
   };
-  MenuItem *connectionsMenuItems[] =
+  constexpr MenuItem connectionsMenuItems[] =
   {
-    new MenuItem(CONNECTIONSMENUID + 1, "USB", "---"),
-    new MenuItem(CONNECTIONSMENUID + 2, "Bluetooth", "---"),
+    MenuItem(CONNECTIONSMENUID + 1, "USB", SLOT_USB_OUTPUT, VALUE_UNKNOWN),
+    MenuItem(CONNECTIONSMENUID + 2, "Bluetooth", SLOT_BT_OUTPUT, VALUE_UNKNOWN),
   };
-  MenuItem *enabledNmeaMessagesItems[] = {    
-    new MenuItem(NMEAMSGMENUID, "GGA", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GGA_USB),
-    new MenuItem(NMEAMSGMENUID, "GLL", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GLL_USB),
-    new MenuItem(NMEAMSGMENUID, "GSA", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GSA_USB),
-    new MenuItem(NMEAMSGMENUID, "GSV", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GSV_USB),
-    new MenuItem(NMEAMSGMENUID, "RMC", "--", UBLOX_CFG_MSGOUT_NMEA_ID_RMC_USB),
-    new MenuItem(NMEAMSGMENUID, "VTG", "--", UBLOX_CFG_MSGOUT_NMEA_ID_VTG_USB),
-    new MenuItem(NMEAMSGMENUID, "GRS", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GRS_USB),
-    new MenuItem(NMEAMSGMENUID, "GST", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GST_USB),
-    new MenuItem(NMEAMSGMENUID, "ZDA", "--", UBLOX_CFG_MSGOUT_NMEA_ID_ZDA_USB),
-    new MenuItem(NMEAMSGMENUID, "GBS", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GBS_USB),
-    new MenuItem(NMEAMSGMENUID, "DTM", "--", UBLOX_CFG_MSGOUT_NMEA_ID_DTM_USB),
-    new MenuItem(NMEAMSGMENUID, "GNS", "--", UBLOX_CFG_MSGOUT_NMEA_ID_GNS_USB),
-    new MenuItem(NMEAMSGMENUID, "VLW", "--", UBLOX_CFG_MSGOUT_NMEA_ID_VLW_USB),
+  constexpr MenuItem enabledNmeaMessagesItems[] = {    
+    MenuItem(NMEAMSGMENUID, "GGA", SLOT_NMEA_MESSAGES + 0, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GGA_USB),
+    MenuItem(NMEAMSGMENUID, "GLL", SLOT_NMEA_MESSAGES + 1, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GLL_USB),
+    MenuItem(NMEAMSGMENUID, "GSA", SLOT_NMEA_MESSAGES + 2, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GSA_USB),
+    MenuItem(NMEAMSGMENUID, "GSV", SLOT_NMEA_MESSAGES + 3, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GSV_USB),
+    MenuItem(NMEAMSGMENUID, "RMC", SLOT_NMEA_MESSAGES + 4, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_RMC_USB),
+    MenuItem(NMEAMSGMENUID, "VTG", SLOT_NMEA_MESSAGES + 5, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_VTG_USB),
+    MenuItem(NMEAMSGMENUID, "GRS", SLOT_NMEA_MESSAGES + 6, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GRS_USB),
+    MenuItem(NMEAMSGMENUID, "GST", SLOT_NMEA_MESSAGES + 7, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GST_USB),
+    MenuItem(NMEAMSGMENUID, "ZDA", SLOT_NMEA_MESSAGES + 8, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_ZDA_USB),
+    MenuItem(NMEAMSGMENUID, "GBS", SLOT_NMEA_MESSAGES + 9, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GBS_USB),
+    MenuItem(NMEAMSGMENUID, "DTM", SLOT_NMEA_MESSAGES + 10, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_DTM_USB),
+    MenuItem(NMEAMSGMENUID, "GNS", SLOT_NMEA_MESSAGES + 11, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_GNS_USB),
+    MenuItem(NMEAMSGMENUID, "VLW", SLOT_NMEA_MESSAGES + 12, VALUE_UNSET, UBLOX_CFG_MSGOUT_NMEA_ID_VLW_USB),
   };
-    MenuItem *nmeaSettingsMenuItems[] =
+  constexpr MenuItem nmeaSettingsMenuItems[] =
   {
-    new MenuItem(NMEAMENUID + 1, "Version", "---"),
-    new MenuItem(NMEAMENUID + 2, "Messages", enabledNmeaMessagesItems, 13),
-    new MenuItem(NMEAMENUID + 3, "High Precision", "--"), // Enable high precision mode: CFG_NMEA_HIGHPREC  on/off
-    new MenuItem(NMEAMENUID + 4, "Compat Mode", "--"), // NMEA Compat mode: On/Off  CFG-NMEA-COMPAT (0x10930003)
-    new MenuItem(NMEAMENUID + 5, "Limit 82 chars", "--"), // Enable strict limit to 82 characters maximum NMEA message length: On/Off  - CFG-NMEA-LIMIT82 (0x10930005)
+    MenuItem(NMEAMENUID + 1, "Version", SLOT_NMEA_VERSION, VALUE_UNKNOWN),
+    MenuItem(NMEAMENUID + 2, "Messages", enabledNmeaMessagesItems),
+    MenuItem(NMEAMENUID + 3, "High Precision", SLOT_NMEA_HIGHPREC, VALUE_UNSET), // Enable high precision mode: CFG_NMEA_HIGHPREC  on/off
+    MenuItem(NMEAMENUID + 4, "Compat Mode", SLOT_NMEA_COMPAT, VALUE_UNSET), // NMEA Compat mode: On/Off  CFG-NMEA-COMPAT (0x10930003)
+    MenuItem(NMEAMENUID + 5, "Limit 82 chars", SLOT_NMEA_LIMIT82, VALUE_UNSET), // Enable strict limit to 82 characters maximum NMEA message length: On/Off  - CFG-NMEA-LIMIT82 (0x10930005)
   };
 
-  MenuItem *mainMenuItems[] =
+  constexpr MenuItem mainMenuItems[] =
   {
-    new MenuItem(1, "Outputs", connectionsMenuItems, 2),
-    new MenuItem(2, "NMEA", nmeaSettingsMenuItems, 5),
-    new MenuItem(3, "RTCM", ">"),
-    new MenuItem(4, "SBAS", "---"),
-    new MenuItem(5, "GNSS", gnssMenuItems, 6),
-    new MenuItem(6, "Info/About", aboutMenuItems, 4)
+    MenuItem(1, "Outputs", connectionsMenuItems),
+    MenuItem(2, "NMEA", nmeaSettingsMenuItems),
+    MenuItem(3, "RTCM", MENU_NO_VALUE, VALUE_SUBMENU),
+    MenuItem(4, "SBAS", SLOT_SBAS, VALUE_UNKNOWN),
+    MenuItem(5, "GNSS", gnssMenuItems),
+    MenuItem(6, "Info/About", aboutMenuItems)
   };
-Menu *menu = new Menu(new MenuItem(0, "Settings", mainMenuItems, 6));
-MenuItem *gpsInfoMenu[] =
-    {
-      new MenuItem(0, "Hardware Version"),
-      new MenuItem(0, "---"),
-      new MenuItem(0, "Software Version"),
-      new MenuItem(0, "---"),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-      new MenuItem(0, ""),
-    };
+constexpr MenuItem settingsMenuRoot(0, "Settings", mainMenuItems);
+Menu settingsMenu(&settingsMenuRoot, settingsValues, settingsValueText);
+Menu *menu = &settingsMenu;
+
+uint8_t outputValue(bool nmeaOn, bool rtcmOn)
+{
+  if(nmeaOn && rtcmOn)
+    return VALUE_OUTPUT_NMEA_RTCM;
+  else if(nmeaOn)
+    return VALUE_OUTPUT_NMEA;
+  else if(rtcmOn)
+    return VALUE_OUTPUT_RTCM;
+  return VALUE_OFF;
+}
+uint8_t messageOutputValue(bool usb, bool bt)
+{
+  if(usb && bt)
+    return VALUE_OUTPUT_USB_BT;
+  else if(usb)
+    return VALUE_OUTPUT_USB;
+  else if(bt)
+    return VALUE_OUTPUT_BT;
+  return VALUE_DISABLED;
+}
+// Receiver settings for the VALUE_NMEA_V21.. and VALUE_RATE_1000.. values, in enum order
+constexpr uint8_t nmeaVersions[] = { CFG_NMEA_PROTVER_V21, CFG_NMEA_PROTVER_V23, CFG_NMEA_PROTVER_V40, CFG_NMEA_PROTVER_V41, CFG_NMEA_PROTVER_V411 };
+constexpr uint16_t navigationRates[] = { 1000, 500, 250, 100 };
+uint8_t nmeaVersionValue(uint8_t nmeaVersion)
+{
+  for(uint8_t i = 0; i < sizeof(nmeaVersions); i++)
+    if(nmeaVersions[i] == nmeaVersion)
+      return VALUE_NMEA_V21 + i;
+  return VALUE_NMEA_VUNKNOWN;
+}
+uint8_t rateValue(uint16_t rate)
+{
+  for(uint8_t i = 0; i < sizeof(navigationRates) / sizeof(navigationRates[0]); i++)
+    if(navigationRates[i] == rate)
+      return VALUE_RATE_1000 + i;
+  return VALUE_UNKNOWN;
+}
+
 int initSettingsMenu(SFE_UBLOX_GNSS *gps)
 {
   auto sbas = gps->getVal8(CFG_SBAS_USE_DIFFCORR);
-  mainMenuItems[3]->setValue(sbas == 0 ? "Disabled" : "Enabled");
+  settingsMenu.setValue(&mainMenuItems[3], sbas == 0 ? VALUE_DISABLED : VALUE_ENABLED);
   auto frequency = gps->getVal16(UBLOX_CFG_RATE_MEAS);
-  gnssMenuItems[0]->setValue((String(frequency) + " ms").c_str());
+  settingsMenu.setValue(&gnssMenuItems[0], rateValue(frequency));
   for(uint8_t i = 0; i<13; i++) {
-    auto child = enabledNmeaMessagesItems[i];
+    auto child = &enabledNmeaMessagesItems[i];
     auto enabledUsb = gps->getVal8(child->getTag()) > 0;
     auto enabledBt = gps->getVal8(child->getTag() - 1) > 0;
-    auto state = "Disabled";
-    if(enabledUsb && enabledBt)
-       state = "USB+BT";
-    else if(enabledUsb)
-       state = "USB";
-    else if(enabledBt)
-       state = "BT";
-    child->setValue(state);
+    settingsMenu.setValue(child, messageOutputValue(enabledUsb, enabledBt));
   }
   //Get NMEA version
   uint8_t nmeaVersion = gps->getVal8(CFG_NMEA_PROTVER);
-  if(nmeaVersion == CFG_NMEA_PROTVER_V21)
-    nmeaSettingsMenuItems[0]->setValue("v2.1");
-  else if(nmeaVersion == CFG_NMEA_PROTVER_V23)
-    nmeaSettingsMenuItems[0]->setValue("v2.3");
-  else if(nmeaVersion == CFG_NMEA_PROTVER_V40)
-    nmeaSettingsMenuItems[0]->setValue("v4.0");
-  else if(nmeaVersion == CFG_NMEA_PROTVER_V41)
-    nmeaSettingsMenuItems[0]->setValue("v4.1");
-  else if(nmeaVersion == CFG_NMEA_PROTVER_V411)
-    nmeaSettingsMenuItems[0]->setValue("v4.11");
-  else 
-    nmeaSettingsMenuItems[0]->setValue("v?.?");
+  settingsMenu.setValue(&nmeaSettingsMenuItems[0], nmeaVersionValue(nmeaVersion));
 
-  nmeaSettingsMenuItems[2]->setValue(gps->getVal8(CFG_NMEA_HIGHPREC) ? "On" : "Off");
-  nmeaSettingsMenuItems[3]->setValue(gps->getVal8(CFG_NMEA_COMPAT) ? "On" : "Off");
-  nmeaSettingsMenuItems[4]->setValue(gps->getVal8(CFG_NMEA_LIMIT82) ? "On" : "Off");
+  settingsMenu.setValue(&nmeaSettingsMenuItems[2], gps->getVal8(CFG_NMEA_HIGHPREC) ? VALUE_ON : VALUE_OFF);
+  settingsMenu.setValue(&nmeaSettingsMenuItems[3], gps->getVal8(CFG_NMEA_COMPAT) ? VALUE_ON : VALUE_OFF);
+  settingsMenu.setValue(&nmeaSettingsMenuItems[4], gps->getVal8(CFG_NMEA_LIMIT82) ? VALUE_ON : VALUE_OFF);
   
   auto nmeaOn = gps->getVal8(CFG_USBOUTPROT_NMEA);
   auto rtcmOn = gps->getVal8(CFG_USBOUTPROT_RTCM3X);
-  if(nmeaOn && rtcmOn)
-    connectionsMenuItems[0]->setValue("NMEA+RTCM");
-  else if(nmeaOn)
-    connectionsMenuItems[0]->setValue("NMEA");
-  else if(rtcmOn)
-    connectionsMenuItems[0]->setValue("RTCM");
-  else
-    connectionsMenuItems[0]->setValue("Off");
-      
+  settingsMenu.setValue(&connectionsMenuItems[0], outputValue(nmeaOn, rtcmOn));
     
   nmeaOn = gps->getVal8(CFG_UART2OUTPROT_NMEA);
   rtcmOn = gps->getVal8(CFG_UART2OUTPROT_RTCM3X);
-  if(nmeaOn && rtcmOn)
-    connectionsMenuItems[1]->setValue("NMEA+RTCM");
-  else if(nmeaOn)
-    connectionsMenuItems[1]->setValue("NMEA");
-  else if(rtcmOn)
-    connectionsMenuItems[1]->setValue("RTCM");
-  else
-    connectionsMenuItems[1]->setValue("Off");
-  
-/*
-  int menuCount = 4;
+  settingsMenu.setValue(&connectionsMenuItems[1], outputValue(nmeaOn, rtcmOn));
+
   if(getModuleInfo(gps, 1100))
-  {
-    gpsInfoMenu[3]->setTitle(minfo.swVersion);
-    gpsInfoMenu[1]->setTitle(minfo.hwVersion);
-    for (int i = 0; i < minfo.extensionNo; i++)
-    {
-      gpsInfoMenu[4+i]->setTitle(minfo.extension[i]);
-    }
-    menuCount+=minfo.extensionNo;
-  }
+    settingsMenu.setValue(&aboutMenuItems[1], 4 + minfo.extensionNo);
   else
   {
-    gpsInfoMenu[3]->setTitle("N/A");
-    gpsInfoMenu[1]->setTitle("N/A");
+    strcpy(minfo.hwVersion, "N/A");
+    strcpy(minfo.swVersion, "N/A");
+    settingsMenu.setValue(&aboutMenuItems[1], 4);
   }
-  aboutMenuItems[1]->setChildren(gpsInfoMenu, menuCount);
-  */
 };
 int resetGps(SFE_UBLOX_GNSS *gps)
 {
@@ -173,215 +232,156 @@ int resetGps(SFE_UBLOX_GNSS *gps)
   gps->saveConfiguration(); //Save the current settings to flash and BBR
   initSettingsMenu(gps);
 }
-int processMenu(Menu *currentMenu, SFE_UBLOX_GNSS *gps)
+// What selecting a menu item does.
+// Toggle and cycle step the item's value to the next entry of 'values' (the first one if the
+// current value isn't in the list). A toggle writes 1 to the receiver setting 'key' for values[0]
+// and 0 otherwise. A cycle calls 'apply' to change the receiver. A command just calls 'apply'.
+// apply() returns the value that is in effect afterwards, which is oldValue if it failed.
+enum MenuActionType : uint8_t
 {
-  // Process menu if active
-    auto result = currentMenu->processMenu();
-    if(result == MENU_RESULT_EXIT)
-    {
-      return result;
-    }
-    else if(result == 4) // SBAS
-    {
-      uint8_t sbas = gps->getVal8(CFG_SBAS_USE_DIFFCORR);
-      if(sbas == 0)
-        sbas = 1;
-      else sbas = 0;
-      bool isok = gps->setVal8(CFG_SBAS_USE_DIFFCORR, sbas, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-      mainMenuItems[3]->setValue(sbas == 0 ? "Disabled" : "Enabled");
-      
-      /*if(item->getValue() == "Enabled")
-        item->setValue("Disabled");
-      else
-        item->setValue("Enabled");*/
-      currentMenu->refresh();
-    }
-    else if(result == CONNECTIONSMENUID + 1) // USB Output
-    {
-      auto item = currentMenu->selectedMenuItem();
-      bool nmeaOn = false;
-      bool rtcmOn = false;
-      if(item->getValue() == "NMEA") {
-        rtcmOn=true;
-      }     
-      else if(item->getValue() == "RTCM") {
-        rtcmOn=false;
-        nmeaOn=false;
-      }
-      else {
-        nmeaOn = true;
-      }    
-      gps->setVal8(CFG_USBOUTPROT_NMEA, nmeaOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-      gps->setVal8(CFG_USBOUTPROT_RTCM3X, rtcmOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-      if(nmeaOn && rtcmOn)
-        connectionsMenuItems[0]->setValue("NMEA+RTCM");
-      else if(nmeaOn)
-        connectionsMenuItems[0]->setValue("NMEA");
-      else if(rtcmOn)
-        connectionsMenuItems[0]->setValue("RTCM");
-      else if(!nmeaOn && !rtcmOn)
-        connectionsMenuItems[0]->setValue("Off");
-      currentMenu->refresh();
-    }
-    else if(result == CONNECTIONSMENUID + 2) // Bluetooth Output
-    {
-      auto item = currentMenu->selectedMenuItem();
-      bool nmeaOn = false;
-      bool rtcmOn = false;
-      if(item->getValue() == "NMEA") {
-        rtcmOn=true;
-      }
-      else if(item->getValue() == "RTCM") {
-        rtcmOn=false;
-        nmeaOn=false;
-      }
-      else {
-        nmeaOn = true;
-      }    
-      gps->setVal8(CFG_UART2OUTPROT_NMEA, nmeaOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-      gps->setVal8(CFG_UART2OUTPROT_RTCM3X, rtcmOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-      if(nmeaOn && rtcmOn)
-        connectionsMenuItems[1]->setValue("NMEA+RTCM");
-      else if(nmeaOn)
-        connectionsMenuItems[1]->setValue("NMEA");
-      else if(rtcmOn)
-        connectionsMenuItems[1]->setValue("RTCM");
-      else if(!nmeaOn && !rtcmOn)
-        connectionsMenuItems[1]->setValue("Off");
-      currentMenu->refresh();
-    }
-    else if(result == GNSSMENUID + 6) // Navigation rate
-    {
-       auto item = currentMenu->selectedMenuItem();
-       uint16_t value = 1000;
-       if(item->getValue() == "1000 ms")   
-         value = 500;
-       else if(item->getValue() == "500 ms")
-         value = 250;         
-       else if(item->getValue() == "250 ms")
-         value = 100;        
-       else if(item->getValue() == "100 ms")
-         value = 1000;
-       gps->setVal16(UBLOX_CFG_RATE_MEAS, value, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
-       item->setValue((String(value) + " ms").c_str());
-       currentMenu->refresh();
-    }
-    else if(result == NMEAMENUID + 1) // NMEA Version
-    {
-      auto value = nmeaSettingsMenuItems[0]->getValue();
-      uint8_t nmeaVersion = gps->getVal8(CFG_NMEA_PROTVER);      
-      if(value == "v2.1")
-        nmeaVersion = CFG_NMEA_PROTVER_V23;
-      else if(value == "v2.3")
-        nmeaVersion = CFG_NMEA_PROTVER_V40;
-      else if(value == "v4.0")
-        nmeaVersion = CFG_NMEA_PROTVER_V41;
-      else if(value == "v4.1")
-        nmeaVersion = CFG_NMEA_PROTVER_V411;
-      else if(value == "v4.11")
-        nmeaVersion = CFG_NMEA_PROTVER_V21;
-      if(gps->setVal(CFG_NMEA_PROTVER, nmeaVersion, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
-      {
-        if(nmeaVersion == CFG_NMEA_PROTVER_V21)
-          nmeaSettingsMenuItems[0]->setValue("v2.1");
-        else if(nmeaVersion == CFG_NMEA_PROTVER_V23)
-          nmeaSettingsMenuItems[0]->setValue("v2.3");
-        else if(nmeaVersion == CFG_NMEA_PROTVER_V40)
-          nmeaSettingsMenuItems[0]->setValue("v4.0");
-        else if(nmeaVersion == CFG_NMEA_PROTVER_V41)
-          nmeaSettingsMenuItems[0]->setValue("v4.1");
-        else if(nmeaVersion == CFG_NMEA_PROTVER_V411)
-          nmeaSettingsMenuItems[0]->setValue("v4.11");
-        currentMenu->refresh();
-      }
-    }
-    else if(result == NMEAMENUID + 3) // NMEA high precision
-    {      
-      auto item = currentMenu->selectedMenuItem();
-      bool isOn = item->getValue() == "On";
-      if(gps->setVal8(CFG_NMEA_HIGHPREC, isOn ? 0 : 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
-      {
-        item->setValue(isOn ? "Off" : "On");
-        currentMenu->refresh();
-      }
-    }
-    else if(result == NMEAMENUID + 4) // NMEA Compat
-    {
-      auto item = currentMenu->selectedMenuItem();
-      bool isOn = item->getValue() == "On";
-      if(gps->setVal8(CFG_NMEA_COMPAT, isOn ? 0 : 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
-      {
-        item->setValue(isOn ? "Off" : "On");
-        currentMenu->refresh();
-      }
-    }
-    else if(result == NMEAMENUID + 5) // NMEA max 82 chars
-    {
-      auto item = currentMenu->selectedMenuItem();
-      bool isOn = item->getValue() == "On";
-      if(gps->setVal8(CFG_NMEA_LIMIT82, isOn ? 0 : 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
-      {
-        item->setValue(isOn ? "Off" : "On");
-        currentMenu->refresh();
-      }
-    }
-    else if(result == NMEAMSGMENUID) // NMEA message toggles
-    {
-      auto item = currentMenu->selectedMenuItem();
-      uint32_t messageid = item->getTag();
-      auto value = item->getValue();
-      bool enabledUsb = (value == "USB" || value == "USB+BT");
-      bool enabledBt = (value == "BT" || value == "USB+BT");
-      bool newUsb = enabledUsb;
-      bool newBt = enabledBt;
-      if(enabledUsb && enabledBt) {
-        newUsb = false;
-        newBt = true;
-      }
-      else if(enabledUsb) {
-        newUsb = true;
-        newBt = true;
-      }      
-      else if(enabledBt) {
-        newBt = false;
-      }
-      else {
-        newUsb = true;
-      }
-      bool isok = gps->setVal8(messageid, newUsb ? 0 : 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);// USB
-      if(!isok)
-         newUsb = enabledUsb;
-      bool isok2 = gps->setVal8(messageid - 1, newBt ? 0 : 1, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);// UART2/Bluetooth is 1 less on id
-      if(!isok2)
-         newBt = enabledBt;
-      if(isok || isok2)
-      {
-        auto state = "Disabled";
-        if(newUsb && newBt)
-          state = "USB+BT";
-        else if(newUsb)
-          state = "USB";
-        else if(newBt)
-          state = "BT";
-        item->setValue(state);
-        currentMenu->refresh();
-      }
-    }
-  
-    else if(result == ABOUTMENUID + 3) // Reset
-    {
-      resetGps(gps);
-    }
-    else if(result == ABOUTMENUID + 4) // toggle privacy mode
-    {
-      privacy = !privacy;
-      auto item = currentMenu->selectedMenuItem();
-      item->setValue(privacy ? "On" : "Off");
-      currentMenu->refresh();
-    }
-    else if(result > 0) {
-      Serial.println("UNKNOWN MENU ID: " + String(result));
-    }
+  ACTION_TOGGLE,
+  ACTION_CYCLE,
+  ACTION_COMMAND,
+};
+typedef uint8_t (*MenuActionApply)(SFE_UBLOX_GNSS *gps, const MenuItem *item, uint8_t oldValue, uint8_t newValue);
+struct MenuAction
+{
+  int16_t id;
+  MenuActionType type;
+  const uint8_t *values;
+  uint8_t valueCount;
+  uint32_t key;
+  MenuActionApply apply;
+};
+template<size_t N>
+constexpr MenuAction toggleAction(int16_t id, uint32_t key, const uint8_t (&values)[N]) { return { id, ACTION_TOGGLE, values, N, key, nullptr }; }
+template<size_t N>
+constexpr MenuAction cycleAction(int16_t id, const uint8_t (&values)[N], MenuActionApply apply) { return { id, ACTION_CYCLE, values, N, 0, apply }; }
+constexpr MenuAction commandAction(int16_t id, MenuActionApply apply) { return { id, ACTION_COMMAND, nullptr, 0, 0, apply }; }
+
+uint8_t setOutputProtocols(SFE_UBLOX_GNSS *gps, uint32_t nmeaKey, uint32_t rtcmKey, uint8_t newValue)
+{
+  bool nmeaOn = newValue == VALUE_OUTPUT_NMEA || newValue == VALUE_OUTPUT_NMEA_RTCM;
+  bool rtcmOn = newValue == VALUE_OUTPUT_RTCM || newValue == VALUE_OUTPUT_NMEA_RTCM;
+  gps->setVal8(nmeaKey, nmeaOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  gps->setVal8(rtcmKey, rtcmOn ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  return newValue;
+}
+uint8_t applyUsbOutput(SFE_UBLOX_GNSS *gps, const MenuItem *, uint8_t, uint8_t newValue)
+{
+  return setOutputProtocols(gps, CFG_USBOUTPROT_NMEA, CFG_USBOUTPROT_RTCM3X, newValue);
+}
+uint8_t applyBluetoothOutput(SFE_UBLOX_GNSS *gps, const MenuItem *, uint8_t, uint8_t newValue)
+{
+  return setOutputProtocols(gps, CFG_UART2OUTPROT_NMEA, CFG_UART2OUTPROT_RTCM3X, newValue);
+}
+uint8_t applyRate(SFE_UBLOX_GNSS *gps, const MenuItem *, uint8_t, uint8_t newValue)
+{
+  gps->setVal16(UBLOX_CFG_RATE_MEAS, navigationRates[newValue - VALUE_RATE_1000], VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR);
+  return newValue;
+}
+uint8_t applyNmeaVersion(SFE_UBLOX_GNSS *gps, const MenuItem *, uint8_t oldValue, uint8_t newValue)
+{
+  if(gps->setVal(CFG_NMEA_PROTVER, nmeaVersions[newValue - VALUE_NMEA_V21], VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
+    return newValue;
+  return oldValue;
+}
+// The item's tag is the message's USB output key. UART2/Bluetooth is 1 less.
+uint8_t applyMessageOutput(SFE_UBLOX_GNSS *gps, const MenuItem *item, uint8_t oldValue, uint8_t newValue)
+{
+  uint32_t messageid = item->getTag();
+  bool enabledUsb = (oldValue == VALUE_OUTPUT_USB || oldValue == VALUE_OUTPUT_USB_BT);
+  bool enabledBt = (oldValue == VALUE_OUTPUT_BT || oldValue == VALUE_OUTPUT_USB_BT);
+  bool newUsb = (newValue == VALUE_OUTPUT_USB || newValue == VALUE_OUTPUT_USB_BT);
+  bool newBt = (newValue == VALUE_OUTPUT_BT || newValue == VALUE_OUTPUT_USB_BT);
+  if(!gps->setVal8(messageid, newUsb ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
+    newUsb = enabledUsb;
+  if(!gps->setVal8(messageid - 1, newBt ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
+    newBt = enabledBt;
+  return messageOutputValue(newUsb, newBt);
+}
+uint8_t applyPrivacy(SFE_UBLOX_GNSS *, const MenuItem *, uint8_t, uint8_t newValue)
+{
+  privacy = newValue == VALUE_ON;
+  return newValue;
+}
+uint8_t resetCommand(SFE_UBLOX_GNSS *gps, const MenuItem *, uint8_t oldValue, uint8_t)
+{
+  resetGps(gps);
+  return oldValue;
+}
+
+constexpr uint8_t onOffValues[] = { VALUE_ON, VALUE_OFF };
+constexpr uint8_t enabledValues[] = { VALUE_ENABLED, VALUE_DISABLED };
+constexpr uint8_t outputValues[] = { VALUE_OUTPUT_NMEA, VALUE_OUTPUT_RTCM, VALUE_OFF };
+constexpr uint8_t messageOutputValues[] = { VALUE_OUTPUT_USB, VALUE_OUTPUT_USB_BT, VALUE_OUTPUT_BT, VALUE_DISABLED };
+constexpr uint8_t rateValues[] = { VALUE_RATE_1000, VALUE_RATE_500, VALUE_RATE_250, VALUE_RATE_100 };
+constexpr uint8_t nmeaVersionValues[] = { VALUE_NMEA_V21, VALUE_NMEA_V23, VALUE_NMEA_V40, VALUE_NMEA_V41, VALUE_NMEA_V411 };
+
+constexpr MenuAction menuActions[] =
+{
+  toggleAction(4, CFG_SBAS_USE_DIFFCORR, enabledValues),
+  cycleAction(CONNECTIONSMENUID + 1, outputValues, applyUsbOutput),
+  cycleAction(CONNECTIONSMENUID + 2, outputValues, applyBluetoothOutput),
+  cycleAction(GNSSMENUID + 6, rateValues, applyRate),
+  cycleAction(NMEAMENUID + 1, nmeaVersionValues, applyNmeaVersion),
+  toggleAction(NMEAMENUID + 3, CFG_NMEA_HIGHPREC, onOffValues),
+  toggleAction(NMEAMENUID + 4, CFG_NMEA_COMPAT, onOffValues),
+  toggleAction(NMEAMENUID + 5, CFG_NMEA_LIMIT82, onOffValues),
+  cycleAction(NMEAMSGMENUID, messageOutputValues, applyMessageOutput),
+  commandAction(ABOUTMENUID + 3, resetCommand),
+  cycleAction(ABOUTMENUID + 4, onOffValues, applyPrivacy),
+};
+
+const MenuAction* findMenuAction(int id)
+{
+  for(uint8_t i = 0; i < sizeof(menuActions) / sizeof(menuActions[0]); i++)
+    if(menuActions[i].id == id)
+      return &menuActions[i];
+  return nullptr;
+}
+uint8_t nextMenuValue(const MenuAction *action, uint8_t value)
+{
+  for(uint8_t i = 0; i < action->valueCount; i++)
+    if(action->values[i] == value)
+      return action->values[(i + 1) % action->valueCount];
+  return action->values[0];
+}
+
+int processMenu(Menu *currentMenu, SFE_UBLOX_GNSS *gps, const ButtonEvent &event)
+{
+  auto result = currentMenu->processMenu(event);
+  if(result <= 0)
+    return result;
+  const MenuAction *action = findMenuAction(result);
+  if(action == nullptr)
+  {
+    LOG_ERROR("UNKNOWN MENU ID: ", result);
+    return result;
   }
+  auto item = currentMenu->selectedMenuItem();
+  uint8_t oldValue = currentMenu->getValue(item);
+  uint8_t newValue = oldValue;
+  switch(action->type)
+  {
+    case ACTION_TOGGLE:
+      newValue = nextMenuValue(action, oldValue);
+      if(!gps->setVal8(action->key, newValue == action->values[0] ? 1 : 0, VAL_LAYER_FLASH + VAL_LAYER_RAM + VAL_LAYER_BBR))
+        newValue = oldValue;
+      break;
+    case ACTION_CYCLE:
+      newValue = action->apply(gps, item, oldValue, nextMenuValue(action, oldValue));
+      break;
+    case ACTION_COMMAND:
+      action->apply(gps, item, oldValue, oldValue);
+      break;
+  }
+  if(newValue != oldValue)
+  {
+    currentMenu->setValue(item, newValue);
+    currentMenu->refresh();
+  }
+  return result;
+}
 
 #endif
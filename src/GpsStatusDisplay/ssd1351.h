@@ -0,0 +1,55 @@
+#ifndef __ssd1351_h__
+#define __ssd1351_h__
+
+#include <Ucglib.h> //http://librarymanager/All#Ucglib
+
+// Direct access to the SSD1351 controller through Ucglib's communication layer,
+// for pushing blocks of pixels without going through Ucglib's per-pixel drawing.
+
+// SSD1351 commands
+#define SSD1351_SET_COLUMN 0x15
+#define SSD1351_SET_ROW 0x75
+#define SSD1351_WRITE_RAM 0x5C
+#define SSD1351_WINDOW_BYTES 7 // Bytes sent to open an address window: 3 commands + 4 arguments
+#define SSD1351_BYTES_PER_PIXEL 3 // Panel is driven in 18 bit (6:6:6) color mode
+
+inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+  return ((uint16_t)(r & 0xF8) << 8) | ((uint16_t)(g & 0xFC) << 3) | (b >> 3);
+}
+
+// Open an address window on the panel and leave it ready to receive pixel data
+void ssd1351SetWindow(ucg_t *ucg, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+  ucg_com_SetCSLineStatus(ucg, 0);
+  ucg_com_SetCDLineStatus(ucg, 0);
+  ucg_com_SendByte(ucg, SSD1351_SET_COLUMN);
+  ucg_com_SetCDLineStatus(ucg, 1);
+  ucg_com_SendByte(ucg, x0);
+  ucg_com_SendByte(ucg, x1);
+  ucg_com_SetCDLineStatus(ucg, 0);
+  ucg_com_SendByte(ucg, SSD1351_SET_ROW);
+  ucg_com_SetCDLineStatus(ucg, 1);
+  ucg_com_SendByte(ucg, y0);
+  ucg_com_SendByte(ucg, y1);
+  ucg_com_SetCDLineStatus(ucg, 0);
+  ucg_com_SendByte(ucg, SSD1351_WRITE_RAM);
+  ucg_com_SetCDLineStatus(ucg, 1);
+}
+
+// Convert RGB565 pixels to the panel's 6:6:6 format. 'out' must hold count * 3 bytes.
+void ssd1351PackPixels(const uint16_t *pixels, uint16_t count, uint8_t *out)
+{
+  for(uint16_t i = 0; i < count; i++)
+  {
+    uint16_t c = pixels[i];
+    uint8_t r = c >> 11;
+    uint8_t g = (c >> 5) & 0x3F;
+    uint8_t b = c & 0x1F;
+    *out++ = (r << 1) | (r >> 4);
+    *out++ = g;
+    *out++ = (b << 1) | (b >> 4);
+  }
+}
+
+#endif
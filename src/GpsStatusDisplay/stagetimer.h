@@ -0,0 +1,141 @@
+#ifndef __stagetimer_h__
+#define __stagetimer_h__
+
+#include <Arduino.h>
+
+// Time spent in the hot stages of the loop, per call: I2C bus transfers, parsing the received
+// bytes, decoding complete UBX packets, running the callbacks, rendering a frame and handling a
+// menu button. Each stage keeps the number of calls, min/avg/max and a histogram with one bucket
+// per power of two microseconds. printStageTimes() dumps them, the diagnostics page shows them.
+// The library and Menu.cpp are compiled on their own, so the switch has to reach them too:
+// build with -DSTAGE_TIMING or uncomment the line below. Without it the STAGE_TIMER() scopes and
+// all functions compile to nothing.
+//#define STAGE_TIMING
+
+// Time source: the DWT cycle counter on the Cortex-M4 (one CPU cycle, costs a single load),
+// the steady clock on the host (ns) and micros() everywhere else
+#if defined(__SAMD51__)
+#define STAGE_TICKS_PER_US (F_CPU / 1000000)
+#elif defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+#include <chrono>
+#define STAGE_TICKS_PER_US 1000
+#else
+#define STAGE_TICKS_PER_US 1
+#endif
+
+enum Stage : uint8_t
+{
+  STAGE_I2C,       // One I2C read from the receiver (requestFrom())
+  STAGE_PARSE,     // process() over the bytes of one I2C or serial read, including STAGE_DECODE
+  STAGE_DECODE,    // processUBXpacket() of one complete packet
+  STAGE_CALLBACKS, // checkCallbacks()
+  STAGE_RENDER,    // showDisplay()
+  STAGE_MENU,      // Menu::processMenu() of one button event
+  STAGE_COUNT
+};
+
+// Bucket 0 holds calls under 1us, bucket i those from 2^(i-1) to 2^i us, the last one the rest
+#define STAGE_HISTOGRAM_BUCKETS 16
+
+struct StageTimes
+{
+  uint32_t count;
+  uint32_t minTicks;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint32_t buckets[STAGE_HISTOGRAM_BUCKETS];
+
+  void add(uint32_t ticks)
+  {
+    if(count == 0 || ticks < minTicks)
+      minTicks = ticks;
+    if(ticks > maxTicks)
+      maxTicks = ticks;
+    count++;
+    totalTicks += ticks;
+    uint32_t us = ticks / STAGE_TICKS_PER_US;
+    uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    buckets[bucket < STAGE_HISTOGRAM_BUCKETS ? bucket : STAGE_HISTOGRAM_BUCKETS - 1]++;
+  };
+  uint32_t minMicros() const { return minTicks / STAGE_TICKS_PER_US; };
+  uint32_t avgMicros() const { return count > 0 ? (uint32_t)(totalTicks / count / STAGE_TICKS_PER_US) : 0; };
+  uint32_t maxMicros() const { return maxTicks / STAGE_TICKS_PER_US; };
+};
+
+#ifdef STAGE_TIMING
+
+// Shared by all translation units: a function's static is defined once even when inlined
+inline StageTimes *stageTimes()
+{
+  static StageTimes times[STAGE_COUNT];
+  return times;
+}
+
+#if defined(__SAMD51__)
+inline void beginStageTiming()
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+inline uint32_t stageTicks() { return DWT->CYCCNT; }
+#elif STAGE_TICKS_PER_US == 1000
+inline void beginStageTiming() { }
+inline uint32_t stageTicks()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+inline void beginStageTiming() { }
+inline uint32_t stageTicks() { return micros(); }
+#endif
+
+// Adds the time from its construction to the end of the enclosing block to a stage
+class StageTimer
+{
+  public:
+    StageTimer(Stage stage) : _stage(stage), _start(stageTicks()) { };
+    ~StageTimer() { stageTimes()[_stage].add(stageTicks() - _start); };
+
+  private:
+    Stage _stage;
+    uint32_t _start;
+};
+#define STAGE_TIMER(stage) StageTimer stageTimer_##stage(stage)
+
+inline const char *stageName(uint8_t stage)
+{
+  static const char *names[STAGE_COUNT] = { "i2c", "parse", "decode", "callback", "render", "menu" };
+  return names[stage];
+}
+
+inline void printStageTimes(Print &out)
+{
+  for(uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    const StageTimes &times = stageTimes()[i];
+    out.print(stageName(i));
+    out.print(" count:");
+    out.print(times.count);
+    out.print(" min:");
+    out.print(times.minMicros());
+    out.print("us avg:");
+    out.print(times.avgMicros());
+    out.print("us max:");
+    out.print(times.maxMicros());
+    out.print("us histogram:");
+    for(uint8_t b = 0; b < STAGE_HISTOGRAM_BUCKETS; b++)
+    {
+      out.print(' ');
+      out.print(times.buckets[b]);
+    }
+    out.println();
+  }
+}
+#else
+#define STAGE_TIMER(stage) do { } while(0)
+inline void beginStageTiming() { }
+inline void printStageTimes(Print &) { }
+#endif
+
+#endif
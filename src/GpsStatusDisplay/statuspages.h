@@ -4,6 +4,8 @@
 #include <Ucglib.h> //http://librarymanager/All#Ucglib
 #include "bitmaps.h"
 #include "drawhelpers.h"
+#include "textfield.h"
+#include "compass.h"
 
 bool privacy = false; // set to true to limit location precision for privacy (good for screenshots)
 
@@ -18,7 +20,8 @@ void writeDop(float dop, uint8_t y)
       ucg.setColor(0, 255, 0);  
     else
       ucg.setColor(255, 0, 0);  
-    drawString(0, y, String(dop), true);
+    TextBuffer<8> text;
+    drawString(0, y, text.appendFloat(dop, 2).c_str(), true);
   }
 }
 
@@ -44,20 +47,17 @@ void drawPage_ErrorInfo(bool newPage)
     ucg.setFont(ucg_font_helvR10_hr);
     ucg.setColor(255, 255, 255);
   }
-  drawStringCenter(getLineHeight() * 2, ("  " + mode() + "  ").c_str());
-  if(isnan(horizontalError()))
-     drawString(0, 4 * fontHeight,"---",true);
-  else
-     drawString(0, 4 * fontHeight,String(horizontalError(), 3) + "m",true);
-  if(isnan(verticalError()))
-     drawString(0, 5 * fontHeight,"---",true);
-  else
-     drawString(0, 5 * fontHeight, String(verticalError(), 3) + "m",true);
+  TextBuffer<24> text("  ");
+  drawStringCenter(getLineHeight() * 2, text.append(mode()).append("  ").c_str());
+  drawString(0, 4 * fontHeight, text.clear().appendMeasure(horizontalError(), 3, "m").c_str(), true);
+  drawString(0, 5 * fontHeight, text.clear().appendMeasure(verticalError(), 3, "m").c_str(), true);
+  if(renderScheduler.deferNonCritical())
+    return;
   writeDop(hdop(), 7 * fontHeight);
   writeDop(vdop(), 8 * fontHeight);
   writeDop(pdop(), 9 * fontHeight);
 }
-float lastCourse;
+CompassWidget compass(/*cx=*/ 40, /*cy=*/ 50, /*radius=*/ 24);
 void drawPage_NavigationInfo(bool newPage)
 { 
   ucg.setFontMode(UCG_FONT_MODE_SOLID);
@@ -68,23 +68,10 @@ void drawPage_NavigationInfo(bool newPage)
     currentCourse = 0;
     isValid = false;
   }
-  if(newPage || lastCourse != currentCourse)
+  if(newPage)
   {
-    // Redraw compass
-    if(!newPage){
-      ucg.setColor(0, 0, 0);
-      ucg.drawBox(1, 12, 75, 75);
-      ucg.setColor(255, 255, 255);
-    }
-    if(isValid)
-      lastCourse = currentCourse;
-    
-    ucg.setFont(ucg_font_helvR08_hr);
-    int const cx = 40;
-    int const cy = 50;
-    int const radius = 24;
+    // Arrow in the middle of the compass never moves
     float scale = 1.5;
-    ucg.drawCircle(cx, cy, radius, UCG_DRAW_ALL);
     int const dx = 24;
     int const dy = 33;
     ucg.drawLine(dx + 11 * scale, dy + 0 * scale,   dx + 17 * scale, dy + 11 * scale);
@@ -95,35 +82,18 @@ void drawPage_NavigationInfo(bool newPage)
     ucg.drawLine(dx + 8 * scale,  dy + 23 * scale,  dx + 8 * scale,  dy + 11 * scale);
     ucg.drawLine(dx + 8 * scale,  dy + 11 * scale,  dx + 5 * scale,  dy + 11 * scale);
     ucg.drawLine(dx + 5 * scale,  dy + 11 * scale,  dx + 11 * scale, dy + 0 * scale);
-    float c = currentCourse / 180.0 * M_PI;
-    float sn = sin(c);
-    float cn = cos(c);  
-    int const charoffset = radius+9;
-    ucg.drawLine(sn * (radius-2) + cx, cn * (radius-2) + cy, sn * (radius+3) + cx, cn * (radius+3) + cy);
-    drawStringCenterCenter(sn * charoffset + cx, cn * charoffset + cy, "S");  
-    
-    sn = sin(c + M_PI/2);
-    cn = cos(c + M_PI/2);  
-    ucg.drawLine(sn * (radius-2) + cx, cn * (radius-2) + cy, sn * (radius+3) + cx, cn * (radius+3) + cy);
-    drawStringCenterCenter(sn * charoffset + cx, cn * charoffset + cy, "E");
-
-    sn = sin(c + M_PI*2/2);
-    cn = cos(c + M_PI*2/2);  
-    ucg.drawLine(sn * (radius-2) + cx, cn * (radius-2) + cy, sn * (radius+3) + cx, cn * (radius+3) + cy);
-    drawStringCenterCenter(sn * charoffset + cx, cn * charoffset + cy, "N");
-  
-    sn = sin(c + M_PI*3/2);
-    cn = cos(c + M_PI*3/2);
-    ucg.drawLine(sn * (radius-2) + cx, cn * (radius-2) + cy, sn * (radius+3) + cx, cn * (radius+3) + cy);
-    drawStringCenterCenter(sn * charoffset + cx, cn * charoffset + cy, "W");
   }
+  compass.draw(newPage, currentCourse);
+  ucg.setColor(255, 255, 255);
+  ucg.setFont(ucg_font_helvR08_hr);
   // Speed+Course
   drawString(84, 30, "Course");
   drawString(0, 110, "Speed");
   ucg.setFont(ucg_font_helvR14_hr);
   if(isValid)
-  {   drawString(80, 53, String(currentCourse,0) + "°");
-      drawString(40, 110, String(speed(),1) + "kn");
+  {   TextBuffer<12> text;
+      drawString(80, 53, text.appendFloat(currentCourse, 0).append("°").c_str());
+      drawString(40, 110, text.clear().appendFloat(speed(), 1).append("kn").c_str());
   }
   else
   {
@@ -132,8 +102,18 @@ void drawPage_NavigationInfo(bool newPage)
   }
 }
 
+TextField latitudeField;
+TextField longitudeField;
+TextField altitudeField;
+TextField timeField;
 void drawPage_LocationInfo(bool newPage)
 { 
+  if(newPage) {
+    latitudeField.invalidate();
+    longitudeField.invalidate();
+    altitudeField.invalidate();
+    timeField.invalidate();
+  }
   ucg.setFontMode(UCG_FONT_MODE_SOLID);
   ucg.setColor(255, 255, 255);
   ucg.setFont(ucg_font_helvR14_hr);
@@ -147,19 +127,19 @@ void drawPage_LocationInfo(bool newPage)
     decimals = 6;
   else 
     decimals = 5;
-  String lat;
-  String lon;
+  TextBuffer<24> lat;
+  TextBuffer<24> lon;
   auto _latitude = latitude();
   auto _longitude = longitude();
   if(privacy)
   {
     decimals = 2; 
-    lat = String(_latitude, decimals) + "*****" + latIndicator();
-    lon = String(_longitude, decimals) + "*****" + lonIndicator();
+    lat.appendFloat(_latitude, decimals).append("*****").append(latIndicator());
+    lon.appendFloat(_longitude, decimals).append("*****").append(lonIndicator());
   }
   else {
-    lat = String(_latitude, decimals) + "°" + latIndicator();
-    lon = String(_longitude, decimals) + "°" + lonIndicator();
+    lat.appendFloat(_latitude, decimals).append("°").append(latIndicator());
+    lon.appendFloat(_longitude, decimals).append("°").append(lonIndicator());
   }
   auto zerror = verticalError();
   if(zerror < 0.05)
@@ -171,20 +151,21 @@ void drawPage_LocationInfo(bool newPage)
   else 
    decimals = 0;
   auto altitude = elevation();
-  auto z = String(altitude, decimals) + "m";
+  TextBuffer<16> z;
+  z.appendMeasure(altitude, decimals, "m");
   if(isnan(_latitude))
-    lat = "---";
+    lat.clear().append("---");
   if(isnan(_longitude))
-    lon = "---";
-  if(isnan(altitude))
-    z = "---";
-  drawStringCenter(37, lat.c_str());
-  drawStringCenter(64, lon.c_str());
-  drawStringCenter(91, z.c_str());  
-  drawStringCenter(118 ,gpstime().c_str());
+    lon.clear().append("---");
+  // Only the glyphs that changed since the last epoch are redrawn
+  latitudeField.drawCenter(ucg_font_helvR14_hr, 37, lat.c_str());
+  longitudeField.drawCenter(ucg_font_helvR14_hr, 64, lon.c_str());
+  altitudeField.drawCenter(ucg_font_helvR14_hr, 91, z.c_str());  
+  if(!renderScheduler.deferNonCritical())
+    timeField.drawCenter(ucg_font_helvR14_hr, 118, gpstime());
 
   if(newPage) {
-    drawBitmap(0, 80, 12, 10, mountainBitmap, 255, 255, 255);
+    drawBitmap(0, 80, mountainBitmapPacked, 255, 255, 255);
     ucg.setColor(255, 255, 255);
     ucg.drawCircle(6, 112, 6, UCG_DRAW_ALL);
     ucg.drawHLine(6,112,3);
@@ -192,4 +173,107 @@ void drawPage_LocationInfo(bool newPage)
    }
 }
 
+#ifdef STAGE_TIMING
+#define STAGE_TIMES_PAGE 3
+
+// Right aligned number ending at x, clearing the cell first since the width changes
+void drawStageValue(int x, int y, uint32_t value)
+{
+  ucg.setColor(0, 0, 0);
+  ucg.drawBox(x - 27, y - 8, 27, 10);
+  ucg.setColor(255, 255, 255);
+  TextBuffer<12> text;
+  drawString(128 - x, y, text.appendUInt(value, 1).c_str(), true);
+}
+
+// Hidden diagnostics page: min/avg/max of each stage in us, with its histogram below, one bar
+// per power of two us, scaled to the fullest bucket
+void drawPage_StageTimes(bool newPage)
+{
+  ucg.setFont(ucg_font_helvR08_hr);
+  ucg.setFontMode(UCG_FONT_MODE_SOLID);
+  if(newPage)
+  {
+    ucg.setColor(255, 255, 0);
+    drawString(0, 21, "us");
+    drawString(56, 21, "min", true);
+    drawString(28, 21, "avg", true);
+    drawString(0, 21, "max", true);
+    for(uint8_t i = 0; i < STAGE_COUNT; i++)
+      drawString(0, 32 + 17 * i, stageName(i));
+  }
+  for(uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    const StageTimes &times = stageTimes()[i];
+    int y = 32 + 17 * i;
+    drawStageValue(72, y, times.minMicros());
+    drawStageValue(100, y, times.avgMicros());
+    drawStageValue(128, y, times.maxMicros());
+  }
+  if(renderScheduler.deferNonCritical())
+    return;
+  for(uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    const StageTimes &times = stageTimes()[i];
+    uint32_t fullest = 1;
+    for(uint8_t b = 0; b < STAGE_HISTOGRAM_BUCKETS; b++)
+      fullest = times.buckets[b] > fullest ? times.buckets[b] : fullest;
+    int bottom = 32 + 17 * i + 8;
+    for(uint8_t b = 0; b < STAGE_HISTOGRAM_BUCKETS; b++)
+    {
+      uint8_t height = times.buckets[b] == 0 ? 0 : 1 + (uint64_t)times.buckets[b] * 5 / fullest;
+      if(height < 6)
+      {
+        ucg.setColor(0, 0, 0);
+        ucg.drawBox(b * 8, bottom - 6, 7, 6 - height);
+      }
+      if(height > 0)
+      {
+        ucg.setColor(0, 255, 0);
+        ucg.drawBox(b * 8, bottom - height, 7, height);
+      }
+    }
+  }
+}
+#endif
+
+#ifdef LINK_STATS
+#define LINK_STATS_PAGE 4
+
+// One counter, or two separated by a slash, right aligned on row i below the status bar.
+// The label is static and only drawn with a new page.
+void writeLinkStat(bool newPage, const char *label, uint32_t value, uint32_t value2, bool pair, uint8_t i)
+{
+  int y = 22 + 10 * i;
+  if(newPage)
+    drawString(0, y, label);
+  TextBuffer<24> text("  ");
+  text.appendUInt(value, 1);
+  if(pair)
+    text.append('/').appendUInt(value2, 1);
+  drawString(0, y, text.c_str(), true);
+}
+
+// Hidden diagnostics page: the receiver link and parser counters, see linkstats.h
+void drawPage_LinkStats(bool newPage, const sfe_ublox_link_stats_t &stats)
+{
+  ucg.setFont(ucg_font_helvR08_hr);
+  ucg.setFontMode(UCG_FONT_MODE_SOLID);
+  ucg.setColor(255, 255, 255);
+  writeLinkStat(newPage, "Bytes", stats.bytesRead, 0, false, 0);
+  writeLinkStat(newPage, "Polls/empty", stats.polls, stats.emptyPolls, true, 1);
+  writeLinkStat(newPage, "UBX frames", stats.ubxFrames, 0, false, 2);
+  writeLinkStat(newPage, "NMEA/RTCM", stats.nmeaSentences, stats.rtcmFrames, true, 3);
+  writeLinkStat(newPage, "Checksum fail", stats.checksumFailures, 0, false, 4);
+  writeLinkStat(newPage, "Resyncs", stats.resyncs, 0, false, 5);
+  writeLinkStat(newPage, "Overruns", stats.overruns, 0, false, 6);
+  if(renderScheduler.deferNonCritical())
+    return;
+  writeLinkStat(newPage, "Not ready (7F)", stats.notReadyRetries, 0, false, 7);
+  writeLinkStat(newPage, "Len FF/MSB", stats.lengthLsbFF, stats.lengthMsbSet, true, 8);
+  writeLinkStat(newPage, "Alloc/drops", stats.allocFailures, stats.droppedCallbacks, true, 9);
+  writeLinkStat(newPage, "Bus errors", stats.busErrors, 0, false, 10);
+}
+#endif
+
 #endif
@@ -0,0 +1,106 @@
+#ifndef __textfield_h__
+#define __textfield_h__
+
+#include <Ucglib.h> //http://librarymanager/All#Ucglib
+
+#define TEXTFIELD_MAX_LENGTH 24
+
+// A line of centered text that remembers what it last drew.
+// When the new text lays out to the same glyph positions, only the glyph cells whose
+// character changed are cleared and redrawn, so a coordinate that changes in its last
+// digit costs two glyphs instead of the whole line. Anything else (different width,
+// font, color or position) falls back to clearing the old line and drawing the new one.
+class TextField
+{
+  public:
+    TextField() { invalidate(); };
+    // Forget what is on screen. Call when the screen has been cleared.
+    void invalidate() { _length = 0; _font = nullptr; };
+    void setColor(uint8_t r, uint8_t g, uint8_t b)
+    {
+      if(r != _r || g != _g || b != _b)
+        invalidate();
+      _r = r; _g = g; _b = b;
+    };
+    void drawCenter(const ucg_fntpgm_uint8_t* font, int y, const char* text);
+  private:
+    void clear(int16_t x0, int16_t x1);
+    void drawGlyph(uint8_t i);
+    const ucg_fntpgm_uint8_t* _font;
+    int16_t _y;
+    char _text[TEXTFIELD_MAX_LENGTH];
+    int16_t _x[TEXTFIELD_MAX_LENGTH + 1]; // Left edge of each glyph cell. _x[_length] is the right edge of the line
+    uint8_t _length;
+    uint8_t _r = 255, _g = 255, _b = 255;
+};
+
+void TextField::clear(int16_t x0, int16_t x1)
+{
+  if(x1 <= x0)
+    return;
+  ucg.setColor(0, 0, 0);
+  ucg.drawBox(x0, _y - ucg.getFontAscent(), x1 - x0, ucg.getFontAscent() - ucg.getFontDescent());
+}
+
+void TextField::drawGlyph(uint8_t i)
+{
+  ucg.setColor(_r, _g, _b);
+  ucg.drawGlyph(_x[i], _y, 0, (uint8_t)_text[i]);
+}
+
+void TextField::drawCenter(const ucg_fntpgm_uint8_t* font, int y, const char* text)
+{
+  ucg.setFont(font);
+  ucg.setFontMode(UCG_FONT_MODE_SOLID);
+  ucg_t *ucgp = ucg.getUcg();
+
+  // Lay out the new text
+  uint8_t length = 0;
+  int16_t x[TEXTFIELD_MAX_LENGTH + 1];
+  int16_t width = 0;
+  while(length < TEXTFIELD_MAX_LENGTH && text[length] != 0)
+  {
+    x[length] = width;
+    width += ucg_GetGlyphWidth(ucgp, (uint8_t)text[length]);
+    length++;
+  }
+  x[length] = width;
+  int16_t left = 64 - width / 2;
+  for(uint8_t i = 0; i <= length; i++)
+    x[i] += left;
+
+  bool sameLayout = _font == font && _y == y && _length == length;
+  for(uint8_t i = 0; sameLayout && i <= length; i++)
+    sameLayout = x[i] == _x[i];
+
+  if(sameLayout)
+  {
+    // Only touch the cells that changed
+    for(uint8_t i = 0; i < length; i++)
+    {
+      if(_text[i] == text[i])
+        continue;
+      _text[i] = text[i];
+      clear(_x[i], _x[i + 1]);
+      drawGlyph(i);
+    }
+    return;
+  }
+
+  // Full redraw: clear the old line and draw the new one
+  if(_font != nullptr && _length > 0)
+  {
+    ucg.setFont(_font); // Clear with the old line's font height and position
+    clear(_x[0], _x[_length]);
+    ucg.setFont(font);
+  }
+  _font = font;
+  _y = y;
+  _length = length;
+  memcpy(_text, text, length);
+  memcpy(_x, x, sizeof(int16_t) * (length + 1));
+  for(uint8_t i = 0; i < length; i++)
+    drawGlyph(i);
+}
+
+#endif
@@ -29,7 +29,7 @@ struct minfoStructure // Structure to hold the module info (uses 341 bytes of RA
         char extension[10][30];
     } minfo;
     
-bool sendCommand(SFE_UBLOX_GNSS *gps, uint8_t cls, uint8_t id, uint8_t len, uint8_t *payload)
+sfe_ublox_status_e sendCommand(SFE_UBLOX_GNSS *gps, uint8_t cls, uint8_t id, uint8_t len, uint8_t *payload, uint16_t maxWait = 1100)
 {
   // Get USB Port settings:
   customCfg.cls = cls;  // This is the message Class
@@ -38,7 +38,7 @@ bool sendCommand(SFE_UBLOX_GNSS *gps, uint8_t cls, uint8_t id, uint8_t len, uint
   customCfg.startingSpot = 0;  // Always set the startingSpot to zero (unless you really know what you are doing)
   for(int8_t i = 0;i<len;i++)
     customPayload[i] = payload[i];
-  return gps->sendCommand(&customCfg, 1100);
+  return gps->sendCommand(&customCfg, maxWait);
 }
 /*
 uint32_t getval32(int offset)
@@ -60,7 +60,7 @@ boolean getModuleInfo(SFE_UBLOX_GNSS *gps, uint16_t maxWait)
 
     // Now let's send the command. The module info is returned in customPayload
 
-    if(sendCommand(gps, UBX_CLASS_MON, UBX_MON_VER, 0, nullptr) != SFE_UBLOX_STATUS_DATA_RECEIVED)
+    if(sendCommand(gps, UBX_CLASS_MON, UBX_MON_VER, 0, nullptr, maxWait) != SFE_UBLOX_STATUS_DATA_RECEIVED)
       return false; // If command send fails then bail
 
     // Now let's extract the module info from customPayload
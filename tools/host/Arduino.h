@@ -0,0 +1,122 @@
+#ifndef __host_Arduino_h__
+#define __host_Arduino_h__
+
+// Minimal Arduino core stand-in for building the sketch's display and GNSS code on Linux.
+// Only what the sketch and the u-blox library actually use is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 2
+#define RISING 3
+#define FALLING 4
+#define LED_BUILTIN 13
+#define DEC 10
+#define HEX 16
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+#define digitalPinToInterrupt(pin) (pin)
+inline void noInterrupts() {}
+inline void interrupts() {}
+// Host only: what digitalRead() returns for the pin. A change runs the pin's interrupt handler.
+void host_SetPin(uint8_t pin, int level);
+// Host only: run millis()/micros() from a simulated clock that only moves with delay() and
+// host_AdvanceClock(), so simulations run faster than real time and are repeatable
+void host_UseVirtualClock();
+void host_AdvanceClock(unsigned long us);
+
+class String
+{
+  public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(unsigned char v) : _s(std::to_string(v)) {}
+    String(float v, unsigned char decimals = 2) { format(v, decimals); }
+    String(double v, unsigned char decimals = 2) { format(v, decimals); }
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    String& operator+=(const String& other) { _s += other._s; return *this; }
+    friend String operator+(const String& a, const String& b) { String r(a); r._s += b._s; return r; }
+    friend String operator+(const String& a, const char* b) { String r(a); r._s += b; return r; }
+    friend String operator+(const char* a, const String& b) { String r(a); r._s += b._s; return r; }
+    friend String operator+(const String& a, char b) { String r(a); r._s += b; return r; }
+    bool operator==(const char* other) const { return other && _s == other; }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    bool operator==(const String& other) const { return _s == other._s; }
+    bool operator!=(const String& other) const { return _s != other._s; }
+  private:
+    void format(double v, int decimals) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimals, v); _s = b; }
+    std::string _s;
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) { size_t n = 0; while (size--) n += write(*buffer++); return n; }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const __FlashStringHelper* s) { return print((const char*)s); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v, int base = DEC) { char b[24]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%ld", v); return print(b); }
+    size_t print(unsigned long v, int base = DEC) { char b[24]; snprintf(b, sizeof(b), base == HEX ? "%lX" : "%lu", v); return print(b); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(double v, int decimals = 2) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimals, v); return print(b); }
+    template<typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template<typename T> size_t println(T v, int format) { size_t n = print(v, format); return n + println(); }
+    size_t println() { return print("\r\n"); }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+};
+
+// Serial output goes to stderr so it doesn't mix with tool output on stdout
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fputc(c, stderr) == EOF ? 0 : 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __host_SPI_h__
+#define __host_SPI_h__
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+struct SPISettings
+{
+  SPISettings(uint32_t = 0, uint8_t = 0, uint8_t = 0) {}
+};
+
+// SPI stand-in. Reads return 0xFF like an idle bus.
+class SPIClass
+{
+  public:
+    void begin() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0xFF; }
+    void transfer(void*, size_t) {}
+};
+extern SPIClass SPI;
+
+#endif
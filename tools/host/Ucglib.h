@@ -0,0 +1,145 @@
+#ifndef __host_Ucglib_h__
+#define __host_Ucglib_h__
+
+// Ucglib stand-in for Linux builds.
+// Mirrors the Ucglib structure the sketch relies on: the C++ Ucglib class draws through a
+// device callback using the same UCG_MSG_* messages, and the SSD1351 device callback talks
+// to the panel through the ucg_com_* byte layer. On the host that byte layer feeds an
+// emulated SSD1351 which rasterises into a 128x128 RGB565 buffer, so every byte the code
+// would put on the SPI bus is counted and lands in the picture exactly like on the panel.
+// Fonts are a scaled 5x7 bitmap font with roughly the metrics of the Helvetica fonts used.
+
+#include "Arduino.h"
+
+typedef int16_t ucg_int_t;
+typedef uint8_t ucg_fntpgm_uint8_t;
+typedef struct _ucg_t ucg_t;
+typedef ucg_int_t (*ucg_dev_fnptr)(ucg_t *ucg, ucg_int_t msg, void *data);
+
+struct ucg_xy_t { ucg_int_t x; ucg_int_t y; };
+struct ucg_wh_t { ucg_int_t w; ucg_int_t h; };
+struct ucg_box_t { ucg_xy_t ul; ucg_wh_t size; };
+struct ucg_color_t { uint8_t color[3]; };
+struct ucg_pixel_t { ucg_xy_t pos; ucg_color_t rgb; };
+struct ucg_arg_t
+{
+  ucg_pixel_t pixel;
+  ucg_int_t len;
+  ucg_int_t dir;
+  const unsigned char *bitmap;
+  ucg_color_t rgb[4];
+};
+struct _ucg_t
+{
+  ucg_dev_fnptr device_cb;
+  ucg_dev_fnptr ext_cb;
+  ucg_arg_t arg;
+  ucg_box_t clip_box;
+  ucg_wh_t dimension;
+  const ucg_fntpgm_uint8_t *font;
+  uint8_t font_mode;
+};
+
+extern const ucg_fntpgm_uint8_t ucg_font_helvR08_hr[];
+extern const ucg_fntpgm_uint8_t ucg_font_helvR10_hr[];
+extern const ucg_fntpgm_uint8_t ucg_font_helvR14_hr[];
+extern const ucg_fntpgm_uint8_t ucg_font_helvB10_hr[];
+
+#define UCG_FONT_MODE_TRANSPARENT 0
+#define UCG_FONT_MODE_SOLID 1
+#define UCG_DRAW_UPPER_RIGHT 0x01
+#define UCG_DRAW_UPPER_LEFT 0x02
+#define UCG_DRAW_LOWER_LEFT 0x04
+#define UCG_DRAW_LOWER_RIGHT 0x08
+#define UCG_DRAW_ALL (UCG_DRAW_UPPER_RIGHT|UCG_DRAW_UPPER_LEFT|UCG_DRAW_LOWER_RIGHT|UCG_DRAW_LOWER_LEFT)
+#define UCG_PIN_VAL_NONE 255
+
+#define UCG_MSG_DEV_POWER_UP 10
+#define UCG_MSG_DEV_POWER_DOWN 11
+#define UCG_MSG_DRAW_PIXEL 20
+#define UCG_MSG_DRAW_L90FX 21
+#define UCG_MSG_DRAW_L90TC 22
+#define UCG_MSG_DRAW_L90SE 23
+#define UCG_MSG_DRAW_L90BF 25
+
+ucg_int_t ucg_clip_is_pixel_visible(ucg_t *ucg);
+void ucg_handle_l90fx(ucg_t *ucg, ucg_dev_fnptr dev_cb);
+void ucg_handle_l90tc(ucg_t *ucg, ucg_dev_fnptr dev_cb);
+void ucg_handle_l90bf(ucg_t *ucg, ucg_dev_fnptr dev_cb);
+void ucg_handle_l90se(ucg_t *ucg, ucg_dev_fnptr dev_cb);
+ucg_int_t ucg_GetGlyphWidth(ucg_t *ucg, uint8_t requested_encoding);
+
+ucg_int_t ucg_dev_ssd1351_18x128x128_ft(ucg_t *ucg, ucg_int_t msg, void *data);
+ucg_int_t ucg_ext_ssd1351_18(ucg_t *ucg, ucg_int_t msg, void *data);
+ucg_int_t ucg_ext_none(ucg_t *ucg, ucg_int_t msg, void *data);
+
+void ucg_com_SetCSLineStatus(ucg_t *ucg, uint8_t level);
+void ucg_com_SetCDLineStatus(ucg_t *ucg, uint8_t level);
+void ucg_com_SendByte(ucg_t *ucg, uint8_t byte);
+void ucg_com_SendString(ucg_t *ucg, uint16_t cnt, const uint8_t *byte_ptr);
+
+class Ucglib : public Print
+{
+  public:
+    Ucglib(ucg_dev_fnptr dev, ucg_dev_fnptr ext);
+    ucg_t *getUcg() { return &ucg; }
+    void begin(uint8_t is_transparent);
+    void powerDown();
+    void powerUp();
+    void clearScreen();
+    void setFont(const ucg_fntpgm_uint8_t *font) { ucg.font = font; }
+    void setFontMode(uint8_t mode) { ucg.font_mode = mode; }
+    void setColor(uint8_t r, uint8_t g, uint8_t b) { setColor(0, r, g, b); }
+    void setColor(uint8_t idx, uint8_t r, uint8_t g, uint8_t b);
+    void setPrintPos(ucg_int_t x, ucg_int_t y) { tx = x; ty = y; }
+    size_t write(uint8_t c) override;
+    using Print::write;
+    ucg_int_t getStrWidth(const char *s);
+    int8_t getFontAscent();
+    int8_t getFontDescent();
+    ucg_int_t getWidth() { return ucg.dimension.w; }
+    ucg_int_t getHeight() { return ucg.dimension.h; }
+    void drawPixel(ucg_int_t x, ucg_int_t y);
+    void drawHLine(ucg_int_t x, ucg_int_t y, ucg_int_t len);
+    void drawVLine(ucg_int_t x, ucg_int_t y, ucg_int_t len);
+    void drawLine(ucg_int_t x1, ucg_int_t y1, ucg_int_t x2, ucg_int_t y2);
+    void drawBox(ucg_int_t x, ucg_int_t y, ucg_int_t w, ucg_int_t h);
+    void drawCircle(ucg_int_t x0, ucg_int_t y0, ucg_int_t rad, uint8_t option);
+    ucg_int_t drawGlyph(ucg_int_t x, ucg_int_t y, uint8_t dir, uint8_t encoding);
+    ucg_int_t drawString(ucg_int_t x, ucg_int_t y, uint8_t dir, const char *str);
+  protected:
+    ucg_t ucg;
+    ucg_int_t tx = 0;
+    ucg_int_t ty = 0;
+};
+
+class Ucglib4WireHWSPI : public Ucglib
+{
+  public:
+    Ucglib4WireHWSPI(ucg_dev_fnptr dev, ucg_dev_fnptr ext, uint8_t /*cd*/, uint8_t /*cs*/ = UCG_PIN_VAL_NONE, uint8_t /*reset*/ = UCG_PIN_VAL_NONE)
+      : Ucglib(dev, ext) {}
+};
+
+class Ucglib_SSD1351_18x128x128_FT_HWSPI : public Ucglib4WireHWSPI
+{
+  public:
+    Ucglib_SSD1351_18x128x128_FT_HWSPI(uint8_t cd, uint8_t cs = UCG_PIN_VAL_NONE, uint8_t reset = UCG_PIN_VAL_NONE)
+      : Ucglib4WireHWSPI(ucg_dev_ssd1351_18x128x128_ft, ucg_ext_ssd1351_18, cd, cs, reset) {}
+};
+
+// Host only: what went over the emulated SPI bus since the last reset
+struct UcgHostStats
+{
+  uint32_t spiBytes;      // All bytes, commands and data
+  uint32_t commandBytes;  // Bytes sent with CD low
+  uint32_t windows;       // Address windows opened (column + row command pairs)
+  uint32_t pixels;        // Pixels written into panel RAM
+};
+extern UcgHostStats ucgHostStats;
+void ucg_host_ResetStats();
+uint16_t ucg_host_GetPixel(ucg_int_t x, ucg_int_t y); // Panel content as RGB565
+bool ucg_host_WritePPM(const char *path);
+// With the virtual clock, advance it by this much for each byte the CPU sends (0 = free)
+void ucg_host_SetBusTime(uint32_t nanosPerByte);
+
+#endif
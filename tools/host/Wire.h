@@ -0,0 +1,22 @@
+#ifndef __host_Wire_h__
+#define __host_Wire_h__
+
+#include "Arduino.h"
+
+// I2C stand-in. No device ever answers.
+class TwoWire : public Stream
+{
+  public:
+    void begin() {}
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 2; } // NACK on address
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+};
+extern TwoWire Wire;
+
+#endif
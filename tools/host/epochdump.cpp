@@ -0,0 +1,69 @@
+// Decodes a compact epoch log (LOGnnn.EPL, see epochlog.h) to CSV with the exact integers
+// the receiver reported. A record that fails its CRC is skipped together with the records
+// after it up to the next keyframe.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -Isrc/GpsStatusDisplay tools/host/epochdump.cpp -o epochdump
+//
+// Usage: epochdump file.epl > epochs.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <vector>
+#include "epochlog.h"
+
+// NAV-PVT and NAV-HPPOSLLH frames, sync to checksum
+#define UBX_BYTES_PER_EPOCH (100 + 44)
+
+int main(int argc, char **argv)
+{
+  if(argc != 2)
+  {
+    fprintf(stderr, "Usage: %s file.epl\n", argv[0]);
+    return 1;
+  }
+  FILE *file = fopen(argv[1], "rb");
+  if(!file)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[65536];
+  size_t count;
+  while((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    data.insert(data.end(), chunk, chunk + count);
+  fclose(file);
+  if(!EpochDecoder::isEpochLog(data.data(), data.size()))
+  {
+    fprintf(stderr, "%s: not an epoch log\n", argv[1]);
+    return 1;
+  }
+
+  printf("iTOW,year,month,day,lat_1e9deg,lon_1e9deg,height_0.1mm,hMSL_0.1mm,hAcc_0.1mm,vAcc_0.1mm,fixType,carrSoln,numSV,flags\n");
+  EpochDecoder decoder;
+  EpochRecord r;
+  const uint8_t *p = data.data() + EPOCH_LOG_MAGIC_LENGTH;
+  const uint8_t *end = data.data() + data.size();
+  uint32_t epochs = 0;
+  uint32_t skipped = 0; // Bytes
+  while(p < end)
+  {
+    if(!decoder.decode(p, end, r))
+    {
+      decoder.reset();
+      p++;
+      skipped++;
+      continue;
+    }
+    printf("%" PRIu32 ",%u,%u,%u,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRIu32 ",%" PRIu32 ",%u,%u,%u,%u\n",
+      r.iTOW, r.year, r.month, r.day, r.lat, r.lon, r.height, r.hMSL, r.hAcc, r.vAcc,
+      r.fixType, r.carrSoln, r.numSV, r.flags);
+    epochs++;
+  }
+  fprintf(stderr, "%u epochs in %zu bytes, %.1f bytes per epoch (%.1fx smaller than UBX), %u bytes skipped\n",
+    epochs, data.size(), epochs > 0 ? (double)data.size() / epochs : 0.0,
+    data.size() > 0 ? (double)epochs * UBX_BYTES_PER_EPOCH / data.size() : 0.0, skipped);
+  return 0;
+}
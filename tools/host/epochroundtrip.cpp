@@ -0,0 +1,278 @@
+// Checks the compact epoch log (epochlog.h) end to end: synthetic static survey epochs go
+// through EpochLogger and UbxLogger like in the sketch, and the log is decoded again and
+// compared with what went in, field by field. The epochs cover HPPOSLLH before and after
+// the PVT, PVT-only epochs, time gaps, a week rollover, a date change and fix changes.
+// Then copies of the log are damaged, a stretch zeroed or a byte changed, and decoded the
+// way epochdump does. Every epoch that comes out must be one that went in.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -DARDUINO=10813 -DLOGGER_POSIX -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/epochroundtrip.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o epochroundtrip
+//
+// Usage: epochroundtrip [-n epochs] [-d damaged copies]
+
+#include "Arduino.h"
+#include "logger.h"
+#include <inttypes.h>
+#include <map>
+#include <vector>
+
+#define UBX_BYTES_PER_EPOCH (100 + 44) // NAV-PVT and NAV-HPPOSLLH frames, sync to checksum
+
+// The log in memory
+class MemoryLogFile : public LogBlockDevice
+{
+  public:
+    bool begin() override
+    {
+      data.clear();
+      return true;
+    };
+    bool writeBlocks(const uint8_t *blocks, uint16_t count) override
+    {
+      data.insert(data.end(), blocks, blocks + (size_t)count * LOG_BLOCK_SIZE);
+      return true;
+    };
+    bool writeTail(const uint8_t *tail, uint16_t length) override
+    {
+      data.insert(data.end(), tail, tail + length);
+      return true;
+    };
+    bool sync() override { return true; };
+    void end() override { };
+
+    std::vector<uint8_t> data;
+};
+
+static uint32_t randomState = 12345;
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 8;
+}
+static int32_t jitter(int32_t range)
+{
+  return (int32_t)(nextRandom() % (2 * range + 1)) - range;
+}
+
+static bool sameEpoch(const EpochRecord &a, const EpochRecord &b)
+{
+  return a.iTOW == b.iTOW && a.lat == b.lat && a.lon == b.lon && a.height == b.height &&
+    a.hMSL == b.hMSL && a.hAcc == b.hAcc && a.vAcc == b.vAcc && a.fixType == b.fixType &&
+    a.carrSoln == b.carrSoln && a.numSV == b.numSV && a.year == b.year && a.month == b.month &&
+    a.day == b.day && a.flags == b.flags;
+}
+
+// Feeds count epochs to the logger and returns what each should decode to
+static std::vector<EpochRecord> feedEpochs(EpochLogger &epochLogger, UbxLogger &logger, uint32_t count)
+{
+  std::vector<EpochRecord> expected;
+  // 800 seconds before the end of a GPS week, which falls on a Saturday night UTC
+  uint32_t iTOW = 604000000;
+  uint32_t utcSeconds = 6 * 86400 + 86400 - 800 - 18; // Since Sunday 2026-10-11 00:00 UTC
+  uint8_t fixType = 3;
+  uint8_t carrSoln = 2;
+  uint8_t numSV = 18;
+  uint32_t hAcc = 140; // 0.1mm
+  uint32_t vAcc = 210;
+  for(uint32_t epoch = 0; epoch < count; epoch++)
+  {
+    if(epoch % 5000 == 4999)
+    {
+      uint32_t gap = 2 + nextRandom() % 30; // Lost the solution for a while
+      iTOW += gap * 1000;
+      utcSeconds += gap;
+    }
+    if(epoch % 97 == 0)
+      carrSoln = nextRandom() % 3;
+    if(epoch % 1013 == 500)
+      fixType = fixType == 3 ? 2 : 3;
+    if(epoch % 11 == 0)
+      numSV = 16 + nextRandom() % 6;
+    if(iTOW >= GPS_WEEK_MS)
+      iTOW -= GPS_WEEK_MS;
+    hAcc += hAcc > 120 ? jitter(1) : 1;
+    vAcc += vAcc > 180 ? jitter(1) : 1;
+    // A few millimeters of noise around a fixed point, split into the standard and high
+    // precision parts like the receiver does
+    int64_t lat = 47620500000LL + jitter(30); // 1e-9 degrees
+    int64_t lon = -122349300000LL + jitter(30);
+    int64_t height = 340000 + jitter(40);     // 0.1mm
+    int64_t hMSL = 520000 + jitter(40);
+
+    UBX_NAV_PVT_data_t pvt;
+    memset(&pvt, 0, sizeof(pvt));
+    pvt.iTOW = iTOW;
+    pvt.year = 2026;
+    pvt.month = 10;
+    pvt.day = 11 + utcSeconds / 86400;
+    pvt.hour = utcSeconds / 3600 % 24;
+    pvt.min = utcSeconds / 60 % 60;
+    pvt.sec = utcSeconds % 60;
+    pvt.fixType = fixType;
+    pvt.flags.bits.gnssFixOK = fixType == 3;
+    pvt.flags.bits.carrSoln = carrSoln;
+    pvt.numSV = numSV;
+    pvt.lat = (int32_t)(lat / 100);
+    pvt.lon = (int32_t)(lon / 100);
+    pvt.height = (int32_t)(height / 10);
+    pvt.hMSL = (int32_t)(hMSL / 10);
+    pvt.hAcc = hAcc / 10;
+    pvt.vAcc = vAcc / 10;
+
+    UBX_NAV_HPPOSLLH_data_t hp;
+    memset(&hp, 0, sizeof(hp));
+    hp.iTOW = iTOW;
+    hp.lat = pvt.lat;
+    hp.lon = pvt.lon;
+    hp.height = pvt.height;
+    hp.hMSL = pvt.hMSL;
+    hp.latHp = (int8_t)(lat % 100);
+    hp.lonHp = (int8_t)(lon % 100);
+    hp.heightHp = (int8_t)(height % 10);
+    hp.hMSLHp = (int8_t)(hMSL % 10);
+    hp.hAcc = hAcc;
+    hp.vAcc = vAcc;
+
+    EpochRecord r;
+    r.iTOW = iTOW;
+    r.fixType = pvt.fixType;
+    r.carrSoln = carrSoln;
+    r.numSV = numSV;
+    r.year = pvt.year;
+    r.month = pvt.month;
+    r.day = pvt.day;
+    // Every 50th epoch has no HPPOSLLH, except the last, which would never be written
+    bool pvtOnly = epoch % 50 == 17 && epoch + 1 < count;
+    if(pvtOnly)
+    {
+      r.lat = (int64_t)pvt.lat * 100;
+      r.lon = (int64_t)pvt.lon * 100;
+      r.height = (int64_t)pvt.height * 10;
+      r.hMSL = (int64_t)pvt.hMSL * 10;
+      r.hAcc = pvt.hAcc * 10;
+      r.vAcc = pvt.vAcc * 10;
+      r.flags = pvt.flags.bits.gnssFixOK ? EPOCH_FLAG_FIX_OK : 0;
+      epochLogger.addPVT(pvt);
+    }
+    else
+    {
+      r.lat = (int64_t)hp.lat * 100 + hp.latHp;
+      r.lon = (int64_t)hp.lon * 100 + hp.lonHp;
+      r.height = (int64_t)hp.height * 10 + hp.heightHp;
+      r.hMSL = (int64_t)hp.hMSL * 10 + hp.hMSLHp;
+      r.hAcc = hp.hAcc;
+      r.vAcc = hp.vAcc;
+      r.flags = (pvt.flags.bits.gnssFixOK ? EPOCH_FLAG_FIX_OK : 0) | EPOCH_FLAG_HIGH_PRECISION;
+      // Receivers differ in which of the two they send first
+      if(epoch % 7 == 3)
+      {
+        epochLogger.addHPPOSLLH(hp);
+        epochLogger.addPVT(pvt);
+      }
+      else
+      {
+        epochLogger.addPVT(pvt);
+        epochLogger.addHPPOSLLH(hp);
+      }
+    }
+    expected.push_back(r);
+    logger.service();
+    iTOW += 1000;
+    utcSeconds++;
+  }
+  return expected;
+}
+
+// Decodes a log like epochdump: after a record that doesn't decode, one byte on and only
+// keyframes until one does
+static std::vector<EpochRecord> decodeLog(const std::vector<uint8_t> &log)
+{
+  std::vector<EpochRecord> epochs;
+  EpochDecoder decoder;
+  EpochRecord r;
+  const uint8_t *p = log.data() + EPOCH_LOG_MAGIC_LENGTH;
+  const uint8_t *end = log.data() + log.size();
+  while(p < end)
+  {
+    if(decoder.decode(p, end, r))
+      epochs.push_back(r);
+    else
+    {
+      decoder.reset();
+      p++;
+    }
+  }
+  return epochs;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = 100000;
+  uint32_t damaged = 200;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      count = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+      damaged = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "Usage: %s [-n epochs] [-d damaged copies]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  MemoryLogFile file;
+  UbxLogger logger(&file);
+  EpochLogger epochLogger(&logger);
+  if(!epochLogger.begin())
+    return 1;
+  std::vector<EpochRecord> expected = feedEpochs(epochLogger, logger, count);
+  logger.end();
+  const std::vector<uint8_t> &log = file.data;
+
+  std::vector<EpochRecord> decoded = decodeLog(log);
+  uint32_t mismatches = 0;
+  for(size_t i = 0; i < expected.size() && i < decoded.size(); i++)
+    mismatches += !sameEpoch(expected[i], decoded[i]);
+  printf("round trip: %u epochs in %zu bytes, %.2f bytes per epoch (%.1fx smaller than UBX), %zu decoded, %u different\n",
+    count, log.size(), (double)log.size() / count, (double)count * UBX_BYTES_PER_EPOCH / log.size(),
+    decoded.size(), mismatches);
+  bool passed = decoded.size() == expected.size() && mismatches == 0 && logger.droppedBytes == 0;
+
+  // Damaged copies: every epoch decoded must be one of those fed in, in order
+  std::map<uint32_t, size_t> byTime;
+  for(size_t i = 0; i < expected.size(); i++)
+    byTime[expected[i].iTOW] = i;
+  uint32_t phantoms = 0;
+  uint64_t lost = 0;
+  for(uint32_t copy = 0; copy < damaged; copy++)
+  {
+    std::vector<uint8_t> damagedLog = log;
+    size_t offset = EPOCH_LOG_MAGIC_LENGTH + nextRandom() % (log.size() - EPOCH_LOG_MAGIC_LENGTH - 40);
+    if(copy % 2 == 0)
+      memset(&damagedLog[offset], 0, 40);
+    else
+      damagedLog[offset] ^= 1 + nextRandom() % 255;
+    std::vector<EpochRecord> epochs = decodeLog(damagedLog);
+    size_t next = 0;
+    for(size_t i = 0; i < epochs.size(); i++)
+    {
+      std::map<uint32_t, size_t>::const_iterator found = byTime.find(epochs[i].iTOW);
+      if(found == byTime.end() || found->second < next || !sameEpoch(epochs[i], expected[found->second]))
+      {
+        phantoms++;
+        continue;
+      }
+      next = found->second + 1;
+    }
+    lost += expected.size() - epochs.size();
+  }
+  printf("damaged: %u copies with 40 bytes zeroed or one byte changed, %.1f epochs lost per copy, %u epochs that weren't logged\n",
+    damaged, damaged > 0 ? (double)lost / damaged : 0.0, phantoms);
+  passed = passed && phantoms == 0;
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? 0 : 1;
+}
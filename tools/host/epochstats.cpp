@@ -0,0 +1,211 @@
+// Position scatter of a UBX log, like the 1000 point RTK plot in the README, worked out on
+// the host: the log's PVT and HPPOSLLH go through the u-blox library into an EpochStore
+// (epochstore.h), which is then filtered by solution quality and time and summarised as
+// mean position, standard deviation north, east and up, and CEP.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O3 -fopenmp-simd -march=native -DARDUINO=10813 -Itools/host
+//     -Isrc/GpsStatusDisplay tools/host/epochstats.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o epochstats
+// Without -fopenmp-simd the sums aren't vectorized, as that changes the order of additions.
+//
+// Usage: epochstats [-f min fix type] [-c min carrSoln] [-s min satellites] [-a max hAcc m]
+//                   [-t week start end] [-n runs] log.ubx
+//        epochstats [options] -g epochs
+//   -t keeps the epochs from start to end, seconds of the GPS week, like ubxwindow
+//   -g fills the store with made up RTK epochs around a point instead of reading a log
+//   -n repeats the queries to time them
+
+#include "receiverstream.h"
+#include "ubxlogreader.h"
+#include "epochstore.h"
+#include <time.h>
+
+static EpochStore store;
+
+static void onPVT(UBX_NAV_PVT_data_t pvt) { store.addPVT(pvt); }
+static void onHPPOSLLH(UBX_NAV_HPPOSLLH_data_t hp) { store.addHPPOSLLH(hp); }
+
+static bool loadLog(const char *path)
+{
+  MappedFile log;
+  if(!log.open(path))
+    return false;
+  ReceiverStream stream;
+  SFE_UBLOX_GNSS gps;
+  if(!gps.begin(stream) || !gps.setAutoPVTcallback(onPVT) || !gps.setAutoHPPOSLLHcallback(onHPPOSLLH))
+    return false;
+  store.reserve(log.size() / 150);
+  const uint8_t *p = log.data();
+  const uint8_t *end = p + log.size();
+  size_t length;
+  uint8_t protocol;
+  bool valid;
+  while((p = nextFrame(p, end, length, protocol, valid)) < end)
+  {
+    if(protocol == PROTOCOL_UBX && valid)
+    {
+      stream.setWindow(p, length);
+      gps.checkUblox();
+      gps.checkCallbacks();
+    }
+    p = frameEnd(p, length, valid);
+  }
+  return true;
+}
+
+// Date of a day counted from 1970-01-01, the reverse of daysFromCivil()
+static void civilFromDays(int32_t days, uint16_t &year, uint8_t &month, uint8_t &day)
+{
+  days += 719468;
+  int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  uint32_t dayOfEra = (uint32_t)(days - era * 146097);
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+  day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  year = yearOfEra + era * 400 + (month <= 2);
+}
+
+// A 1Hz static survey: fixed RTK with centimetre scatter, every tenth minute float with
+// decimetres
+static void generateEpochs(uint32_t epochs)
+{
+  store.reserve(epochs);
+  uint32_t state = 12345;
+  const int32_t gpsEpochDay = daysFromCivil(1980, 1, 6);
+  for(uint32_t epoch = 0; epoch < epochs; epoch++)
+  {
+    state = state * 1103515245 + 12345;
+    bool fixed = (epoch / 60) % 10 != 9;
+    int32_t scatter = fixed ? 150 : 3000; // 1e-9 degrees, about 1.5cm and 30cm of latitude
+    int32_t dLat = (int32_t)((state >> 8) % (2 * scatter + 1)) - scatter;
+    state = state * 1103515245 + 12345;
+    int32_t dLon = (int32_t)((state >> 8) % (2 * scatter + 1)) - scatter;
+    uint64_t gpsSecond = 2440ULL * 604800 + 86400 + epoch;
+    uint64_t utcSecond = gpsSecond - 18; // Leap seconds, since the GPS epoch
+    uint32_t secondOfDay = utcSecond % 86400;
+
+    UBX_NAV_PVT_data_t pvt;
+    memset(&pvt, 0, sizeof(pvt));
+    pvt.iTOW = gpsSecond % 604800 * 1000;
+    civilFromDays(gpsEpochDay + (int32_t)(utcSecond / 86400), pvt.year, pvt.month, pvt.day);
+    pvt.hour = secondOfDay / 3600;
+    pvt.min = secondOfDay / 60 % 60;
+    pvt.sec = secondOfDay % 60;
+    pvt.valid.bits.validDate = 1;
+    pvt.valid.bits.validTime = 1;
+    pvt.fixType = 3;
+    pvt.flags.bits.gnssFixOK = 1;
+    pvt.flags.bits.carrSoln = fixed ? 2 : 1;
+    pvt.numSV = 20 + epoch % 7;
+    store.addPVT(pvt);
+
+    UBX_NAV_HPPOSLLH_data_t hp;
+    memset(&hp, 0, sizeof(hp));
+    hp.iTOW = pvt.iTOW;
+    int64_t lat = 47620500000LL + dLat;
+    int64_t lon = -122349300000LL + dLon;
+    hp.lat = (int32_t)(lat / 100);
+    hp.latHp = (int8_t)(lat % 100);
+    hp.lon = (int32_t)(lon / 100);
+    hp.lonHp = (int8_t)(lon % 100);
+    hp.height = 30000 + (dLat + dLon) / 20;
+    hp.hAcc = fixed ? 140 : 2500;
+    hp.vAcc = fixed ? 210 : 4000;
+    store.addHPPOSLLH(hp);
+  }
+}
+
+static double now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  EpochFilter filter;
+  bool window = false;
+  uint16_t week = 0;
+  double start = 0, end = 0;
+  long generate = -1;
+  int runs = 1;
+  const char *path = nullptr;
+  bool usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-f") && i + 1 < argc)
+      filter.minFixType = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-c") && i + 1 < argc)
+      filter.minCarrSoln = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+      filter.minNumSV = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-a") && i + 1 < argc)
+      filter.maxHAcc = atof(argv[++i]);
+    else if(!strcmp(argv[i], "-t") && i + 3 < argc)
+    {
+      window = true;
+      week = atoi(argv[++i]);
+      start = atof(argv[++i]);
+      end = atof(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "-g") && i + 1 < argc)
+      generate = atol(argv[++i]);
+    else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      runs = atoi(argv[++i]);
+    else if(argv[i][0] != '-' && path == nullptr)
+      path = argv[i];
+    else
+      usage = true;
+  }
+  if(usage || runs < 1 || (path == nullptr) == (generate < 0))
+  {
+    fprintf(stderr, "Usage: %s [-f min fix type] [-c min carrSoln] [-s min satellites] [-a max hAcc m]\n"
+      "         [-t week start end] [-n runs] log.ubx | -g epochs\n", argv[0]);
+    return 1;
+  }
+
+  double t0 = now();
+  if(generate >= 0)
+    generateEpochs(generate);
+  else if(!loadLog(path))
+  {
+    fprintf(stderr, "Can't read %s\n", path);
+    return 1;
+  }
+  bool sorted = store.isSorted();
+  store.sortByTime();
+  double t1 = now();
+  printf("%zu epochs%s, %u without a valid time dropped, loaded in %.3fs\n", store.size(),
+    sorted ? "" : " (out of order, sorted)", store.dropped, t1 - t0);
+
+  EpochRange range = store.all();
+  if(window)
+    range = store.window(gpsMillis(week, 0) + (uint64_t)(start * 1000), gpsMillis(week, 0) + (uint64_t)(end * 1000));
+  std::vector<uint8_t> mask;
+  size_t selected = 0;
+  PositionStats stats;
+  double selectTime = 1e9, statsTime = 1e9;
+  for(int run = 0; run < runs; run++)
+  {
+    double t2 = now();
+    selected = store.select(range, filter, mask);
+    double t3 = now();
+    stats = store.positionStats(range, mask);
+    double t4 = now();
+    selectTime = std::min(selectTime, t3 - t2);
+    statsTime = std::min(statsTime, t4 - t3);
+  }
+  printf("%zu epochs in the window, %zu selected\n", range.size(), selected);
+  if(stats.count == 0)
+    return 0;
+  printf("mean: %.9f %.9f %.4fm\n", stats.lat, stats.lon, stats.height);
+  printf("std dev: north %.4fm, east %.4fm, up %.4fm\n", stats.north, stats.east, stats.up);
+  printf("CEP50 %.4fm, CEP95 %.4fm, mean hAcc %.4fm, vAcc %.4fm\n", stats.cep50, stats.cep95, stats.hAcc, stats.vAcc);
+  printf("select %.2fms (%.0fM epochs/s), stats %.2fms (%.0fM epochs/s)\n", selectTime * 1e3,
+    range.size() / selectTime / 1e6, statsTime * 1e3, range.size() / statsTime / 1e6);
+  return 0;
+}
@@ -0,0 +1,270 @@
+#ifndef __host_epochstore_h__
+#define __host_epochstore_h__
+
+// Navigation epochs in memory, one array per field, for analysing long recordings on the
+// host: filter by solution quality, cut out time windows and work out the position scatter
+// (mean, standard deviation, CEP) over millions of epochs.
+// Each query walks a few arrays front to back with no branches in the loop, so the compiler
+// can vectorize it. Rows are selected with a mask of one byte per epoch instead of by index,
+// which keeps the arrays contiguous. The sums are reductions the compiler may only reorder
+// with -fopenmp-simd, see the build line of epochstats.cpp.
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+#include "logindex.h"
+
+#define WGS84_A 6378137.0
+#define WGS84_E2 6.69437999014e-3
+
+struct EpochRange
+{
+  size_t begin;
+  size_t end;
+  size_t size() const { return end - begin; };
+};
+
+struct EpochFilter
+{
+  uint8_t minFixType = 0;  // 3 for 3D fixes only
+  uint8_t minCarrSoln = 0; // 1 for float or fixed RTK, 2 for fixed only
+  uint8_t minNumSV = 0;
+  float maxHAcc = INFINITY; // m
+};
+
+// Scatter of the selected positions. Deviations are in metres north, east and up of the
+// mean position.
+struct PositionStats
+{
+  size_t count;
+  double lat, lon, height;  // Mean, degrees and m
+  double north, east, up;   // Standard deviation, m
+  double cep50, cep95;      // Radius around the mean holding 50% and 95% of the positions, m
+  double hAcc, vAcc;        // Mean of the receiver's estimates, m
+};
+
+class EpochStore
+{
+  public:
+    void reserve(size_t epochs)
+    {
+      time.reserve(epochs);
+      lat.reserve(epochs);
+      lon.reserve(epochs);
+      height.reserve(epochs);
+      hAcc.reserve(epochs);
+      vAcc.reserve(epochs);
+      fixType.reserve(epochs);
+      carrSoln.reserve(epochs);
+      numSV.reserve(epochs);
+      highPrecision.reserve(epochs);
+    };
+    size_t size() const { return time.size(); };
+    EpochRange all() const { return EpochRange { 0, size() }; };
+
+    // A PVT starts an epoch. Epochs without a valid date and time are dropped, they can't be
+    // put in order.
+    void addPVT(const UBX_NAV_PVT_data_t &pvt)
+    {
+      if(!pvt.valid.bits.validDate || !pvt.valid.bits.validTime)
+      {
+        dropped++;
+        return;
+      }
+      uint64_t t = gpsMillis(gpsWeek(pvt.year, pvt.month, pvt.day, pvt.hour, pvt.min, pvt.sec, pvt.iTOW), pvt.iTOW);
+      _sorted = _sorted && (time.empty() || time.back() <= (int64_t)t);
+      time.push_back(t);
+      lat.push_back(pvt.lat * 1e-7);
+      lon.push_back(pvt.lon * 1e-7);
+      height.push_back(pvt.height * 1e-3);
+      hAcc.push_back(pvt.hAcc * 1e-3f);
+      vAcc.push_back(pvt.vAcc * 1e-3f);
+      fixType.push_back(pvt.fixType);
+      carrSoln.push_back(pvt.flags.bits.carrSoln);
+      numSV.push_back(pvt.numSV);
+      highPrecision.push_back(0);
+      if(_havePendingHp && _pendingHp.iTOW == pvt.iTOW)
+        applyHp(size() - 1, _pendingHp);
+      _havePendingHp = false;
+    };
+    // HPPOSLLH replaces the position of the epoch's PVT, before or after it
+    void addHPPOSLLH(const UBX_NAV_HPPOSLLH_data_t &hp)
+    {
+      if(hp.flags.bits.invalidLlh)
+        return;
+      if(!time.empty() && !highPrecision.back() && time.back() % GPS_WEEK_MS == hp.iTOW)
+        applyHp(size() - 1, hp);
+      else
+      {
+        _pendingHp = hp;
+        _havePendingHp = true;
+      }
+    };
+
+    bool isSorted() const { return _sorted; };
+    void sortByTime()
+    {
+      if(_sorted)
+        return;
+      std::vector<size_t> order(size());
+      for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+      std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return time[a] < time[b]; });
+      permute(time, order);
+      permute(lat, order);
+      permute(lon, order);
+      permute(height, order);
+      permute(hAcc, order);
+      permute(vAcc, order);
+      permute(fixType, order);
+      permute(carrSoln, order);
+      permute(numSV, order);
+      permute(highPrecision, order);
+      _sorted = true;
+    };
+
+    // Epochs from start to before end, ms since the GPS epoch. The store must be sorted.
+    EpochRange window(uint64_t start, uint64_t end) const
+    {
+      EpochRange range;
+      range.begin = std::lower_bound(time.begin(), time.end(), (int64_t)start) - time.begin();
+      range.end = std::lower_bound(time.begin() + range.begin, time.end(), (int64_t)end) - time.begin();
+      return range;
+    };
+
+    // Sets mask[i] to 1 for the epochs of range that pass filter, 0 for the others. mask is
+    // indexed like the store. Returns how many passed.
+    size_t select(EpochRange range, const EpochFilter &filter, std::vector<uint8_t> &mask) const
+    {
+      mask.resize(size());
+      const uint8_t *fix = fixType.data();
+      const uint8_t *carr = carrSoln.data();
+      const uint8_t *sv = numSV.data();
+      const float *acc = hAcc.data();
+      uint8_t *m = mask.data();
+      size_t count = 0;
+#pragma omp simd reduction(+:count)
+      for(size_t i = range.begin; i < range.end; i++)
+      {
+        uint8_t pass = (fix[i] >= filter.minFixType) & (carr[i] >= filter.minCarrSoln) &
+          (sv[i] >= filter.minNumSV) & (acc[i] <= filter.maxHAcc);
+        m[i] = pass;
+        count += pass;
+      }
+      return count;
+    };
+
+    // Scatter of the epochs of range selected in mask. Two passes over the arrays, for the
+    // mean and then the deviations from it, plus a partial sort of the distances for the CEP.
+    PositionStats positionStats(EpochRange range, const std::vector<uint8_t> &mask) const
+    {
+      PositionStats stats = PositionStats();
+      const uint8_t *m = mask.data();
+      size_t first = range.begin;
+      while(first < range.end && !m[first])
+        first++;
+      if(first == range.end)
+        return stats;
+
+      // Sums relative to the first position, so the doubles keep their precision
+      const double *la = lat.data(), *lo = lon.data(), *h = height.data();
+      const float *ha = hAcc.data(), *va = vAcc.data();
+      double lat0 = la[first], lon0 = lo[first], height0 = h[first];
+      double sumLat = 0, sumLon = 0, sumHeight = 0, sumHAcc = 0, sumVAcc = 0;
+      size_t count = 0;
+#pragma omp simd reduction(+:sumLat, sumLon, sumHeight, sumHAcc, sumVAcc, count)
+      for(size_t i = range.begin; i < range.end; i++)
+      {
+        double w = m[i];
+        sumLat += w * (la[i] - lat0);
+        sumLon += w * (lo[i] - lon0);
+        sumHeight += w * (h[i] - height0);
+        sumHAcc += w * ha[i];
+        sumVAcc += w * va[i];
+        count += m[i];
+      }
+      stats.count = count;
+      stats.lat = lat0 + sumLat / count;
+      stats.lon = lon0 + sumLon / count;
+      stats.height = height0 + sumHeight / count;
+      stats.hAcc = sumHAcc / count;
+      stats.vAcc = sumVAcc / count;
+
+      // Degrees to metres on the ellipsoid at the mean position
+      double phi = stats.lat * M_PI / 180;
+      double w2 = 1 - WGS84_E2 * sin(phi) * sin(phi);
+      double northPerDegree = WGS84_A * (1 - WGS84_E2) / (w2 * sqrt(w2)) * M_PI / 180;
+      double eastPerDegree = WGS84_A / sqrt(w2) * cos(phi) * M_PI / 180;
+
+      // Horizontal distances of the unselected epochs are infinite, so they sort last
+      std::vector<double> distance(range.size());
+      double *d = distance.data();
+      double sumNorth = 0, sumEast = 0, sumUp = 0;
+#pragma omp simd reduction(+:sumNorth, sumEast, sumUp)
+      for(size_t i = range.begin; i < range.end; i++)
+      {
+        double w = m[i];
+        double north = (la[i] - stats.lat) * northPerDegree;
+        double east = (lo[i] - stats.lon) * eastPerDegree;
+        double up = h[i] - stats.height;
+        sumNorth += w * north * north;
+        sumEast += w * east * east;
+        sumUp += w * up * up;
+        d[i - range.begin] = m[i] ? sqrt(north * north + east * east) : INFINITY;
+      }
+      stats.north = sqrt(sumNorth / count);
+      stats.east = sqrt(sumEast / count);
+      stats.up = sqrt(sumUp / count);
+      // The 95% pass leaves the smaller distances in front, so the 50% pass only looks there
+      size_t n95 = percentileIndex(count, 0.95);
+      std::nth_element(distance.begin(), distance.begin() + n95, distance.end());
+      stats.cep95 = distance[n95];
+      size_t n50 = percentileIndex(count, 0.50);
+      std::nth_element(distance.begin(), distance.begin() + n50, distance.begin() + n95 + 1);
+      stats.cep50 = distance[n50];
+      return stats;
+    };
+
+    std::vector<int64_t> time;           // ms since the GPS epoch
+    std::vector<double> lat;             // degrees
+    std::vector<double> lon;             // degrees
+    std::vector<double> height;          // Above the ellipsoid, m
+    std::vector<float> hAcc;             // m
+    std::vector<float> vAcc;             // m
+    std::vector<uint8_t> fixType;
+    std::vector<uint8_t> carrSoln;
+    std::vector<uint8_t> numSV;
+    std::vector<uint8_t> highPrecision;  // 1 if the position is from HPPOSLLH
+    uint32_t dropped = 0;                // PVTs without a valid time
+
+  private:
+    void applyHp(size_t i, const UBX_NAV_HPPOSLLH_data_t &hp)
+    {
+      lat[i] = hp.lat * 1e-7 + hp.latHp * 1e-9;
+      lon[i] = hp.lon * 1e-7 + hp.lonHp * 1e-9;
+      height[i] = hp.height * 1e-3 + hp.heightHp * 1e-4;
+      hAcc[i] = hp.hAcc * 1e-4f;
+      vAcc[i] = hp.vAcc * 1e-4f;
+      highPrecision[i] = 1;
+    };
+    template<typename T> static void permute(std::vector<T> &column, const std::vector<size_t> &order)
+    {
+      std::vector<T> sorted(column.size());
+      for(size_t i = 0; i < order.size(); i++)
+        sorted[i] = column[order[i]];
+      column.swap(sorted);
+    };
+    // Index of the value below which fraction of count sorted values lie
+    static size_t percentileIndex(size_t count, double fraction)
+    {
+      size_t n = (size_t)ceil(fraction * count);
+      return n > 0 ? n - 1 : 0;
+    };
+
+    bool _sorted = true;
+    UBX_NAV_HPPOSLLH_data_t _pendingHp;
+    bool _havePendingHp = false;
+};
+
+#endif
@@ -0,0 +1,239 @@
+// Checks the u-blox library's file buffer, the lock-free single producer, single consumer
+// ring that logged UBX frames wait in. A capture is parsed by the library over and over, so
+// its PVT, HPPOSLLH and RAWX frames are stored in the ring, and everything that comes out is
+// compared byte for byte with those frames of the capture, 300 MB of them unless -m says otherwise.
+//  - By default one thread alternates parsing and draining through UbxLogger, like loop().
+//  - With -t a producer thread parses and a consumer thread drains with
+//    getFileBufferSpan()/consumeFileBufferData() and extractFileBufferData() in odd sized
+//    pieces, so head and tail race. Build with -fsanitize=thread to have ThreadSanitizer
+//    check the ordering as well.
+// The default request of 200000 bytes becomes a 128KB ring, which 300 MB wraps around a few
+// thousand times.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -pthread -DARDUINO=10813 -DLOGGER_POSIX -Itools/host
+//     -Isrc/GpsStatusDisplay tools/host/filebuffertest.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o filebuffertest
+//
+// Usage: filebuffertest [-t] [-m megabytes] [-f file buffer bytes] capture.ubx
+//   ubxreplay -g makes up a capture.
+
+#include "receiverstream.h"
+#include "ubxlogreader.h"
+#include "logger.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+#define READ_BYTES 2048 // Received per pass in the one thread mode
+
+// What the producer hands the library at once: a frame and the bytes before it that aren't one
+struct CaptureWindow
+{
+  const uint8_t *data;
+  size_t length;
+  size_t logged; // Bytes that go into the file buffer
+};
+
+// Splits the capture into windows, and collects the frames that should come out of the file
+// buffer, in order
+static std::vector<CaptureWindow> windowCapture(const uint8_t *p, const uint8_t *end, std::string &logged)
+{
+  std::vector<CaptureWindow> windows;
+  const uint8_t *fed = p;
+  size_t length;
+  uint8_t protocol;
+  bool valid;
+  while((p = nextFrame(p, end, length, protocol, valid)) < end)
+  {
+    const uint8_t *next = frameEnd(p, length, valid);
+    CaptureWindow window = { fed, (size_t)(next - fed), 0 };
+    if(protocol == PROTOCOL_UBX && valid &&
+      ((p[2] == UBX_CLASS_NAV && (p[3] == UBX_NAV_PVT || p[3] == UBX_NAV_HPPOSLLH)) ||
+      (p[2] == UBX_CLASS_RXM && p[3] == UBX_RXM_RAWX)))
+    {
+      logged.append((const char *)p, length);
+      window.logged = length;
+    }
+    windows.push_back(window);
+    fed = p = next;
+  }
+  return windows;
+}
+
+// Compares the output with the logged frames of the capture, repeated
+class OutputCheck
+{
+  public:
+    OutputCheck(const std::string &expected) : _expected(expected) {};
+    void check(const uint8_t *data, size_t length)
+    {
+      while(length > 0)
+      {
+        size_t position = checked % _expected.size();
+        size_t count = _expected.size() - position < length ? _expected.size() - position : length;
+        if(memcmp(data, _expected.data() + position, count) != 0)
+          mismatches++;
+        checked += count;
+        data += count;
+        length -= count;
+      }
+    };
+    uint64_t checked = 0;
+    uint32_t mismatches = 0; // Compared pieces that differ
+
+  private:
+    const std::string &_expected;
+};
+
+class CheckingLogFile : public LogBlockDevice
+{
+  public:
+    CheckingLogFile(OutputCheck &check) : _check(check) {};
+    bool begin() override { return true; };
+    bool writeBlocks(const uint8_t *data, uint16_t count) override
+    {
+      _check.check(data, (size_t)count * LOG_BLOCK_SIZE);
+      return true;
+    };
+    bool writeTail(const uint8_t *data, uint16_t length) override
+    {
+      _check.check(data, length);
+      return true;
+    };
+    bool sync() override { return true; };
+    void end() override { };
+
+  private:
+    OutputCheck &_check;
+};
+
+static uint32_t randomState = 12345;
+static uint32_t randomNumber()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 16;
+}
+
+int main(int argc, char **argv)
+{
+  bool threaded = false;
+  uint64_t megabytes = 300;
+  uint32_t fileBufferSize = 200000;
+  const char *path = nullptr;
+  bool usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-t"))
+      threaded = true;
+    else if(!strcmp(argv[i], "-m") && i + 1 < argc)
+      megabytes = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+      fileBufferSize = atoi(argv[++i]);
+    else if(argv[i][0] != '-' && path == nullptr)
+      path = argv[i];
+    else
+      usage = true;
+  }
+  if(usage || path == nullptr)
+  {
+    fprintf(stderr, "Usage: filebuffertest [-t] [-m megabytes] [-f file buffer bytes] capture.ubx\n");
+    return 1;
+  }
+  MappedFile capture;
+  if(!capture.open(path))
+  {
+    perror(path);
+    return 1;
+  }
+  std::string expected;
+  std::vector<CaptureWindow> windows = windowCapture(capture.data(), capture.data() + capture.size(), expected);
+  if(expected.empty())
+  {
+    fprintf(stderr, "%s: no PVT, HPPOSLLH or RAWX frames\n", path);
+    return 1;
+  }
+  uint32_t passes = (uint32_t)((megabytes * 1000000 + expected.size() - 1) / expected.size());
+  uint64_t total = (uint64_t)passes * expected.size();
+
+  ReceiverStream stream;
+  SFE_UBLOX_GNSS gps;
+  gps.setFileBufferSize(fileBufferSize);
+  if(!gps.begin(stream) || !gps.setAutoPVT(true, false) || !gps.setAutoHPPOSLLH(true, false) ||
+    !gps.setAutoRXMRAWX(true, false))
+  {
+    fprintf(stderr, "The library didn't accept the stand-in receiver\n");
+    return 1;
+  }
+  gps.logNAVPVT();
+  gps.logNAVHPPOSLLH();
+  gps.logRXMRAWX();
+  uint32_t ringSize = gps.getFileBufferSize();
+
+  OutputCheck check(expected);
+  if(!threaded)
+  {
+    CheckingLogFile file(check);
+    UbxLogger logger(&file);
+    logger.begin(&gps);
+    for(uint32_t pass = 0; pass < passes; pass++)
+      for(size_t offset = 0; offset < capture.size(); offset += READ_BYTES)
+      {
+        stream.setWindow(capture.data() + offset, capture.size() - offset < READ_BYTES ? capture.size() - offset : READ_BYTES);
+        gps.checkUblox();
+        logger.service();
+      }
+    logger.end();
+  }
+  else
+  {
+    std::atomic<bool> produced(false);
+    std::atomic<bool> stopped(false); // The consumer is done, or gave up after a difference
+    std::thread producer([&]() {
+      for(uint32_t pass = 0; pass < passes; pass++)
+        for(size_t i = 0; i < windows.size(); i++)
+        {
+          // Wait for room rather than have the frame dropped
+          while(ringSize - gps.fileBufferAvailable() < windows[i].logged && !stopped)
+            std::this_thread::yield();
+          stream.setWindow(windows[i].data, windows[i].length);
+          gps.checkUblox();
+        }
+      produced = true;
+    });
+    std::thread consumer([&]() {
+      uint8_t piece[4096];
+      while(check.checked < total)
+      {
+        uint32_t want = 1 + randomNumber() % sizeof(piece);
+        if(randomNumber() % 2 == 0)
+        {
+          uint32_t count = gps.extractFileBufferData(piece, want);
+          check.check(piece, count);
+        }
+        else
+        {
+          const uint8_t *span;
+          uint32_t count = gps.getFileBufferSpan(&span);
+          if(count > want)
+            count = want;
+          check.check(span, count);
+          gps.consumeFileBufferData(count);
+        }
+        if(check.mismatches > 0 || (produced && gps.fileBufferAvailable() == 0))
+          break;
+      }
+      stopped = true;
+    });
+    producer.join();
+    consumer.join();
+  }
+
+  printf("%s, %u byte ring: %llu of %llu bytes out, %u pieces different, %u frames dropped, max fill %u\n",
+    threaded ? "producer and consumer threads" : "one thread through UbxLogger", ringSize,
+    (unsigned long long)check.checked, (unsigned long long)total, check.mismatches,
+    gps.getFileBufferDropped(), gps.getMaxFileBufferAvail());
+  bool passed = check.checked == total && check.mismatches == 0 && gps.getFileBufferDropped() == 0;
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? 0 : 1;
+}
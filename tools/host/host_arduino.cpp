@@ -0,0 +1,57 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "SPI.h"
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static bool virtualClock = false;
+static unsigned long long virtualMicros = 0;
+
+void host_UseVirtualClock() { virtualClock = true; }
+void host_AdvanceClock(unsigned long us) { virtualMicros += us; }
+
+unsigned long millis()
+{
+  if(virtualClock)
+    return (unsigned long)(virtualMicros / 1000);
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+  if(virtualClock)
+    return (unsigned long)virtualMicros;
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms)
+{
+  if(virtualClock)
+    virtualMicros += (unsigned long long)ms * 1000;
+  else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+// Buttons are active low, so nothing is pressed until a test pulls a pin low
+static uint8_t pinLevels[256];
+static bool pinLevelsSet = false;
+static void (*pinHandlers[256])();
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int) { pinHandlers[interrupt] = handler; }
+void host_SetPin(uint8_t pin, int level)
+{
+  if(!pinLevelsSet)
+    memset(pinLevels, HIGH, sizeof(pinLevels));
+  pinLevelsSet = true;
+  bool changed = pinLevels[pin] != level;
+  pinLevels[pin] = level;
+  if(changed && pinHandlers[pin])
+    pinHandlers[pin]();
+}
+int digitalRead(uint8_t pin) { return pinLevelsSet ? pinLevels[pin] : HIGH; }
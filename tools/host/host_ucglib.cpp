@@ -0,0 +1,553 @@
+// Host implementation of the Ucglib subset declared in Ucglib.h.
+// The SSD1351 device callback below produces the same command/data byte stream as the real
+// driver, and the ucg_com_* layer decodes that stream into emulated panel RAM.
+
+#include "Ucglib.h"
+
+#define PANEL_WIDTH 128
+#define PANEL_HEIGHT 128
+
+UcgHostStats ucgHostStats;
+
+// Emulated SSD1351
+static struct
+{
+  uint16_t ram[PANEL_WIDTH * PANEL_HEIGHT]; // RGB565, like the sketch's framebuffer
+  bool on;
+  uint8_t cs;
+  uint8_t cd;
+  uint8_t command;
+  uint8_t argCount;
+  uint8_t args[2];
+  uint8_t column0, column1, row0, row1;
+  uint8_t x, y;
+  bool writingRam;
+  uint8_t pixelBytes[3];
+  uint8_t pixelByteCount;
+} panel = { {0}, false, 1, 1, 0, 0, {0, 0}, 0, PANEL_WIDTH - 1, 0, PANEL_HEIGHT - 1, 0, 0, false, {0, 0, 0}, 0 };
+
+static uint32_t busNanosPerByte = 0;
+static uint32_t busNanos = 0;
+void ucg_host_SetBusTime(uint32_t nanosPerByte)
+{
+  busNanosPerByte = nanosPerByte;
+}
+
+void ucg_host_ResetStats()
+{
+  memset(&ucgHostStats, 0, sizeof(ucgHostStats));
+}
+
+uint16_t ucg_host_GetPixel(ucg_int_t x, ucg_int_t y)
+{
+  if(x < 0 || y < 0 || x >= PANEL_WIDTH || y >= PANEL_HEIGHT)
+    return 0;
+  return panel.ram[y * PANEL_WIDTH + x];
+}
+
+bool ucg_host_WritePPM(const char *path)
+{
+  FILE *file = fopen(path, "wb");
+  if(!file)
+    return false;
+  fprintf(file, "P6\n%d %d\n255\n", PANEL_WIDTH, PANEL_HEIGHT);
+  for(int i = 0; i < PANEL_WIDTH * PANEL_HEIGHT; i++)
+  {
+    uint16_t c = panel.on ? panel.ram[i] : 0;
+    uint8_t rgb[3] = { (uint8_t)((c >> 11) << 3), (uint8_t)(((c >> 5) & 0x3F) << 2), (uint8_t)((c & 0x1F) << 3) };
+    fwrite(rgb, 1, 3, file);
+  }
+  return fclose(file) == 0;
+}
+
+static void panelCommand(uint8_t command)
+{
+  ucgHostStats.commandBytes++;
+  panel.command = command;
+  panel.argCount = 0;
+  panel.writingRam = false;
+  if(command == 0x5C) // Write RAM: data bytes that follow are pixels
+  {
+    ucgHostStats.windows++;
+    panel.writingRam = true;
+    panel.pixelByteCount = 0;
+    panel.x = panel.column0;
+    panel.y = panel.row0;
+  }
+  else if(command == 0xAF)
+    panel.on = true;
+  else if(command == 0xAE)
+    panel.on = false;
+}
+
+static void panelData(uint8_t data)
+{
+  if(panel.writingRam)
+  {
+    // 18-bit mode: 6 bits per channel, one byte each
+    panel.pixelBytes[panel.pixelByteCount++] = data;
+    if(panel.pixelByteCount < 3)
+      return;
+    panel.pixelByteCount = 0;
+    if(panel.x < PANEL_WIDTH && panel.y < PANEL_HEIGHT)
+      panel.ram[panel.y * PANEL_WIDTH + panel.x] =
+        ((panel.pixelBytes[0] & 0x3E) << 10) | ((panel.pixelBytes[1] & 0x3F) << 5) | ((panel.pixelBytes[2] & 0x3E) >> 1);
+    ucgHostStats.pixels++;
+    // Address auto-increments within the window, wrapping to its top left corner
+    if(panel.x++ >= panel.column1)
+    {
+      panel.x = panel.column0;
+      if(panel.y++ >= panel.row1)
+        panel.y = panel.row0;
+    }
+    return;
+  }
+  if(panel.argCount < 2)
+    panel.args[panel.argCount] = data;
+  panel.argCount++;
+  if(panel.argCount != 2)
+    return;
+  if(panel.command == 0x15)
+  {
+    panel.column0 = panel.args[0];
+    panel.column1 = panel.args[1];
+  }
+  else if(panel.command == 0x75)
+  {
+    panel.row0 = panel.args[0];
+    panel.row1 = panel.args[1];
+  }
+}
+
+void ucg_com_SetCSLineStatus(ucg_t *, uint8_t level)
+{
+  panel.cs = level;
+}
+
+void ucg_com_SetCDLineStatus(ucg_t *, uint8_t level)
+{
+  panel.cd = level;
+}
+
+void ucg_com_SendByte(ucg_t *, uint8_t byte)
+{
+  ucgHostStats.spiBytes++;
+  if(busNanosPerByte > 0)
+  {
+    busNanos += busNanosPerByte;
+    host_AdvanceClock(busNanos / 1000);
+    busNanos %= 1000;
+  }
+  if(panel.cs != 0)
+    return; // Not selected
+  if(panel.cd == 0)
+    panelCommand(byte);
+  else
+    panelData(byte);
+}
+
+void ucg_com_SendString(ucg_t *ucg, uint16_t cnt, const uint8_t *byte_ptr)
+{
+  while(cnt-- > 0)
+    ucg_com_SendByte(ucg, *byte_ptr++);
+}
+
+static void sendCommand(ucg_t *ucg, uint8_t command)
+{
+  ucg_com_SetCDLineStatus(ucg, 0);
+  ucg_com_SendByte(ucg, command);
+  ucg_com_SetCDLineStatus(ucg, 1);
+}
+
+static void setWindow(ucg_t *ucg, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+  sendCommand(ucg, 0x15);
+  ucg_com_SendByte(ucg, x0);
+  ucg_com_SendByte(ucg, x1);
+  sendCommand(ucg, 0x75);
+  ucg_com_SendByte(ucg, y0);
+  ucg_com_SendByte(ucg, y1);
+  sendCommand(ucg, 0x5C);
+}
+
+static void sendColor(ucg_t *ucg, const ucg_color_t &color)
+{
+  uint8_t bytes[3] = { (uint8_t)(color.color[0] >> 2), (uint8_t)(color.color[1] >> 2), (uint8_t)(color.color[2] >> 2) };
+  ucg_com_SendString(ucg, 3, bytes);
+}
+
+ucg_int_t ucg_clip_is_pixel_visible(ucg_t *ucg)
+{
+  const ucg_xy_t &p = ucg->arg.pixel.pos;
+  const ucg_box_t &clip = ucg->clip_box;
+  return p.x >= clip.ul.x && p.y >= clip.ul.y && p.x < clip.ul.x + clip.size.w && p.y < clip.ul.y + clip.size.h;
+}
+
+static void nextPixel(ucg_t *ucg)
+{
+  switch(ucg->arg.dir)
+  {
+    case 0: ucg->arg.pixel.pos.x++; break;
+    case 1: ucg->arg.pixel.pos.y++; break;
+    case 2: ucg->arg.pixel.pos.x--; break;
+    default: ucg->arg.pixel.pos.y--; break;
+  }
+}
+
+static bool bitmapBit(const unsigned char *bitmap, ucg_int_t i)
+{
+  return (bitmap[i >> 3] & (0x80 >> (i & 7))) != 0;
+}
+
+// Generic line handlers: break the line into DRAW_PIXEL messages for dev_cb
+void ucg_handle_l90fx(ucg_t *ucg, ucg_dev_fnptr dev_cb)
+{
+  ucg_xy_t start = ucg->arg.pixel.pos;
+  for(ucg_int_t i = 0; i < ucg->arg.len; i++, nextPixel(ucg))
+    if(ucg_clip_is_pixel_visible(ucg))
+      dev_cb(ucg, UCG_MSG_DRAW_PIXEL, nullptr);
+  ucg->arg.pixel.pos = start;
+}
+
+void ucg_handle_l90tc(ucg_t *ucg, ucg_dev_fnptr dev_cb)
+{
+  ucg_xy_t start = ucg->arg.pixel.pos;
+  for(ucg_int_t i = 0; i < ucg->arg.len; i++, nextPixel(ucg))
+    if(bitmapBit(ucg->arg.bitmap, i) && ucg_clip_is_pixel_visible(ucg))
+      dev_cb(ucg, UCG_MSG_DRAW_PIXEL, nullptr);
+  ucg->arg.pixel.pos = start;
+}
+
+void ucg_handle_l90bf(ucg_t *ucg, ucg_dev_fnptr dev_cb)
+{
+  ucg_xy_t start = ucg->arg.pixel.pos;
+  for(ucg_int_t i = 0; i < ucg->arg.len; i++, nextPixel(ucg))
+  {
+    ucg->arg.pixel.rgb = ucg->arg.rgb[bitmapBit(ucg->arg.bitmap, i) ? 0 : 1];
+    if(ucg_clip_is_pixel_visible(ucg))
+      dev_cb(ucg, UCG_MSG_DRAW_PIXEL, nullptr);
+  }
+  ucg->arg.pixel.pos = start;
+}
+
+// Shaded line from rgb[0] to rgb[1]
+void ucg_handle_l90se(ucg_t *ucg, ucg_dev_fnptr dev_cb)
+{
+  ucg_xy_t start = ucg->arg.pixel.pos;
+  ucg_int_t len = ucg->arg.len;
+  for(ucg_int_t i = 0; i < len; i++, nextPixel(ucg))
+  {
+    for(uint8_t c = 0; c < 3; c++)
+      ucg->arg.pixel.rgb.color[c] = ucg->arg.rgb[0].color[c] + (ucg->arg.rgb[1].color[c] - ucg->arg.rgb[0].color[c]) * i / (len > 1 ? len - 1 : 1);
+    if(ucg_clip_is_pixel_visible(ucg))
+      dev_cb(ucg, UCG_MSG_DRAW_PIXEL, nullptr);
+  }
+  ucg->arg.pixel.pos = start;
+}
+
+// Same traffic as Ucglib's SSD1351 driver: a single pixel costs a full address window,
+// a solid line is one window plus its pixels, bitmap lines go pixel by pixel.
+ucg_int_t ucg_dev_ssd1351_18x128x128_ft(ucg_t *ucg, ucg_int_t msg, void *)
+{
+  switch(msg)
+  {
+    case UCG_MSG_DEV_POWER_UP:
+      ucg_com_SetCSLineStatus(ucg, 0);
+      sendCommand(ucg, 0xAF); // Display on
+      ucg_com_SetCSLineStatus(ucg, 1);
+      return 1;
+    case UCG_MSG_DEV_POWER_DOWN:
+      ucg_com_SetCSLineStatus(ucg, 0);
+      sendCommand(ucg, 0xAE); // Display off
+      ucg_com_SetCSLineStatus(ucg, 1);
+      return 1;
+    case UCG_MSG_DRAW_PIXEL:
+    {
+      if(!ucg_clip_is_pixel_visible(ucg))
+        return 1;
+      uint8_t x = ucg->arg.pixel.pos.x;
+      uint8_t y = ucg->arg.pixel.pos.y;
+      ucg_com_SetCSLineStatus(ucg, 0);
+      setWindow(ucg, x, y, x, y);
+      sendColor(ucg, ucg->arg.pixel.rgb);
+      ucg_com_SetCSLineStatus(ucg, 1);
+      return 1;
+    }
+    case UCG_MSG_DRAW_L90FX:
+    {
+      // Lines arrive clipped. Window from the lowest address so left/up lines work too.
+      ucg_int_t len = ucg->arg.len;
+      if(len <= 0)
+        return 1;
+      ucg_int_t x0 = ucg->arg.pixel.pos.x, y0 = ucg->arg.pixel.pos.y;
+      ucg_int_t x1 = x0, y1 = y0;
+      switch(ucg->arg.dir)
+      {
+        case 0: x1 = x0 + len - 1; break;
+        case 1: y1 = y0 + len - 1; break;
+        case 2: x1 = x0; x0 = x0 - len + 1; break;
+        default: y1 = y0; y0 = y0 - len + 1; break;
+      }
+      ucg_com_SetCSLineStatus(ucg, 0);
+      setWindow(ucg, x0, y0, x1, y1);
+      for(ucg_int_t i = 0; i < len; i++)
+        sendColor(ucg, ucg->arg.pixel.rgb);
+      ucg_com_SetCSLineStatus(ucg, 1);
+      return 1;
+    }
+    case UCG_MSG_DRAW_L90TC:
+      ucg_handle_l90tc(ucg, ucg_dev_ssd1351_18x128x128_ft);
+      return 1;
+    case UCG_MSG_DRAW_L90BF:
+      ucg_handle_l90bf(ucg, ucg_dev_ssd1351_18x128x128_ft);
+      return 1;
+    case UCG_MSG_DRAW_L90SE:
+      ucg_handle_l90se(ucg, ucg_dev_ssd1351_18x128x128_ft);
+      return 1;
+  }
+  return 0;
+}
+
+ucg_int_t ucg_ext_ssd1351_18(ucg_t *, ucg_int_t, void *) { return 0; }
+ucg_int_t ucg_ext_none(ucg_t *, ucg_int_t, void *) { return 0; }
+
+// Fonts. Each "font" is the 5x7 glcd font scaled to a glyph cell:
+// { cell width, cell height including one descender row, advance, bold }
+const ucg_fntpgm_uint8_t ucg_font_helvR08_hr[] = { 5, 8, 6, 0 };
+const ucg_fntpgm_uint8_t ucg_font_helvR10_hr[] = { 7, 11, 8, 0 };
+const ucg_fntpgm_uint8_t ucg_font_helvR14_hr[] = { 8, 16, 10, 0 };
+const ucg_fntpgm_uint8_t ucg_font_helvB10_hr[] = { 7, 11, 9, 1 };
+
+// 5x7 font for ASCII 32..126. Five columns per glyph, bit 0 is the top row.
+static const uint8_t glcdFont[95][5] = {
+  {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14},
+  {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x56,0x20,0x50}, {0x00,0x05,0x03,0x00,0x00},
+  {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08},
+  {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02},
+  {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31},
+  {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03},
+  {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00},
+  {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06},
+  {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+  {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A},
+  {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41},
+  {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+  {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31},
+  {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F},
+  {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00},
+  {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40},
+  {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20},
+  {0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E},
+  {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00},
+  {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38},
+  {0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20},
+  {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C},
+  {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00},
+  {0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x10,0x08,0x08,0x10,0x08},
+};
+
+static uint8_t fontWidth(const ucg_fntpgm_uint8_t *font) { return font[0]; }
+static uint8_t fontHeight(const ucg_fntpgm_uint8_t *font) { return font[1]; }
+static uint8_t fontAdvance(const ucg_fntpgm_uint8_t *font) { return font[2]; }
+static uint8_t fontAscent(const ucg_fntpgm_uint8_t *font) { return (7 * font[1] + 7) / 8; }
+
+// The _hr fonts only cover ASCII, anything else has no glyph
+ucg_int_t ucg_GetGlyphWidth(ucg_t *ucg, uint8_t requested_encoding)
+{
+  if(!ucg->font || requested_encoding < 32 || requested_encoding > 126)
+    return 0;
+  return fontAdvance(ucg->font);
+}
+
+static bool glyphBit(const ucg_fntpgm_uint8_t *font, uint8_t encoding, uint8_t column, uint8_t row)
+{
+  uint8_t sourceRow = row * 8 / fontHeight(font);
+  if(sourceRow > 6)
+    return false;
+  const uint8_t *glyph = glcdFont[encoding - 32];
+  uint8_t sourceColumn = column * 5 / fontWidth(font);
+  if(glyph[sourceColumn] & (1 << sourceRow))
+    return true;
+  // Bold: smear one column to the right
+  return font[3] && column > 0 && (glyph[(column - 1) * 5 / fontWidth(font)] & (1 << sourceRow));
+}
+
+Ucglib::Ucglib(ucg_dev_fnptr dev, ucg_dev_fnptr ext)
+{
+  memset(&ucg, 0, sizeof(ucg));
+  ucg.device_cb = dev;
+  ucg.ext_cb = ext;
+  ucg.dimension.w = PANEL_WIDTH;
+  ucg.dimension.h = PANEL_HEIGHT;
+  ucg.clip_box.size = ucg.dimension;
+}
+
+void Ucglib::begin(uint8_t is_transparent)
+{
+  ucg.font_mode = is_transparent;
+  powerUp();
+}
+
+void Ucglib::powerDown() { ucg.device_cb(&ucg, UCG_MSG_DEV_POWER_DOWN, nullptr); }
+void Ucglib::powerUp() { ucg.device_cb(&ucg, UCG_MSG_DEV_POWER_UP, nullptr); }
+
+// Like Ucglib, this leaves color 0 set to black
+void Ucglib::clearScreen()
+{
+  setColor(0, 0, 0, 0);
+  drawBox(0, 0, ucg.dimension.w, ucg.dimension.h);
+}
+
+void Ucglib::setColor(uint8_t idx, uint8_t r, uint8_t g, uint8_t b)
+{
+  ucg.arg.rgb[idx & 3].color[0] = r;
+  ucg.arg.rgb[idx & 3].color[1] = g;
+  ucg.arg.rgb[idx & 3].color[2] = b;
+}
+
+size_t Ucglib::write(uint8_t c)
+{
+  tx += drawGlyph(tx, ty, 0, c);
+  return 1;
+}
+
+ucg_int_t Ucglib::getStrWidth(const char *s)
+{
+  ucg_int_t width = 0;
+  while(*s)
+    width += ucg_GetGlyphWidth(&ucg, *s++);
+  return width;
+}
+
+int8_t Ucglib::getFontAscent() { return ucg.font ? fontAscent(ucg.font) : 0; }
+int8_t Ucglib::getFontDescent() { return ucg.font ? fontAscent(ucg.font) - fontHeight(ucg.font) : 0; }
+
+void Ucglib::drawPixel(ucg_int_t x, ucg_int_t y)
+{
+  ucg.arg.pixel.pos.x = x;
+  ucg.arg.pixel.pos.y = y;
+  ucg.arg.pixel.rgb = ucg.arg.rgb[0];
+  if(ucg_clip_is_pixel_visible(&ucg))
+    ucg.device_cb(&ucg, UCG_MSG_DRAW_PIXEL, nullptr);
+}
+
+void Ucglib::drawHLine(ucg_int_t x, ucg_int_t y, ucg_int_t len)
+{
+  const ucg_box_t &clip = ucg.clip_box;
+  if(y < clip.ul.y || y >= clip.ul.y + clip.size.h)
+    return;
+  if(x < clip.ul.x)
+  {
+    len -= clip.ul.x - x;
+    x = clip.ul.x;
+  }
+  if(x + len > clip.ul.x + clip.size.w)
+    len = clip.ul.x + clip.size.w - x;
+  if(len <= 0)
+    return;
+  ucg.arg.pixel.pos.x = x;
+  ucg.arg.pixel.pos.y = y;
+  ucg.arg.pixel.rgb = ucg.arg.rgb[0];
+  ucg.arg.len = len;
+  ucg.arg.dir = 0;
+  ucg.device_cb(&ucg, UCG_MSG_DRAW_L90FX, nullptr);
+}
+
+void Ucglib::drawVLine(ucg_int_t x, ucg_int_t y, ucg_int_t len)
+{
+  const ucg_box_t &clip = ucg.clip_box;
+  if(x < clip.ul.x || x >= clip.ul.x + clip.size.w)
+    return;
+  if(y < clip.ul.y)
+  {
+    len -= clip.ul.y - y;
+    y = clip.ul.y;
+  }
+  if(y + len > clip.ul.y + clip.size.h)
+    len = clip.ul.y + clip.size.h - y;
+  if(len <= 0)
+    return;
+  ucg.arg.pixel.pos.x = x;
+  ucg.arg.pixel.pos.y = y;
+  ucg.arg.pixel.rgb = ucg.arg.rgb[0];
+  ucg.arg.len = len;
+  ucg.arg.dir = 1;
+  ucg.device_cb(&ucg, UCG_MSG_DRAW_L90FX, nullptr);
+}
+
+void Ucglib::drawLine(ucg_int_t x1, ucg_int_t y1, ucg_int_t x2, ucg_int_t y2)
+{
+  ucg_int_t dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+  ucg_int_t dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+  ucg_int_t err = dx + dy;
+  for(;;)
+  {
+    drawPixel(x1, y1);
+    if(x1 == x2 && y1 == y2)
+      break;
+    ucg_int_t e2 = 2 * err;
+    if(e2 >= dy) { err += dy; x1 += sx; }
+    if(e2 <= dx) { err += dx; y1 += sy; }
+  }
+}
+
+void Ucglib::drawBox(ucg_int_t x, ucg_int_t y, ucg_int_t w, ucg_int_t h)
+{
+  while(h-- > 0)
+    drawHLine(x, y++, w);
+}
+
+void Ucglib::drawCircle(ucg_int_t x0, ucg_int_t y0, ucg_int_t rad, uint8_t option)
+{
+  ucg_int_t x = 0, y = rad;
+  ucg_int_t f = 1 - rad;
+  while(x <= y)
+  {
+    if(option & UCG_DRAW_UPPER_RIGHT) { drawPixel(x0 + x, y0 - y); drawPixel(x0 + y, y0 - x); }
+    if(option & UCG_DRAW_UPPER_LEFT) { drawPixel(x0 - x, y0 - y); drawPixel(x0 - y, y0 - x); }
+    if(option & UCG_DRAW_LOWER_RIGHT) { drawPixel(x0 + x, y0 + y); drawPixel(x0 + y, y0 + x); }
+    if(option & UCG_DRAW_LOWER_LEFT) { drawPixel(x0 - x, y0 + y); drawPixel(x0 - y, y0 + x); }
+    x++;
+    if(f < 0)
+      f += 2 * x + 1;
+    else
+    {
+      y--;
+      f += 2 * (x - y) + 1;
+    }
+  }
+}
+
+// Left to right only, which is all the sketch uses. Solid mode fills the glyph cell with color 1.
+ucg_int_t Ucglib::drawGlyph(ucg_int_t x, ucg_int_t y, uint8_t, uint8_t encoding)
+{
+  ucg_int_t advance = ucg_GetGlyphWidth(&ucg, encoding);
+  if(advance == 0)
+    return 0;
+  uint8_t height = fontHeight(ucg.font);
+  unsigned char row[4];
+  ucg.arg.pixel.rgb = ucg.arg.rgb[0];
+  ucg.arg.dir = 0;
+  ucg.arg.len = advance;
+  ucg.arg.bitmap = row;
+  for(uint8_t r = 0; r < height; r++)
+  {
+    memset(row, 0, sizeof(row));
+    for(uint8_t c = 0; c < fontWidth(ucg.font); c++)
+      if(glyphBit(ucg.font, encoding, c, r))
+        row[c >> 3] |= 0x80 >> (c & 7);
+    ucg.arg.pixel.pos.x = x;
+    ucg.arg.pixel.pos.y = y - fontAscent(ucg.font) + r;
+    ucg.device_cb(&ucg, ucg.font_mode == UCG_FONT_MODE_SOLID ? UCG_MSG_DRAW_L90BF : UCG_MSG_DRAW_L90TC, nullptr);
+  }
+  ucg.arg.bitmap = nullptr;
+  return advance;
+}
+
+ucg_int_t Ucglib::drawString(ucg_int_t x, ucg_int_t y, uint8_t dir, const char *str)
+{
+  ucg_int_t width = 0;
+  while(*str)
+    width += drawGlyph(x + width, y, dir, *str++);
+  return width;
+}
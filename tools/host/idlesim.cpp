@@ -0,0 +1,143 @@
+// Runs the sketch's loop() on a simulated clock and reports how it sleeps: time per power
+// state and wakeups by reason. Receiver epochs arrive at the navigation rate and a short
+// button script flips a page, lets the display time out and wakes it again.
+// Sending bytes to the display costs bus time at the SPI clock, everything else is free, so
+// the active time is mostly display traffic.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -DARDUINO=10813 -DIDLE_HOST -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/idlesim.cpp tools/host/host_arduino.cpp tools/host/host_ucglib.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp
+//     src/GpsStatusDisplay/Menu.cpp src/GpsStatusDisplay/buttons.cpp -o idlesim
+// The display options of pagerender apply, and -DPIN_GNSS_TXREADY=11 -DGNSS_TXREADY_PIO=6
+// simulates the receiver's TX ready signal instead of polling.
+//
+// Usage: idlesim [-s seconds] [-r navigation interval ms]
+
+#include "Arduino.h"
+void showDisplay(bool newPage);
+void drawStatusBar(bool newPage);
+#include "GpsStatusDisplay.ino"
+#include "synthetic.h"
+
+#define SPI_CLOCK_HZ 24000000
+
+static uint32_t navigationInterval = 1000;
+static unsigned long nextEpochTime = 0;
+static uint32_t epoch = 0;
+static uint32_t sleepTicks = 0;
+
+struct ButtonStep
+{
+  unsigned long time;
+  uint8_t pin;
+  uint8_t level;
+};
+// Flip a page, leave the display to time out, then wake it up
+static const ButtonStep buttonScript[] =
+{
+  { 10000, PIN_BUTTON_DOWN, LOW },
+  { 10150, PIN_BUTTON_DOWN, HIGH },
+  { 90000, PIN_BUTTON_DOWN, LOW },
+  { 90150, PIN_BUTTON_DOWN, HIGH },
+};
+static uint8_t nextButtonStep = 0;
+
+// Things that happen outside the CPU, up to the current time
+static void runWorld()
+{
+  unsigned long now = millis();
+  while((long)(now - nextEpochTime) >= 0)
+  {
+    // The receiver's callbacks would run on the next poll. Running them here only moves the
+    // data ready flag earlier, loop() still picks it up on its next pass
+    feedEpoch(epoch++);
+    nextEpochTime += navigationInterval;
+#ifdef PIN_GNSS_TXREADY
+    host_SetPin(PIN_GNSS_TXREADY, HIGH);
+    host_SetPin(PIN_GNSS_TXREADY, LOW);
+#endif
+  }
+  while(nextButtonStep < sizeof(buttonScript) / sizeof(buttonScript[0]) && (long)(now - buttonScript[nextButtonStep].time) >= 0)
+  {
+    host_SetPin(buttonScript[nextButtonStep].pin, buttonScript[nextButtonStep].level);
+    nextButtonStep++;
+  }
+}
+
+// The CPU sleeps until the next SysTick
+void idleCpuSleep()
+{
+  sleepTicks++;
+#ifdef DISPLAY_DMA
+  // The DMA keeps sending while the core sleeps, at no CPU cost
+  ucg_host_SetBusTime(0);
+  mockDma.step(SPI_CLOCK_HZ / 8 / 1000);
+  ucg_host_SetBusTime(8000000000ULL / SPI_CLOCK_HZ);
+#endif
+  host_AdvanceClock(1000 - micros() % 1000);
+  runWorld();
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+
+int main(int argc, char **argv)
+{
+  uint32_t seconds = 120;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-s") && i + 1 < argc)
+      seconds = strtoul(argv[++i], nullptr, 10);
+    else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+      navigationInterval = strtoul(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "Usage: %s [-s seconds] [-r navigation interval ms]\n", argv[0]);
+      return 1;
+    }
+  }
+  host_UseVirtualClock();
+  ucg_host_SetBusTime(8000000000ULL / SPI_CLOCK_HZ);
+
+  // setup() with a receiver that doesn't answer. Polls are just a NACK on the bus
+  initButtons();
+  ucg.begin(UCG_FONT_MODE_SOLID);
+  ucg.clearScreen();
+  ucg.setFontMode(UCG_FONT_MODE_SOLID);
+  gps.begin(Wire);
+#ifdef PIN_GNSS_TXREADY
+  gps.setI2CpollingWait(0);
+  attachInterrupt(digitalPinToInterrupt(PIN_GNSS_TXREADY), onGnssTxReady, RISING);
+#else
+  gps.setI2CpollingWait(GNSS_POLL_INTERVAL_MS - 2);
+#endif
+  menu->setDisplay(&ucg);
+  lastButtonPressTime = millis();
+  showDisplay(true);
+
+  uint32_t loopPasses = 0;
+  unsigned long end = (unsigned long)seconds * 1000;
+  while(millis() < end)
+  {
+    runWorld();
+    loop();
+    loopPasses++;
+  }
+
+  StdoutPrint out;
+  printf("Simulated %us, navigation every %ums, ", seconds, navigationInterval);
+#ifdef PIN_GNSS_TXREADY
+  printf("TX ready\n");
+#else
+  printf("polling every %ums\n", GNSS_POLL_INTERVAL_MS);
+#endif
+  printf("loop passes: %u (%.1f/s), frames: %u, epochs: %u, SysTick wakeups while sleeping: %u\n",
+    loopPasses, loopPasses / (float)seconds, renderScheduler.frames, epoch, sleepTicks);
+  idleScheduler.printStats(out);
+  return 0;
+}
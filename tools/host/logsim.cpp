@@ -0,0 +1,161 @@
+// Runs a receiver capture through the u-blox library's file buffer and UbxLogger into a file
+// on a simulated clock, the way the sketch logs with LOGGING (and LOG_RAWX). The capture
+// arrives at the navigation rate, one epoch per NAV-PVT, and loop() runs a fixed number of
+// passes per second: about 1 with the receiver's TX ready pin, 20 when polling. A pass that
+// leaves log writes pending is followed by another 1ms later, like the sketch's WAKE_LOG.
+// Reports what was logged per second, the peak fill of the file buffer and what
+// it dropped, and checks that the file holds exactly the PVT, HPPOSLLH and RAWX frames of
+// the capture.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -DARDUINO=10813 -DLOGGER_POSIX -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/logsim.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o logsim
+//
+// Usage: logsim [-n navigation rate Hz] [-r passes per second] [-f file buffer bytes]
+//          [-b busy percent] capture.ubx log.ubx
+//   -b makes that share of the passes find the bus taken by a display transfer, so they only
+//   copy. ubxreplay -g makes up a capture.
+
+#include "receiverstream.h"
+#include "ubxlogreader.h"
+#include "logger.h"
+#include <string>
+
+static uint32_t randomState = 12345;
+static uint32_t randomNumber()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 16;
+}
+
+// The frames of the capture that the library logs, good ones only, as they should end up in
+// the log
+static std::string loggedFrames(const uint8_t *p, const uint8_t *end, uint32_t &epochs)
+{
+  std::string frames;
+  epochs = 0;
+  size_t length;
+  uint8_t protocol;
+  bool valid;
+  while((p = nextFrame(p, end, length, protocol, valid)) < end)
+  {
+    if(protocol == PROTOCOL_UBX && valid &&
+      ((p[2] == UBX_CLASS_NAV && (p[3] == UBX_NAV_PVT || p[3] == UBX_NAV_HPPOSLLH)) ||
+      (p[2] == UBX_CLASS_RXM && p[3] == UBX_RXM_RAWX)))
+    {
+      frames.append((const char *)p, length);
+      epochs += p[3] == UBX_NAV_PVT;
+    }
+    p = frameEnd(p, length, valid);
+  }
+  return frames;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t navigationRate = 1;
+  uint32_t passRate = 1;
+  uint32_t fileBufferSize = 16384;
+  uint32_t busyPercent = 0;
+  const char *capturePath = nullptr;
+  const char *logPath = nullptr;
+  bool usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      navigationRate = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+      passRate = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+      fileBufferSize = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-b") && i + 1 < argc)
+      busyPercent = atoi(argv[++i]);
+    else if(argv[i][0] != '-' && capturePath == nullptr)
+      capturePath = argv[i];
+    else if(argv[i][0] != '-' && logPath == nullptr)
+      logPath = argv[i];
+    else
+      usage = true;
+  }
+  if(usage || navigationRate == 0 || passRate == 0 || logPath == nullptr)
+  {
+    fprintf(stderr, "Usage: logsim [-n navigation rate Hz] [-r passes per second] [-f file buffer bytes]\n"
+      "         [-b busy percent] capture.ubx log.ubx\n");
+    return 1;
+  }
+  MappedFile capture;
+  if(!capture.open(capturePath))
+  {
+    perror(capturePath);
+    return 1;
+  }
+  uint32_t epochs;
+  std::string expected = loggedFrames(capture.data(), capture.data() + capture.size(), epochs);
+  if(epochs == 0)
+  {
+    fprintf(stderr, "%s: no NAV-PVT frames\n", capturePath);
+    return 1;
+  }
+
+  host_UseVirtualClock();
+  ReceiverStream stream;
+  SFE_UBLOX_GNSS gps;
+  gps.setFileBufferSize(fileBufferSize);
+  if(!gps.begin(stream) || !gps.setAutoPVT(true, false) || !gps.setAutoHPPOSLLH(true, false) ||
+    !gps.setAutoRXMRAWX(true, false))
+  {
+    fprintf(stderr, "The library didn't accept the stand-in receiver\n");
+    return 1;
+  }
+  gps.logNAVPVT();
+  gps.logNAVHPPOSLLH();
+  gps.logRXMRAWX();
+  PosixLogFile file(logPath);
+  UbxLogger logger(&file);
+  if(!logger.begin(&gps))
+  {
+    perror(logPath);
+    return 1;
+  }
+
+  // The capture arrives evenly over its epochs
+  uint64_t duration = (uint64_t)epochs * 1000000 / navigationRate; // us
+  uint64_t now = 0;
+  size_t arrived = 0;
+  uint32_t passes = 0;
+  uint32_t extraPasses = 0; // For pending writes
+  uint32_t busyPasses = 0;
+  while(arrived < capture.size() || gps.fileBufferAvailable() >= LOGGER_BUFFER_SIZE || logger.writePending())
+  {
+    size_t due = now >= duration ? capture.size() : (size_t)(capture.size() * now / duration);
+    stream.setWindow(capture.data() + arrived, due - arrived);
+    arrived = due;
+    gps.checkUblox();
+    gps.checkCallbacks();
+    bool busy = randomNumber() % 100 < busyPercent;
+    busyPasses += busy;
+    logger.service(!busy);
+    passes++;
+    uint32_t step = 1000000 / passRate;
+    if(logger.writePending())
+    {
+      step = 1000;
+      extraPasses++;
+    }
+    host_AdvanceClock(step);
+    now += step;
+  }
+  logger.end();
+
+  MappedFile log;
+  bool same = log.open(logPath) && log.size() == expected.size() && memcmp(log.data(), expected.data(), log.size()) == 0;
+  printf("%u epochs at %u Hz, %zu bytes, %u loop passes (%u with the bus busy, %u more for pending writes)\n",
+    epochs, navigationRate, capture.size(), passes, busyPasses, extraPasses);
+  printf("logged %u bytes, %u B/s, %u writes (%u direct), failed %u\n",
+    logger.bytesLogged, (uint32_t)((uint64_t)logger.bytesLogged * 1000000 / duration), logger.writes, logger.directWrites, logger.failedWrites);
+  printf("file buffer: max %u of %u bytes, %u frames dropped\n",
+    gps.getMaxFileBufferAvail(), gps.getFileBufferSize(), gps.getFileBufferDropped());
+  printf("log %s the logged frames of the capture\n", same ? "matches" : "DOESN'T MATCH");
+  return same && gps.getFileBufferDropped() == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// Renders the status pages and the settings menu on Linux and reports what each frame costs
+// on the display's SPI bus. Synthetic GNSS epochs are fed through the sketch's own callbacks,
+// so the numbers follow the same code paths as on the device.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -DARDUINO=10813 -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/pagerender.cpp tools/host/host_arduino.cpp tools/host/host_ucglib.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp
+//     src/GpsStatusDisplay/Menu.cpp src/GpsStatusDisplay/buttons.cpp -o pagerender
+// Add -DDISPLAY_FRAMEBUFFER to measure the framebuffer build, and also
+// -DDISPLAY_DMA -DDISPLAY_DMA_MOCK for the DMA flush with the mock DMA engine.
+// With -DSTAGE_TIMING the stage times page is rendered as well, and with -DLINK_STATS too the
+// link statistics page.
+//
+// Usage: pagerender [-n epochs] [-o directory]
+//   -n  Number of epochs drawn on each page after the first full frame (default 50)
+//   -o  Write the first and last frame of each page, and the menu, as PPM files
+
+#include "Arduino.h"
+void showDisplay(bool newPage);
+void drawStatusBar(bool newPage);
+#include "GpsStatusDisplay.ino"
+#include "synthetic.h"
+
+struct FrameCost
+{
+  uint32_t frames = 0;
+  uint32_t spiBytes = 0;
+  uint32_t maxSpiBytes = 0;
+  uint32_t windows = 0;
+  uint32_t pixels = 0;
+
+  void add(const UcgHostStats &stats)
+  {
+    frames++;
+    spiBytes += stats.spiBytes;
+    windows += stats.windows;
+    pixels += stats.pixels;
+    if(stats.spiBytes > maxSpiBytes)
+      maxSpiBytes = stats.spiBytes;
+  }
+};
+
+#ifdef DISPLAY_DMA
+#define DMA_BYTES_PER_LOOP 256 // Bus time per pass through loop(). Roughly one I2C poll at 24MHz SPI
+uint32_t dmaLoops = 0;
+#endif
+
+static void endFrame()
+{
+#if defined(DISPLAY_DMA)
+  // What loop() does: flush doesn't block, and each pass lets the DMA move some bytes
+  ucg.flush();
+  while(displayDma.isBusy() || displayFrameBuffer.isDirty())
+  {
+    mockDma.step(DMA_BYTES_PER_LOOP);
+    ucg.flush();
+    dmaLoops++;
+  }
+#elif defined(DISPLAY_FRAMEBUFFER)
+  ucg.flush();
+#endif
+}
+
+// Press and release a button, waiting out the debounce time, and hand the events to the menu
+static void pressButton(uint8_t pin)
+{
+  host_SetPin(pin, LOW);
+  delay(BUTTON_DEBOUNCE_MS);
+  updateButtons();
+  host_SetPin(pin, HIGH);
+  delay(BUTTON_DEBOUNCE_MS);
+  updateButtons();
+  ButtonEvent event;
+  while(getButtonEvent(event))
+    menu->processMenu(event);
+}
+
+static void dumpFrame(const char *directory, const char *name)
+{
+  if(!directory)
+    return;
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s.ppm", directory, name);
+  if(!ucg_host_WritePPM(path))
+    fprintf(stderr, "Failed to write %s\n", path);
+}
+
+static void printCost(const char *name, const FrameCost &first, const FrameCost &epochs)
+{
+  uint32_t n = epochs.frames > 0 ? epochs.frames : 1;
+  printf("%-10s %10u %8u %10u %10u %8u %10u %10u\n", name,
+    first.spiBytes, first.windows, first.pixels,
+    epochs.spiBytes / n, epochs.windows / n, epochs.pixels / n, epochs.maxSpiBytes);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t epochCount = 50;
+  const char *directory = nullptr;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      epochCount = strtoul(argv[++i], nullptr, 10);
+    else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+      directory = argv[++i];
+    else
+    {
+      fprintf(stderr, "Usage: %s [-n epochs] [-o directory]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // setup() without the receiver: nothing answers on the host's I2C bus
+  initButtons();
+  ucg.begin(UCG_FONT_MODE_SOLID);
+  ucg.clearScreen();
+  ucg.setFontMode(UCG_FONT_MODE_SOLID);
+  menu->setDisplay(&ucg);
+  endFrame();
+
+#if defined(DISPLAY_DMA)
+  printf("Display: framebuffer, DMA\n");
+#elif defined(DISPLAY_FRAMEBUFFER)
+  printf("Display: framebuffer\n");
+#else
+  printf("Display: direct\n");
+#endif
+  printf("%-10s %10s %8s %10s %10s %8s %10s %10s\n", "", "first", "", "", "per epoch", "", "", "max");
+  printf("%-10s %10s %8s %10s %10s %8s %10s %10s\n", "page", "bytes", "windows", "pixels", "bytes", "windows", "pixels", "bytes");
+
+#if defined(STAGE_TIMING) && defined(LINK_STATS)
+  static const char *pageNames[] = { "errors", "navigation", "location", "stages", "link" };
+#elif defined(STAGE_TIMING)
+  static const char *pageNames[] = { "errors", "navigation", "location", "stages" };
+#else
+  static const char *pageNames[] = { "errors", "navigation", "location" };
+#endif
+  uint32_t epoch = 0;
+  for(int16_t page = 0; page < (int16_t)(sizeof(pageNames) / sizeof(pageNames[0])); page++)
+  {
+    FrameCost first, epochs;
+    char name[32];
+
+    // Page change: the loop clears the screen and does a full redraw
+    currentDisplay = page;
+    feedEpoch(epoch++);
+    ucg_host_ResetStats();
+    ucg.clearScreen();
+    showDisplay(true);
+    endFrame();
+    first.add(ucgHostStats);
+    snprintf(name, sizeof(name), "%s-first", pageNames[page]);
+    dumpFrame(directory, name);
+
+    for(uint32_t i = 0; i < epochCount; i++)
+    {
+      feedEpoch(epoch++);
+      ucg_host_ResetStats();
+      showDisplay(false);
+      endFrame();
+      epochs.add(ucgHostStats);
+    }
+    snprintf(name, sizeof(name), "%s-last", pageNames[page]);
+    dumpFrame(directory, name);
+    printCost(pageNames[page], first, epochs);
+  }
+
+  // Entering the settings menu from a status page
+  FrameCost menuCost, none;
+  ucg_host_ResetStats();
+  currentMenu = menu;
+  menu->reset();
+  menu->initScreen();
+  endFrame();
+  menuCost.add(ucgHostStats);
+  dumpFrame(directory, "menu");
+  printCost("menu", menuCost, none);
+
+  // Moving down through the main menu: press and release, as the button interrupt sees them
+  FrameCost navigation;
+  for(int i = 0; i < 6; i++)
+  {
+    ucg_host_ResetStats();
+    pressButton(PIN_BUTTON_DOWN);
+    endFrame();
+    navigation.add(ucgHostStats);
+  }
+  dumpFrame(directory, "menu-down");
+  printCost("menu down", none, navigation);
+#ifdef DISPLAY_DMA
+  printf("DMA: %u transfers, %u segments, %u bytes, %u loop passes while sending\n",
+    displayDma.completedTransfers, displayDma.segmentsSent, displayDma.bytesQueued, dmaLoops);
+#endif
+  return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef __host_receiverframing_h__
+#define __host_receiverframing_h__
+
+// Framing of recorded receiver output, where UBX, NMEA and RTCM 3 are mixed as the serial
+// port delivered them. A frame is taken by its length (UBX, RTCM) or its line end (NMEA) and
+// its checksum is checked separately. A good frame is skipped as a whole, so sync bytes in
+// its payload, which random RTCM or UBX payloads are full of, can't start a bogus frame.
+// A frame that fails its checksum is not: its length field may be what is damaged, and a
+// truncated frame claims the bytes of the frames after it, so the search resumes one byte
+// on (see frameEnd()).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "syncscan.h"
+
+enum Protocol
+{
+  PROTOCOL_UBX,
+  PROTOCOL_NMEA,
+  PROTOCOL_RTCM,
+  PROTOCOL_OTHER,
+  PROTOCOL_COUNT
+};
+
+#define NMEA_MAX_LENGTH 100 // Longest sentence accepted, with some room over the standard's 82
+
+static inline void ubxChecksum(const uint8_t *data, size_t length, uint8_t &a, uint8_t &b)
+{
+  a = b = 0;
+  for(size_t i = 0; i < length; i++)
+  {
+    a += data[i];
+    b += a;
+  }
+}
+
+struct Crc24qTable
+{
+  uint32_t entries[256];
+  Crc24qTable()
+  {
+    for(uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t crc = i << 16;
+      for(uint8_t bit = 0; bit < 8; bit++)
+      {
+        crc <<= 1;
+        if(crc & 0x1000000)
+          crc ^= 0x1864CFB;
+      }
+      entries[i] = crc & 0xFFFFFF;
+    }
+  };
+};
+
+static inline uint32_t crc24q(const uint8_t *data, size_t length)
+{
+  static const Crc24qTable table;
+  uint32_t crc = 0;
+  for(size_t i = 0; i < length; i++)
+    crc = ((crc << 8) & 0xFFFFFF) ^ table.entries[(crc >> 16) ^ data[i]];
+  return crc;
+}
+
+static inline int hexDigit(uint8_t c)
+{
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  if(c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// Length of the frame at p, 0 if no complete frame starts there. protocol is the frame's
+// PROTOCOL_* and valid says if its checksum matched.
+static inline size_t frameAt(const uint8_t *p, const uint8_t *end, uint8_t &protocol, bool &valid)
+{
+  size_t left = end - p;
+  if(left >= 8 && p[0] == 0xB5 && p[1] == 0x62)
+  {
+    size_t length = 8 + (p[4] | (p[5] << 8));
+    if(length > left)
+      return 0;
+    uint8_t a, b;
+    ubxChecksum(p + 2, length - 4, a, b);
+    protocol = PROTOCOL_UBX;
+    valid = a == p[length - 2] && b == p[length - 1];
+    return length;
+  }
+  if(left >= 6 && p[0] == 0xD3 && (p[1] & 0xFC) == 0)
+  {
+    size_t length = 6 + (((p[1] & 0x03) << 8) | p[2]);
+    if(length > left)
+      return 0;
+    uint32_t crc = ((uint32_t)p[length - 3] << 16) | (p[length - 2] << 8) | p[length - 1];
+    protocol = PROTOCOL_RTCM;
+    valid = crc24q(p, length - 3) == crc;
+    return length;
+  }
+  if(p[0] == '$')
+  {
+    size_t length = 1;
+    while(length < left && length < NMEA_MAX_LENGTH && p[length] != '\n' && p[length] != '$')
+      length++;
+    if(length == left || p[length] != '\n' || length < 7)
+      return 0;
+    length++;
+    const uint8_t *star = (const uint8_t *)memchr(p, '*', length);
+    uint8_t sum = 0;
+    for(const uint8_t *c = p + 1; star != nullptr && c < star; c++)
+      sum ^= *c;
+    protocol = PROTOCOL_NMEA;
+    valid = star != nullptr && star + 3 <= p + length &&
+      hexDigit(star[1]) == sum >> 4 && hexDigit(star[2]) == (sum & 0x0F);
+    return length;
+  }
+  return 0;
+}
+
+// The next frame at or after p, found with scan. Returns its start, or end if there is none,
+// with its length, protocol and checksum result.
+// Frames mostly follow each other directly, so p itself is tried before scanning.
+static inline const uint8_t *nextFrame(const uint8_t *p, const uint8_t *end, size_t &length, uint8_t &protocol, bool &valid,
+  SyncScanner scan = findSync)
+{
+  while(p < end && (isSyncCandidate(p, end) || (p = scan(p, end)) < end))
+  {
+    length = frameAt(p, end, protocol, valid);
+    if(length > 0)
+      return p;
+    p++;
+  }
+  return end;
+}
+
+// Where to continue after the frame at p that nextFrame() returned
+static inline const uint8_t *frameEnd(const uint8_t *p, size_t length, bool valid)
+{
+  return valid ? p + length : p + 1;
+}
+
+#endif
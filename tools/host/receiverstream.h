@@ -0,0 +1,92 @@
+#ifndef __host_receiverstream_h__
+#define __host_receiverstream_h__
+
+// Stand-in for the receiver's serial port, for host tools that run recorded receiver output
+// through the u-blox library. Before the data it answers the configuration the library
+// sends: the CFG-RATE poll of begin() with a rate and every other CFG message with an ACK,
+// so begin() and the setAuto*() calls work as with a receiver. Then it hands out the
+// recording a window at a time.
+
+#include "Arduino.h"
+#include "SparkFun_u-blox_GNSS_Arduino_Library.h"
+#include <limits.h>
+#include <vector>
+#include "receiverframing.h"
+
+class ReceiverStream : public Stream
+{
+  public:
+    void setWindow(const uint8_t *data, size_t length)
+    {
+      _data = data;
+      _end = data + length;
+    };
+    int available() override
+    {
+      size_t left = (_reply.size() - _replyRead) + (_end - _data);
+      return left > INT_MAX ? INT_MAX : (int)left;
+    };
+    int read() override
+    {
+      if(_replyRead < _reply.size())
+        return _reply[_replyRead++];
+      return _data < _end ? *_data++ : -1;
+    };
+    size_t write(uint8_t c) override
+    {
+      if(_command.size() < 2 && c != (_command.empty() ? 0xB5 : 0x62))
+      {
+        _command.clear();
+        return 1;
+      }
+      _command.push_back(c);
+      if(_command.size() >= 6 && _command.size() == 8u + (_command[4] | (_command[5] << 8)))
+      {
+        answer(_command[2], _command[3], _command.size() - 8);
+        _command.clear();
+      }
+      return 1;
+    };
+    using Print::write;
+
+    uint32_t commands = 0;
+
+  private:
+    void answer(uint8_t cls, uint8_t id, size_t length)
+    {
+      commands++;
+      if(cls != UBX_CLASS_CFG)
+        return;
+      if(id == UBX_CFG_RATE && length == 0)
+      {
+        const uint8_t rate[6] = { 0xE8, 0x03, 0x01, 0x00, 0x01, 0x00 }; // 1000ms, 1 cycle, GPS time
+        reply(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+      }
+      const uint8_t ack[2] = { cls, id };
+      reply(UBX_CLASS_ACK, UBX_ACK_ACK, ack, sizeof(ack));
+    };
+    void reply(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length)
+    {
+      if(_replyRead == _reply.size())
+      {
+        _reply.clear();
+        _replyRead = 0;
+      }
+      size_t start = _reply.size();
+      const uint8_t header[6] = { 0xB5, 0x62, cls, id, (uint8_t)length, (uint8_t)(length >> 8) };
+      _reply.insert(_reply.end(), header, header + 6);
+      _reply.insert(_reply.end(), payload, payload + length);
+      uint8_t a, b;
+      ubxChecksum(_reply.data() + start + 2, length + 4, a, b);
+      _reply.push_back(a);
+      _reply.push_back(b);
+    };
+
+    const uint8_t *_data = nullptr;
+    const uint8_t *_end = nullptr;
+    std::vector<uint8_t> _command;
+    std::vector<uint8_t> _reply;
+    size_t _replyRead = 0;
+};
+
+#endif
@@ -0,0 +1,125 @@
+// Hammers SeqLock (seqlock.h) with one writer thread and several reader threads. Every field
+// of a published value is derived from one counter, so a reader can tell a torn copy, one
+// that mixes two writes, from a good one. Readers also check that the counter never goes
+// backwards. Reports the reads, the torn ones (must be none) and how often read() had to
+// retry.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -pthread -Isrc/GpsStatusDisplay tools/host/seqlocktest.cpp -o seqlocktest
+//
+// ThreadSanitizer doesn't support the standalone fences SeqLock relies on, so a TSan build
+// reports the buffer copy as a race and can tear reads that the real build doesn't.
+//
+// Usage: seqlocktest [-r readers] [-n writes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "seqlock.h"
+
+// About the size of the sketch's GnssMonitorState, so a copy takes a while
+struct Sample
+{
+  uint32_t counter;
+  uint64_t square;
+  int32_t negated;
+  double half;
+  uint32_t words[32];
+};
+
+static void makeSample(uint32_t counter, Sample &s)
+{
+  s.counter = counter;
+  s.square = (uint64_t)counter * counter;
+  s.negated = -(int32_t)counter;
+  s.half = counter * 0.5;
+  for(uint32_t i = 0; i < 32; i++)
+    s.words[i] = counter ^ (i * 0x9E3779B9u);
+}
+
+static bool isConsistent(const Sample &s)
+{
+  Sample expected;
+  makeSample(s.counter, expected);
+  return memcmp(&s, &expected, sizeof(s)) == 0;
+}
+
+struct ReaderResult
+{
+  uint64_t reads;
+  uint64_t torn;
+  uint64_t backwards;
+};
+
+int main(int argc, char **argv)
+{
+  unsigned readers = 3;
+  uint32_t writes = 20000000;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-r") && i + 1 < argc)
+      readers = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      writes = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "Usage: %s [-r readers] [-n writes]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  static SeqLock<Sample> lock;
+  Sample first;
+  makeSample(0, first);
+  lock.write(first);
+  std::atomic<bool> done(false);
+  std::vector<ReaderResult> results(readers);
+  std::vector<std::thread> threads;
+  for(unsigned r = 0; r < readers; r++)
+    threads.push_back(std::thread([&, r]() {
+      ReaderResult result = { 0, 0, 0 };
+      uint32_t last = 0;
+      Sample s;
+      while(!done.load(std::memory_order_relaxed))
+      {
+        lock.read(s);
+        result.reads++;
+        if(!isConsistent(s))
+          result.torn++;
+        else if(s.counter < last)
+          result.backwards++;
+        else
+          last = s.counter;
+      }
+      results[r] = result;
+    }));
+  std::thread writer([&]() {
+    Sample s;
+    for(uint32_t counter = 1; counter <= writes; counter++)
+    {
+      makeSample(counter, s);
+      lock.write(s);
+    }
+    done = true;
+  });
+  writer.join();
+  for(unsigned r = 0; r < readers; r++)
+    threads[r].join();
+
+  ReaderResult total = { 0, 0, 0 };
+  for(unsigned r = 0; r < readers; r++)
+  {
+    total.reads += results[r].reads;
+    total.torn += results[r].torn;
+    total.backwards += results[r].backwards;
+  }
+  printf("%u writes, %u readers, %llu reads, %llu torn, %llu out of order, %.1f retries per million reads\n",
+    lock.writes() - 1, readers, (unsigned long long)total.reads, (unsigned long long)total.torn,
+    (unsigned long long)total.backwards, total.reads > 0 ? lock.retries() * 1e6 / total.reads : 0.0);
+  bool passed = total.torn == 0 && total.backwards == 0;
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? 0 : 1;
+}
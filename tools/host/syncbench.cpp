@@ -0,0 +1,161 @@
+// Benchmark of the frame sync scanners in syncscan.h: the byte loop against SSE2 and AVX2,
+// first finding every candidate frame start, then walking the frames the way the replay
+// and conversion tools do, with each candidate checked by length and checksum.
+// All scanners must find the same candidates and frames, or the benchmark fails.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -Itools/host tools/host/syncbench.cpp -o syncbench
+//
+// Usage: syncbench [-n runs] [capture.ubx]
+//   Without a capture it makes up 64MB of random bytes, which is mostly no frames at all,
+//   the case where the scan is all the work.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "receiverframing.h"
+
+#define RANDOM_BYTES (64UL << 20)
+
+struct Scanner
+{
+  const char *name;
+  SyncScanner scan;
+};
+
+struct FrameCounts
+{
+  size_t frames[PROTOCOL_COUNT];
+  size_t invalid;
+  bool operator==(const FrameCounts &other) const { return memcmp(this, &other, sizeof(*this)) == 0; };
+};
+
+static double now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static size_t countCandidates(const uint8_t *p, const uint8_t *end, SyncScanner scan)
+{
+  size_t count = 0;
+  while((p = scan(p, end)) < end)
+  {
+    count++;
+    p++;
+  }
+  return count;
+}
+
+static FrameCounts countFrames(const uint8_t *p, const uint8_t *end, SyncScanner scan)
+{
+  FrameCounts counts;
+  memset(&counts, 0, sizeof(counts));
+  size_t length;
+  uint8_t protocol;
+  bool valid;
+  while((p = nextFrame(p, end, length, protocol, valid, scan)) < end)
+  {
+    counts.frames[protocol]++;
+    counts.invalid += !valid;
+    p = frameEnd(p, length, valid);
+  }
+  return counts;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 5;
+  const char *path = nullptr;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      runs = atoi(argv[++i]);
+    else if(argv[i][0] != '-' && path == nullptr)
+      path = argv[i];
+    else
+    {
+      fprintf(stderr, "Usage: %s [-n runs] [capture.ubx]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> data;
+  if(path)
+  {
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+      perror(path);
+      return 1;
+    }
+    uint8_t buffer[65536];
+    size_t count;
+    while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+  }
+  else
+  {
+    uint32_t state = 12345;
+    data.resize(RANDOM_BYTES);
+    for(size_t i = 0; i < data.size(); i++)
+    {
+      state = state * 1103515245 + 12345;
+      data[i] = state >> 16;
+    }
+  }
+  const uint8_t *begin = data.data();
+  const uint8_t *end = begin + data.size();
+
+  std::vector<Scanner> scanners;
+  scanners.push_back(Scanner { "scalar", findSyncScalar });
+#ifdef SYNC_SCAN_X86
+  scanners.push_back(Scanner { "SSE2", findSyncSse2 });
+  if(haveAvx2())
+    scanners.push_back(Scanner { "AVX2", findSyncAvx2 });
+#endif
+
+  printf("%zu bytes%s, best of %d runs\n", data.size(), path ? "" : " of random data", runs);
+  printf("%-8s %12s %10s %8s %12s %10s %8s\n", "scanner", "candidates", "GB/s", "speedup", "frames", "GB/s", "speedup");
+  size_t candidates = 0;
+  FrameCounts frames;
+  double scalarScan = 0, scalarFrames = 0;
+  for(size_t s = 0; s < scanners.size(); s++)
+  {
+    double bestScan = 1e9, bestFrames = 1e9;
+    size_t count = 0;
+    FrameCounts counts;
+    for(int run = 0; run < runs; run++)
+    {
+      double t0 = now();
+      count = countCandidates(begin, end, scanners[s].scan);
+      double t1 = now();
+      counts = countFrames(begin, end, scanners[s].scan);
+      double t2 = now();
+      bestScan = t1 - t0 < bestScan ? t1 - t0 : bestScan;
+      bestFrames = t2 - t1 < bestFrames ? t2 - t1 : bestFrames;
+    }
+    if(s == 0)
+    {
+      candidates = count;
+      frames = counts;
+      scalarScan = bestScan;
+      scalarFrames = bestFrames;
+    }
+    else if(count != candidates || !(counts == frames))
+    {
+      fprintf(stderr, "%s doesn't agree with the scalar scan\n", scanners[s].name);
+      return 1;
+    }
+    size_t frameCount = counts.frames[PROTOCOL_UBX] + counts.frames[PROTOCOL_NMEA] + counts.frames[PROTOCOL_RTCM];
+    printf("%-8s %12zu %10.2f %7.1fx %12zu %10.2f %7.1fx\n", scanners[s].name, count, data.size() / bestScan / 1e9,
+      scalarScan / bestScan, frameCount, data.size() / bestFrames / 1e9, scalarFrames / bestFrames);
+  }
+  printf("frames: UBX %zu, NMEA %zu, RTCM %zu, %zu with a bad checksum\n",
+    frames.frames[PROTOCOL_UBX], frames.frames[PROTOCOL_NMEA], frames.frames[PROTOCOL_RTCM], frames.invalid);
+  return 0;
+}
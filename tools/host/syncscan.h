@@ -0,0 +1,100 @@
+#ifndef __host_syncscan_h__
+#define __host_syncscan_h__
+
+// Finds the next place in recorded receiver output where a frame could start: a UBX sync
+// pair (0xB5 0x62), an RTCM 3 preamble (0xD3) or an NMEA '$'. Whether a frame really starts
+// there is for frameAt() in receiverframing.h to decide by length and checksum.
+// On x86 the bytes are compared 16 (SSE2) or 32 (AVX2) at a time, the widest the CPU has,
+// picked on the first call. Elsewhere, and for the tail, it's a byte loop.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SYNC_SCAN_X86
+#endif
+
+typedef const uint8_t *(*SyncScanner)(const uint8_t *p, const uint8_t *end);
+
+static inline bool isSyncCandidate(const uint8_t *p, const uint8_t *end)
+{
+  return *p == 0xD3 || *p == '$' || (*p == 0xB5 && end - p >= 2 && p[1] == 0x62);
+}
+
+// First candidate in [p, end), or end
+static inline const uint8_t *findSyncScalar(const uint8_t *p, const uint8_t *end)
+{
+  for(; p < end; p++)
+    if(isSyncCandidate(p, end))
+      return p;
+  return end;
+}
+
+#ifdef SYNC_SCAN_X86
+// The UBX test compares the block and the block one byte further on, so it reads one byte
+// past the block and stops a byte early
+static inline const uint8_t *findSyncSse2(const uint8_t *p, const uint8_t *end)
+{
+  const __m128i ubx1 = _mm_set1_epi8((char)0xB5);
+  const __m128i ubx2 = _mm_set1_epi8(0x62);
+  const __m128i rtcm = _mm_set1_epi8((char)0xD3);
+  const __m128i nmea = _mm_set1_epi8('$');
+  while(end - p > 16)
+  {
+    __m128i here = _mm_loadu_si128((const __m128i *)p);
+    __m128i next = _mm_loadu_si128((const __m128i *)(p + 1));
+    __m128i ubx = _mm_and_si128(_mm_cmpeq_epi8(here, ubx1), _mm_cmpeq_epi8(next, ubx2));
+    __m128i other = _mm_or_si128(_mm_cmpeq_epi8(here, rtcm), _mm_cmpeq_epi8(here, nmea));
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(ubx, other));
+    if(mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return findSyncScalar(p, end);
+}
+
+__attribute__((target("avx2"))) static inline const uint8_t *findSyncAvx2(const uint8_t *p, const uint8_t *end)
+{
+  const __m256i ubx1 = _mm256_set1_epi8((char)0xB5);
+  const __m256i ubx2 = _mm256_set1_epi8(0x62);
+  const __m256i rtcm = _mm256_set1_epi8((char)0xD3);
+  const __m256i nmea = _mm256_set1_epi8('$');
+  while(end - p > 32)
+  {
+    __m256i here = _mm256_loadu_si256((const __m256i *)p);
+    __m256i next = _mm256_loadu_si256((const __m256i *)(p + 1));
+    __m256i ubx = _mm256_and_si256(_mm256_cmpeq_epi8(here, ubx1), _mm256_cmpeq_epi8(next, ubx2));
+    __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(here, rtcm), _mm256_cmpeq_epi8(here, nmea));
+    unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(ubx, other));
+    if(mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return findSyncSse2(p, end);
+}
+
+static inline bool haveAvx2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+static inline SyncScanner bestSyncScanner()
+{
+#ifdef SYNC_SCAN_X86
+  return haveAvx2() ? findSyncAvx2 : findSyncSse2;
+#else
+  return findSyncScalar;
+#endif
+}
+
+// First candidate in [p, end), or end, with the best scanner for this CPU
+static inline const uint8_t *findSync(const uint8_t *p, const uint8_t *end)
+{
+  static const SyncScanner scanner = bestSyncScanner();
+  return scanner(p, end);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __host_synthetic_h__
+#define __host_synthetic_h__
+
+// Synthetic receiver output for the host tools. Include after GpsStatusDisplay.ino.
+
+static uint32_t randomState = 12345;
+static int32_t jitter(int32_t range)
+{
+  randomState = randomState * 1103515245 + 12345;
+  return (int32_t)((randomState >> 16) % (2 * range + 1)) - range;
+}
+
+// One navigation epoch: PVT, HPPOSLLH and DOP, like the receiver sends them
+static void feedEpoch(uint32_t epoch)
+{
+  UBX_NAV_PVT_data_t pvt;
+  memset(&pvt, 0, sizeof(pvt));
+  pvt.iTOW = 300000000 + epoch * 1000;
+  uint32_t seconds = 12 * 3600 + 34 * 60 + epoch;
+  pvt.hour = seconds / 3600 % 24;
+  pvt.min = seconds / 60 % 60;
+  pvt.sec = seconds % 60;
+  pvt.fixType = 3;
+  pvt.flags.bits.gnssFixOK = 1;
+  pvt.flags.bits.carrSoln = epoch % 20 < 15 ? 2 : 1;
+  pvt.numSV = 18 + jitter(2);
+  pvt.lat = 476205000 + jitter(50);
+  pvt.lon = -1223493000 + jitter(50);
+  pvt.hMSL = 52000 + jitter(30);
+  pvt.gSpeed = 1500 + jitter(200);
+  pvt.headVeh = (int32_t)((epoch * 7) % 360) * 100000;
+  onPVTDataChanged(pvt);
+
+  // The receiver doesn't send the display-only messages while the display is off (headless.h)
+  if(headless.active)
+    return;
+  UBX_NAV_HPPOSLLH_data_t hppos;
+  memset(&hppos, 0, sizeof(hppos));
+  hppos.hAcc = 140 + jitter(20);
+  hppos.vAcc = 210 + jitter(30);
+  OnHPPOSLLHChanged(hppos);
+
+  UBX_NAV_DOP_data_t dop;
+  memset(&dop, 0, sizeof(dop));
+  dop.pDOP = 120 + jitter(5);
+  dop.hDOP = 70 + jitter(5);
+  dop.vDOP = 95 + jitter(5);
+  OnDOPChanged(dop);
+}
+
+#endif
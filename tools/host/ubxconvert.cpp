@@ -0,0 +1,333 @@
+// Converts a UBX log to CSV or GPX on all cores, with the u-blox library doing the decoding
+// so the numbers are the ones the sketch sees.
+// The log is memory mapped and cut into chunks that each start at a NAV-PVT frame with a good
+// checksum, so no frame and no epoch (the PVT and the HPPOSLLH the receiver sends after it)
+// is split between chunks. Each thread runs its own library instance over one chunk at a
+// time, one frame per checkUblox(), and collects the fixes from the PVT and HPPOSLLH
+// callbacks. The chunks are joined in file order, sorted by GPS time if the log isn't
+// already, and formatted in parallel again.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -pthread -DARDUINO=10813 -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/ubxconvert.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o ubxconvert
+//
+// Usage: ubxconvert [-j threads] [-f csv|gpx] log.ubx > track.csv
+
+#include "receiverstream.h"
+#include "ubxlogreader.h"
+#include <inttypes.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef CONVERT_CHUNK_SIZE
+#define CONVERT_CHUNK_SIZE (4UL << 20) // Bytes per chunk, enough to keep the per chunk setup negligible
+#endif
+#define UBX_NAV_PVT_FRAME_LENGTH (8 + 92)
+
+struct Fix
+{
+  uint64_t time;     // ms since the GPS epoch, for ordering
+  uint32_t iTOW;
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+  int32_t nano;
+  bool timeValid;
+  uint8_t fixType;
+  uint8_t carrSoln;
+  bool fixOk;
+  bool highPrecision; // Position and accuracy from HPPOSLLH
+  uint8_t numSV;
+  int64_t lat;       // 1e-9 degrees
+  int64_t lon;       // 1e-9 degrees
+  int64_t height;    // Above the ellipsoid, 0.1mm
+  int64_t hMSL;      // Above mean sea level, 0.1mm
+  uint32_t hAcc;     // 0.1mm
+  uint32_t vAcc;     // 0.1mm
+  int32_t gSpeed;    // mm/s
+  int32_t headMot;   // 1e-5 degrees
+};
+
+struct Chunk
+{
+  size_t begin;
+  size_t end;
+  std::vector<Fix> fixes;
+};
+
+// The fixes of the chunk the current thread decodes, for the callbacks
+static thread_local std::vector<Fix> *chunkFixes;
+static thread_local UBX_NAV_HPPOSLLH_data_t pendingHp; // HPPOSLLH that came before its PVT
+static thread_local bool havePendingHp;
+
+static void applyHp(Fix &fix, const UBX_NAV_HPPOSLLH_data_t &hp)
+{
+  fix.lat = (int64_t)hp.lat * 100 + hp.latHp;
+  fix.lon = (int64_t)hp.lon * 100 + hp.lonHp;
+  fix.height = (int64_t)hp.height * 10 + hp.heightHp;
+  fix.hMSL = (int64_t)hp.hMSL * 10 + hp.hMSLHp;
+  fix.hAcc = hp.hAcc;
+  fix.vAcc = hp.vAcc;
+  fix.highPrecision = true;
+}
+
+static void onPVT(UBX_NAV_PVT_data_t pvt)
+{
+  Fix fix;
+  fix.iTOW = pvt.iTOW;
+  fix.year = pvt.year;
+  fix.month = pvt.month;
+  fix.day = pvt.day;
+  fix.hour = pvt.hour;
+  fix.minute = pvt.min;
+  fix.second = pvt.sec;
+  fix.nano = pvt.nano;
+  fix.timeValid = pvt.valid.bits.validDate && pvt.valid.bits.validTime;
+  fix.time = 0;
+  if(fix.timeValid)
+    fix.time = gpsMillis(gpsWeek(pvt.year, pvt.month, pvt.day, pvt.hour, pvt.min, pvt.sec, pvt.iTOW), pvt.iTOW);
+  else if(!chunkFixes->empty())
+    fix.time = chunkFixes->back().time; // Keeps its place in the file
+  fix.fixType = pvt.fixType;
+  fix.carrSoln = pvt.flags.bits.carrSoln;
+  fix.fixOk = pvt.flags.bits.gnssFixOK;
+  fix.numSV = pvt.numSV;
+  fix.lat = (int64_t)pvt.lat * 100;
+  fix.lon = (int64_t)pvt.lon * 100;
+  fix.height = (int64_t)pvt.height * 10;
+  fix.hMSL = (int64_t)pvt.hMSL * 10;
+  fix.hAcc = pvt.hAcc * 10;
+  fix.vAcc = pvt.vAcc * 10;
+  fix.highPrecision = false;
+  fix.gSpeed = pvt.gSpeed;
+  fix.headMot = pvt.headMot;
+  if(havePendingHp && pendingHp.iTOW == pvt.iTOW)
+    applyHp(fix, pendingHp);
+  havePendingHp = false;
+  chunkFixes->push_back(fix);
+}
+
+static void onHPPOSLLH(UBX_NAV_HPPOSLLH_data_t hp)
+{
+  if(hp.flags.bits.invalidLlh)
+    return;
+  if(!chunkFixes->empty() && chunkFixes->back().iTOW == hp.iTOW && !chunkFixes->back().highPrecision)
+    applyHp(chunkFixes->back(), hp);
+  else
+  {
+    pendingHp = hp;
+    havePendingHp = true;
+  }
+}
+
+// Length of the UBX frame at offset if its checksum is good, otherwise 0
+static size_t checkedFrame(const uint8_t *data, size_t size, size_t offset)
+{
+  if(size - offset < 8 || data[offset] != 0xB5 || data[offset + 1] != 0x62)
+    return 0;
+  size_t length = 8 + (data[offset + 4] | (data[offset + 5] << 8));
+  if(length > size - offset)
+    return 0;
+  uint8_t a, b;
+  ubxChecksum(data + offset + 2, length - 4, a, b);
+  return a == data[offset + length - 2] && b == data[offset + length - 1] ? length : 0;
+}
+
+// Offset of the first NAV-PVT frame with a good checksum at or after offset, or size
+static size_t nextPvt(const uint8_t *data, size_t size, size_t offset)
+{
+  const uint8_t *end = data + size;
+  for(const uint8_t *p = data + offset; (p = findSync(p, end)) < end; p++)
+    if(end - p >= 6 && p[0] == 0xB5 && p[2] == UBX_CLASS_NAV && p[3] == UBX_NAV_PVT &&
+      checkedFrame(data, size, p - data) == UBX_NAV_PVT_FRAME_LENGTH)
+      return p - data;
+  return size;
+}
+
+class ChunkDecoder
+{
+  public:
+    bool begin()
+    {
+      return _gps.begin(_stream) && _gps.setAutoPVTcallback(onPVT) && _gps.setAutoHPPOSLLHcallback(onHPPOSLLH);
+    };
+    // Feeds the chunk's UBX frames one at a time, so every fix gets its callback. Only whole,
+    // good frames go in, so the library is between frames at the end of the chunk. NMEA and
+    // RTCM frames are skipped whole, so sync bytes in their payloads can't start a bogus UBX
+    // frame; after a frame that fails its checksum the search resumes one byte on.
+    void decode(const uint8_t *data, Chunk &chunk)
+    {
+      chunkFixes = &chunk.fixes;
+      havePendingHp = false;
+      const uint8_t *p = data + chunk.begin;
+      const uint8_t *end = data + chunk.end;
+      size_t length;
+      uint8_t protocol;
+      bool valid;
+      while((p = nextFrame(p, end, length, protocol, valid)) < end)
+      {
+        if(protocol == PROTOCOL_UBX && valid)
+        {
+          _stream.setWindow(p, length);
+          _gps.checkUblox();
+          _gps.checkCallbacks();
+        }
+        p = frameEnd(p, length, valid);
+      }
+      chunkFixes = nullptr;
+    };
+
+  private:
+    ReceiverStream _stream;
+    SFE_UBLOX_GNSS _gps;
+};
+
+// Runs work(thread, item) for items 0 to count - 1 on threads threads, each taking the next
+// item when it is done with one
+template<typename Work> static void parallelFor(unsigned threads, size_t count, Work work)
+{
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for(unsigned t = 0; t < threads; t++)
+    pool.push_back(std::thread([&, t]() {
+      for(size_t i = next++; i < count; i = next++)
+        work(t, i);
+    }));
+  for(size_t t = 0; t < pool.size(); t++)
+    pool[t].join();
+}
+
+static void formatFix(const Fix &fix, bool gpx, std::string &out)
+{
+  char line[320];
+  char time[40] = "";
+  if(fix.timeValid)
+  {
+    // nano can be negative, the receiver rounds the second
+    int32_t millis = (fix.nano + 500000) / 1000000;
+    snprintf(time, sizeof(time), "%04u-%02u-%02uT%02u:%02u:%02u.%03dZ", fix.year, fix.month, fix.day,
+      fix.hour, fix.minute, fix.second, millis < 0 ? 0 : millis > 999 ? 999 : millis);
+  }
+  int length;
+  if(gpx)
+    length = snprintf(line, sizeof(line),
+      "<trkpt lat=\"%.9f\" lon=\"%.9f\"><ele>%.4f</ele>%s%s%s<sat>%u</sat></trkpt>\n",
+      fix.lat / 1e9, fix.lon / 1e9, fix.hMSL / 1e4, fix.timeValid ? "<time>" : "", time,
+      fix.timeValid ? "</time>" : "", fix.numSV);
+  else
+    length = snprintf(line, sizeof(line),
+      "%s,%" PRIu32 ",%.9f,%.9f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%u,%u,%.3f,%.5f\n",
+      time, fix.iTOW, fix.lat / 1e9, fix.lon / 1e9, fix.height / 1e4, fix.hMSL / 1e4, fix.hAcc / 1e4,
+      fix.vAcc / 1e4, fix.fixType, fix.fixOk, fix.carrSoln, fix.highPrecision, fix.numSV,
+      fix.gSpeed / 1e3, fix.headMot / 1e5);
+  out.append(line, length);
+}
+
+static double seconds(const timespec &from, const timespec &to)
+{
+  return (to.tv_sec - from.tv_sec) + (to.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  bool gpx = false;
+  const char *path = nullptr;
+  bool usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-j") && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+    {
+      gpx = !strcmp(argv[++i], "gpx");
+      usage |= !gpx && strcmp(argv[i], "csv");
+    }
+    else if(argv[i][0] != '-' && path == nullptr)
+      path = argv[i];
+    else
+      usage = true;
+  }
+  if(usage || path == nullptr)
+  {
+    fprintf(stderr, "Usage: %s [-j threads] [-f csv|gpx] log.ubx > track.csv\n", argv[0]);
+    return 1;
+  }
+  if(threads == 0)
+    threads = 1;
+  MappedFile log;
+  if(!log.open(path))
+  {
+    perror(path);
+    return 1;
+  }
+  const uint8_t *data = log.data();
+  size_t size = log.size();
+  timespec t0, t1, t2, t3;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  // Chunk boundaries: the first good PVT after every CONVERT_CHUNK_SIZE bytes
+  std::vector<Chunk> chunks;
+  size_t begin = 0;
+  while(begin < size)
+  {
+    size_t end = begin + CONVERT_CHUNK_SIZE < size ? nextPvt(data, size, begin + CONVERT_CHUNK_SIZE) : size;
+    chunks.push_back(Chunk());
+    chunks.back().begin = begin;
+    chunks.back().end = end;
+    begin = end;
+  }
+
+  std::vector<ChunkDecoder> decoders(threads);
+  for(unsigned t = 0; t < threads; t++)
+    if(!decoders[t].begin())
+    {
+      fprintf(stderr, "The library didn't accept the stand-in receiver\n");
+      return 1;
+    }
+  parallelFor(threads, chunks.size(), [&](unsigned t, size_t i) { decoders[t].decode(data, chunks[i]); });
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  std::vector<Fix> fixes;
+  for(size_t i = 0; i < chunks.size(); i++)
+  {
+    fixes.insert(fixes.end(), chunks[i].fixes.begin(), chunks[i].fixes.end());
+    std::vector<Fix>().swap(chunks[i].fixes);
+  }
+  bool sorted = true;
+  for(size_t i = 1; i < fixes.size() && sorted; i++)
+    sorted = fixes[i - 1].time <= fixes[i].time;
+  if(!sorted)
+    std::stable_sort(fixes.begin(), fixes.end(), [](const Fix &a, const Fix &b) { return a.time < b.time; });
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  // Formatted in one piece per chunk of fixes, written in order
+  const size_t fixesPerPiece = 65536;
+  std::vector<std::string> pieces((fixes.size() + fixesPerPiece - 1) / fixesPerPiece);
+  parallelFor(threads, pieces.size(), [&](unsigned, size_t i) {
+    size_t end = std::min(fixes.size(), (i + 1) * fixesPerPiece);
+    for(size_t f = i * fixesPerPiece; f < end; f++)
+      formatFix(fixes[f], gpx, pieces[i]);
+  });
+  if(gpx)
+    printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<gpx version=\"1.1\" creator=\"ubxconvert\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n<trk><trkseg>\n");
+  else
+    printf("time,iTOW,lat,lon,height_m,hMSL_m,hAcc_m,vAcc_m,fixType,fixOk,carrSoln,highPrecision,numSV,gSpeed_mps,headMot_deg\n");
+  for(size_t i = 0; i < pieces.size(); i++)
+    fwrite(pieces[i].data(), 1, pieces[i].size(), stdout);
+  if(gpx)
+    printf("</trkseg></trk>\n</gpx>\n");
+  fflush(stdout);
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+
+  double decodeSeconds = seconds(t0, t1);
+  fprintf(stderr, "%zu bytes in %zu chunks on %u threads: %zu fixes%s, decoded in %.3fs (%.1f MB/s), sorted in %.3fs, written in %.3fs\n",
+    size, chunks.size(), threads, fixes.size(), sorted ? "" : " (out of order, sorted)", decodeSeconds,
+    decodeSeconds > 0 ? size / decodeSeconds / 1e6 : 0.0, seconds(t1, t2), seconds(t2, t3));
+  return 0;
+}
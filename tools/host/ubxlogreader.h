@@ -0,0 +1,149 @@
+#ifndef __host_ubxlogreader_h__
+#define __host_ubxlogreader_h__
+
+// Reads a UBX log together with its time index (LOGnnn.IDX, see logindex.h). Both files are
+// memory mapped, so a query only reads the index pages its binary search touches and the
+// part of the log between the nearest index entries, instead of the whole log.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logindex.h"
+#include "receiverframing.h"
+
+class MappedFile
+{
+  public:
+    ~MappedFile() { close(); }
+    bool open(const char *path)
+    {
+      close();
+      int fd = ::open(path, O_RDONLY);
+      if(fd < 0)
+        return false;
+      struct stat st;
+      bool opened = fstat(fd, &st) == 0;
+      if(opened && st.st_size > 0)
+      {
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        opened = data != MAP_FAILED;
+        if(opened)
+        {
+          _data = (const uint8_t *)data;
+          _size = st.st_size;
+        }
+      }
+      ::close(fd);
+      return opened;
+    };
+    void close()
+    {
+      if(_data != nullptr)
+        munmap((void *)_data, _size);
+      _data = nullptr;
+      _size = 0;
+    };
+    const uint8_t *data() const { return _data; };
+    size_t size() const { return _size; };
+
+  private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+};
+
+class UbxLogReader
+{
+  public:
+    bool open(const char *logPath, const char *indexPath)
+    {
+      if(!_log.open(logPath) || !_index.open(indexPath))
+        return false;
+      return _index.size() >= LOG_INDEX_HEADER_SIZE && memcmp(_index.data(), LOG_INDEX_MAGIC, 4) == 0 &&
+        (_index.data()[4] | (_index.data()[5] << 8)) == LOG_INDEX_VERSION;
+    };
+    uint16_t intervalSeconds() const { return _index.data()[6] | (_index.data()[7] << 8); };
+    size_t entryCount() const { return (_index.size() - LOG_INDEX_HEADER_SIZE) / LOG_INDEX_ENTRY_SIZE; };
+    LogIndexEntry entry(size_t i) const
+    {
+      return logIndexGetEntry(_index.data() + LOG_INDEX_HEADER_SIZE + i * LOG_INDEX_ENTRY_SIZE);
+    };
+    const uint8_t *data() const { return _log.data(); };
+    size_t size() const { return _log.size(); };
+
+    // Offset of the first NAV-PVT at or after time (ms since the GPS epoch), or the size of
+    // the log if there is none
+    uint64_t find(uint64_t time)
+    {
+      size_t count = entryCount();
+      // Last entry before time, by binary search. Its PVT is before the one we want
+      size_t low = 0, high = count;
+      while(low < high)
+      {
+        size_t middle = low + (high - low) / 2;
+        LogIndexEntry e = entry(middle);
+        if(gpsMillis(e.week, e.iTOW) < time)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+      uint64_t offset = low > 0 ? entry(low - 1).offset : 0;
+      return scanForPvt(offset, time);
+    };
+    // Bytes from the first NAV-PVT at or after start up to the first one at or after end
+    void window(uint64_t start, uint64_t end, uint64_t &begin, uint64_t &finish)
+    {
+      begin = find(start);
+      finish = find(end);
+      if(finish < begin)
+        finish = begin;
+    };
+
+    uint64_t scannedBytes = 0; // Log bytes looked at by the last queries
+
+  private:
+    uint64_t scanForPvt(uint64_t offset, uint64_t time)
+    {
+      const uint8_t *log = _log.data();
+      uint64_t size = _log.size();
+      while(offset + 8 <= size)
+      {
+        if(log[offset] != 0xB5 || log[offset + 1] != 0x62)
+        {
+          offset++;
+          scannedBytes++;
+          continue;
+        }
+        const uint8_t *frame = log + offset;
+        uint32_t length = frame[4] | (frame[5] << 8);
+        uint8_t a = 0, b = 0;
+        if(offset + length + 8 <= size)
+          ubxChecksum(frame + 2, length + 4, a, b);
+        if(offset + length + 8 > size || a != frame[length + 6] || b != frame[length + 7])
+        {
+          // Not a frame, or a damaged one whose length can't be trusted
+          offset++;
+          scannedBytes++;
+          continue;
+        }
+        if(frame[2] == 0x01 && frame[3] == 0x07 && length >= 12 && offset + 6 + 12 <= size)
+        {
+          const uint8_t *payload = frame + 6;
+          if((payload[11] & 0x03) == 0x03)
+          {
+            uint32_t iTOW = payload[0] | (payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            uint16_t week = gpsWeek(payload[4] | (payload[5] << 8), payload[6], payload[7], payload[8], payload[9], payload[10], iTOW);
+            if(gpsMillis(week, iTOW) >= time)
+              return offset;
+          }
+        }
+        offset += length + 8;
+        scannedBytes += length + 8;
+      }
+      return size;
+    };
+    MappedFile _log;
+    MappedFile _index;
+};
+
+#endif
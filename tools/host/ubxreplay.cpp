@@ -0,0 +1,491 @@
+// Feeds a recorded receiver capture (UBX, NMEA and RTCM mixed, as the serial port delivers
+// it) through the u-blox library as fast as it will go, with every automatic message and its
+// callback enabled, and reports how fast it parses.
+// The capture is framed up front so the report can say what each message cost: frames are
+// checked here as well (UBX Fletcher, NMEA XOR, RTCM CRC-24Q) and counted by protocol when
+// the check fails, so corrupt captures show up instead of just running faster.
+// Two passes: one frame at a time with a clock read around each, for the time per message
+// type, then the whole capture in serial-buffer sized chunks, for throughput.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -DARDUINO=10813 -Itools/host -Isrc/GpsStatusDisplay
+//     tools/host/ubxreplay.cpp tools/host/host_arduino.cpp
+//     src/GpsStatusDisplay/SparkFun_u-blox_GNSS_Arduino_Library.cpp -o ubxreplay
+//
+// Usage: ubxreplay [-n passes] [-c chunk bytes] capture.ubx
+//        ubxreplay [-n passes] [-c chunk bytes] -g seconds [capture.ubx]
+//   -g makes up a capture of that many 1Hz epochs (PVT, HPPOSLLH, DOP, STATUS, CLOCK, RAWX,
+//   SFRBX, GGA, RMC and RTCM MSM, with a corrupt frame now and then) and writes it to
+//   capture.ubx if given
+
+#include "receiverstream.h"
+#include <inttypes.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define REPLAY_CHUNK 4096 // Bytes per read in the throughput pass, like a serial DMA buffer
+
+static const char *protocolNames[PROTOCOL_COUNT] = { "UBX", "NMEA", "RTCM", "other" };
+
+struct Frame
+{
+  size_t offset;
+  size_t length;
+  size_t type;      // Index into types
+  uint8_t protocol; // Protocol
+  bool valid;       // Checksum matched
+};
+
+struct TypeStats
+{
+  std::string name;
+  uint8_t protocol;
+  uint32_t frames = 0;
+  uint64_t bytes = 0;
+  uint64_t nanos = 0;
+  uint64_t maxNanos = 0;
+};
+
+static std::vector<TypeStats> types;
+static std::map<std::string, size_t> typeIndex;
+
+static size_t typeFor(const std::string &name, uint8_t protocol)
+{
+  std::map<std::string, size_t>::iterator it = typeIndex.find(name);
+  if(it != typeIndex.end())
+    return it->second;
+  TypeStats stats;
+  stats.name = name;
+  stats.protocol = protocol;
+  types.push_back(stats);
+  typeIndex[name] = types.size() - 1;
+  return types.size() - 1;
+}
+
+static uint64_t nanos()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+// Framing
+
+struct UbxName
+{
+  uint8_t cls;
+  uint8_t id;
+  const char *name;
+};
+static const UbxName ubxNames[] = {
+  { 0x01, 0x01, "NAV-POSECEF" }, { 0x01, 0x03, "NAV-STATUS" }, { 0x01, 0x04, "NAV-DOP" },
+  { 0x01, 0x05, "NAV-ATT" }, { 0x01, 0x07, "NAV-PVT" }, { 0x01, 0x09, "NAV-ODO" },
+  { 0x01, 0x11, "NAV-VELECEF" }, { 0x01, 0x12, "NAV-VELNED" }, { 0x01, 0x13, "NAV-HPPOSECEF" },
+  { 0x01, 0x14, "NAV-HPPOSLLH" }, { 0x01, 0x22, "NAV-CLOCK" }, { 0x01, 0x3C, "NAV-RELPOSNED" },
+  { 0x02, 0x13, "RXM-SFRBX" }, { 0x02, 0x15, "RXM-RAWX" }, { 0x0D, 0x03, "TIM-TM2" },
+  { 0x10, 0x02, "ESF-MEAS" }, { 0x10, 0x03, "ESF-RAW" }, { 0x10, 0x10, "ESF-STATUS" },
+  { 0x10, 0x14, "ESF-ALG" }, { 0x10, 0x15, "ESF-INS" }, { 0x28, 0x00, "HNR-PVT" },
+  { 0x28, 0x01, "HNR-ATT" }, { 0x28, 0x02, "HNR-INS" },
+};
+
+static std::string ubxName(uint8_t cls, uint8_t id)
+{
+  for(size_t i = 0; i < sizeof(ubxNames) / sizeof(ubxNames[0]); i++)
+    if(ubxNames[i].cls == cls && ubxNames[i].id == id)
+      return ubxNames[i].name;
+  char name[16];
+  snprintf(name, sizeof(name), "UBX-%02X-%02X", cls, id);
+  return name;
+}
+
+static std::string frameName(const uint8_t *p, size_t length, uint8_t protocol)
+{
+  if(protocol == PROTOCOL_UBX)
+    return ubxName(p[2], p[3]);
+  if(protocol == PROTOCOL_NMEA)
+    return "NMEA-" + std::string((const char *)p + 3, 3);
+  char name[16];
+  snprintf(name, sizeof(name), "RTCM-%u", length > 7 ? (p[3] << 4) | (p[4] >> 4) : 0);
+  return name;
+}
+
+// Splits data into frames. Bytes that don't start a frame are collected into "other" frames.
+// A frame that fails its checksum is kept as its first byte only, with the type "other", and
+// the bytes after it are framed again: its length can't be trusted.
+static void frameCapture(const uint8_t *data, size_t size, std::vector<Frame> &frames)
+{
+  size_t other = typeFor("other", PROTOCOL_OTHER);
+  const uint8_t *p = data;
+  const uint8_t *end = data + size;
+  while(p < end)
+  {
+    Frame frame;
+    size_t length;
+    const uint8_t *start = nextFrame(p, end, length, frame.protocol, frame.valid);
+    if(start > p)
+    {
+      Frame junk = { (size_t)(p - data), (size_t)(start - p), other, PROTOCOL_OTHER, false };
+      frames.push_back(junk);
+    }
+    if(start == end)
+      break;
+    frame.offset = start - data;
+    frame.length = frame.valid ? length : 1;
+    frame.type = frame.valid ? typeFor(frameName(start, length, frame.protocol), frame.protocol) : other;
+    frames.push_back(frame);
+    p = frameEnd(start, length, frame.valid);
+  }
+}
+
+// What made it through the library
+
+static uint32_t callbacks = 0;
+static uint64_t nmeaBytes = 0;
+static uint64_t rtcmBytes = 0;
+
+void SFE_UBLOX_GNSS::processNMEA(char incoming)
+{
+  (void)incoming;
+  nmeaBytes++;
+}
+void SFE_UBLOX_GNSS::processRTCM(uint8_t incoming)
+{
+  (void)incoming;
+  rtcmBytes++;
+}
+
+#define REPLAY_CALLBACK(name, type) static void name(type data) { (void)data; callbacks++; }
+REPLAY_CALLBACK(onPOSECEF, UBX_NAV_POSECEF_data_t)
+REPLAY_CALLBACK(onSTATUS, UBX_NAV_STATUS_data_t)
+REPLAY_CALLBACK(onDOP, UBX_NAV_DOP_data_t)
+REPLAY_CALLBACK(onATT, UBX_NAV_ATT_data_t)
+REPLAY_CALLBACK(onPVT, UBX_NAV_PVT_data_t)
+REPLAY_CALLBACK(onODO, UBX_NAV_ODO_data_t)
+REPLAY_CALLBACK(onVELECEF, UBX_NAV_VELECEF_data_t)
+REPLAY_CALLBACK(onVELNED, UBX_NAV_VELNED_data_t)
+REPLAY_CALLBACK(onHPPOSECEF, UBX_NAV_HPPOSECEF_data_t)
+REPLAY_CALLBACK(onHPPOSLLH, UBX_NAV_HPPOSLLH_data_t)
+REPLAY_CALLBACK(onCLOCK, UBX_NAV_CLOCK_data_t)
+REPLAY_CALLBACK(onRELPOSNED, UBX_NAV_RELPOSNED_data_t)
+REPLAY_CALLBACK(onSFRBX, UBX_RXM_SFRBX_data_t)
+REPLAY_CALLBACK(onRAWX, UBX_RXM_RAWX_data_t)
+REPLAY_CALLBACK(onTM2, UBX_TIM_TM2_data_t)
+REPLAY_CALLBACK(onESFALG, UBX_ESF_ALG_data_t)
+REPLAY_CALLBACK(onESFSTATUS, UBX_ESF_STATUS_data_t)
+REPLAY_CALLBACK(onESFINS, UBX_ESF_INS_data_t)
+REPLAY_CALLBACK(onESFMEAS, UBX_ESF_MEAS_data_t)
+REPLAY_CALLBACK(onESFRAW, UBX_ESF_RAW_data_t)
+REPLAY_CALLBACK(onHNRATT, UBX_HNR_ATT_data_t)
+REPLAY_CALLBACK(onHNRINS, UBX_HNR_INS_data_t)
+REPLAY_CALLBACK(onHNRPVT, UBX_HNR_PVT_data_t)
+
+static bool enableCallbacks(SFE_UBLOX_GNSS &gps)
+{
+  return gps.setAutoNAVPOSECEFcallback(onPOSECEF) && gps.setAutoNAVSTATUScallback(onSTATUS) &&
+    gps.setAutoDOPcallback(onDOP) && gps.setAutoNAVATTcallback(onATT) &&
+    gps.setAutoPVTcallback(onPVT) && gps.setAutoNAVODOcallback(onODO) &&
+    gps.setAutoNAVVELECEFcallback(onVELECEF) && gps.setAutoNAVVELNEDcallback(onVELNED) &&
+    gps.setAutoNAVHPPOSECEFcallback(onHPPOSECEF) && gps.setAutoHPPOSLLHcallback(onHPPOSLLH) &&
+    gps.setAutoNAVCLOCKcallback(onCLOCK) && gps.setAutoRELPOSNEDcallback(onRELPOSNED) &&
+    gps.setAutoRXMSFRBXcallback(onSFRBX) && gps.setAutoRXMRAWXcallback(onRAWX) &&
+    gps.setAutoTIMTM2callback(onTM2) && gps.setAutoESFALGcallback(onESFALG) &&
+    gps.setAutoESFSTATUScallback(onESFSTATUS) && gps.setAutoESFINScallback(onESFINS) &&
+    gps.setAutoESFMEAScallback(onESFMEAS) && gps.setAutoESFRAWcallback(onESFRAW) &&
+    gps.setAutoHNRATTcallback(onHNRATT) && gps.setAutoHNRINScallback(onHNRINS) &&
+    gps.setAutoHNRPVTcallback(onHNRPVT);
+}
+
+// Made up capture
+
+static uint32_t randomState = 12345;
+static uint32_t randomNumber()
+{
+  randomState = randomState * 1103515245 + 12345;
+  return randomState >> 16;
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+  for(uint8_t i = 0; i < 4; i++)
+    p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void putUbx(std::vector<uint8_t> &out, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length)
+{
+  size_t start = out.size();
+  const uint8_t header[6] = { 0xB5, 0x62, cls, id, (uint8_t)length, (uint8_t)(length >> 8) };
+  out.insert(out.end(), header, header + 6);
+  out.insert(out.end(), payload, payload + length);
+  uint8_t a, b;
+  ubxChecksum(out.data() + start + 2, length + 4, a, b);
+  out.push_back(a);
+  out.push_back(b);
+}
+
+static void putNmea(std::vector<uint8_t> &out, const char *body)
+{
+  uint8_t sum = 0;
+  for(const char *c = body; *c; c++)
+    sum ^= *c;
+  char sentence[100];
+  int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, sum);
+  out.insert(out.end(), sentence, sentence + length);
+}
+
+static void putRtcm(std::vector<uint8_t> &out, uint16_t number, uint16_t length)
+{
+  size_t start = out.size();
+  out.push_back(0xD3);
+  out.push_back(length >> 8);
+  out.push_back(length & 0xFF);
+  out.push_back(number >> 4);
+  out.push_back((number << 4) | (randomNumber() & 0x0F));
+  for(uint16_t i = 2; i < length; i++)
+    out.push_back(randomNumber());
+  uint32_t crc = crc24q(out.data() + start, length + 3);
+  out.push_back(crc >> 16);
+  out.push_back(crc >> 8);
+  out.push_back(crc);
+}
+
+static void generateCapture(uint32_t seconds, std::vector<uint8_t> &out)
+{
+  uint8_t payload[UBX_RXM_RAWX_MAX_LEN];
+  for(uint32_t epoch = 0; epoch < seconds; epoch++)
+  {
+    uint32_t iTOW = 300000000 + epoch * 1000;
+    uint32_t second = 12 * 3600 + 34 * 60 + epoch;
+    uint8_t numSV = 18 + randomNumber() % 5;
+    int32_t lat = 476205000 + (int32_t)(randomNumber() % 100);
+    int32_t lon = -1223493000 + (int32_t)(randomNumber() % 100);
+
+    memset(payload, 0, 92);
+    put32(payload, iTOW);
+    payload[4] = 2026 & 0xFF;
+    payload[5] = 2026 >> 8;
+    payload[6] = 10;
+    payload[7] = 18;
+    payload[8] = second / 3600 % 24;
+    payload[9] = second / 60 % 60;
+    payload[10] = second % 60;
+    payload[11] = 0x07;
+    payload[20] = 3;
+    payload[21] = 0x81;
+    payload[23] = numSV;
+    put32(payload + 24, lon);
+    put32(payload + 28, lat);
+    put32(payload + 36, 52000 + randomNumber() % 60);
+    put32(payload + 40, 14);
+    put32(payload + 44, 21);
+    putUbx(out, UBX_CLASS_NAV, UBX_NAV_PVT, payload, 92);
+
+    memset(payload, 0, 36);
+    put32(payload + 4, iTOW);
+    put32(payload + 8, lon);
+    put32(payload + 12, lat);
+    put32(payload + 28, 140 + randomNumber() % 40);
+    put32(payload + 32, 210 + randomNumber() % 60);
+    putUbx(out, UBX_CLASS_NAV, UBX_NAV_HPPOSLLH, payload, 36);
+
+    memset(payload, 0, 18);
+    put32(payload, iTOW);
+    payload[6] = 120;
+    putUbx(out, UBX_CLASS_NAV, UBX_NAV_DOP, payload, 18);
+
+    memset(payload, 0, 16);
+    put32(payload, iTOW);
+    payload[4] = 3;
+    payload[5] = 0xDD;
+    putUbx(out, UBX_CLASS_NAV, UBX_NAV_STATUS, payload, 16);
+
+    memset(payload, 0, 20);
+    put32(payload, iTOW);
+    putUbx(out, UBX_CLASS_NAV, UBX_NAV_CLOCK, payload, 20);
+
+    // Raw measurements, two signals per satellite
+    uint8_t numMeas = 2 * numSV;
+    memset(payload, 0, 16 + 32 * numMeas);
+    payload[10] = 18;
+    payload[11] = numMeas;
+    payload[13] = 1;
+    for(uint16_t i = 16; i < 16 + 32 * numMeas; i++)
+      payload[i] = randomNumber();
+    putUbx(out, UBX_CLASS_RXM, UBX_RXM_RAWX, payload, 16 + 32 * numMeas);
+
+    for(uint8_t i = 0; i < 4; i++)
+    {
+      memset(payload, 0, 48);
+      payload[0] = i % 3;
+      payload[1] = 1 + i;
+      payload[4] = 10;
+      payload[5] = 1;
+      for(uint8_t j = 8; j < 48; j++)
+        payload[j] = randomNumber();
+      putUbx(out, UBX_CLASS_RXM, UBX_RXM_SFRBX, payload, 48);
+    }
+
+    char body[100];
+    snprintf(body, sizeof(body), "GNGGA,%02u%02u%02u.00,4737.23000,N,12220.95800,W,4,%02u,0.70,52.0,M,-19.4,M,1.0,0000",
+      second / 3600 % 24, second / 60 % 60, second % 60, numSV);
+    putNmea(out, body);
+    snprintf(body, sizeof(body), "GNRMC,%02u%02u%02u.00,A,4737.23000,N,12220.95800,W,0.015,,181026,,,R,V",
+      second / 3600 % 24, second / 60 % 60, second % 60);
+    putNmea(out, body);
+
+    if(epoch % 10 == 0)
+      putRtcm(out, 1005, 19);
+    putRtcm(out, 1077, 40 + 28 * numSV / 2);
+    putRtcm(out, 1087, 30 + 24 * numSV / 4);
+    putRtcm(out, 1097, 30 + 24 * numSV / 4);
+    putRtcm(out, 1127, 30 + 24 * numSV / 4);
+
+    // Line noise: a flipped bit in the middle of this epoch's PVT every now and then
+    if(epoch % 97 == 13)
+    {
+      for(size_t i = out.size(); i-- > 0; )
+        if(out[i] == 0xB5 && i + 1 < out.size() && out[i + 1] == 0x62 && out[i + 2] == UBX_CLASS_NAV && out[i + 3] == UBX_NAV_PVT)
+        {
+          out[i + 30] ^= 0x04;
+          break;
+        }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t passes = 10;
+  size_t chunk = REPLAY_CHUNK;
+  long generate = -1;
+  const char *path = nullptr;
+  bool usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      passes = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-c") && i + 1 < argc)
+      chunk = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-g") && i + 1 < argc)
+      generate = atol(argv[++i]);
+    else if(argv[i][0] != '-' && path == nullptr)
+      path = argv[i];
+    else
+      usage = true;
+  }
+  if(usage || passes == 0 || chunk == 0 || (path == nullptr && generate < 0))
+  {
+    fprintf(stderr, "Usage: ubxreplay [-n passes] [-c chunk bytes] capture.ubx\n"
+      "       ubxreplay [-n passes] [-c chunk bytes] -g seconds [capture.ubx]\n");
+    return 1;
+  }
+
+  std::vector<uint8_t> capture;
+  if(generate >= 0)
+  {
+    generateCapture(generate, capture);
+    FILE *file = path ? fopen(path, "wb") : nullptr;
+    if(path && (!file || fwrite(capture.data(), 1, capture.size(), file) != capture.size()))
+    {
+      perror(path);
+      return 1;
+    }
+    if(file)
+      fclose(file);
+  }
+  else
+  {
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+      perror(path);
+      return 1;
+    }
+    uint8_t buffer[65536];
+    size_t count;
+    while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      capture.insert(capture.end(), buffer, buffer + count);
+    fclose(file);
+  }
+
+  std::vector<Frame> frames;
+  frameCapture(capture.data(), capture.size(), frames);
+  uint32_t framesByProtocol[PROTOCOL_COUNT] = { 0 };
+  uint32_t checksumFailures[PROTOCOL_COUNT] = { 0 };
+  for(size_t i = 0; i < frames.size(); i++)
+  {
+    framesByProtocol[frames[i].protocol]++;
+    if(!frames[i].valid && frames[i].protocol != PROTOCOL_OTHER)
+      checksumFailures[frames[i].protocol]++;
+  }
+
+  ReceiverStream stream;
+  SFE_UBLOX_GNSS gps;
+  if(!gps.begin(stream))
+  {
+    fprintf(stderr, "The library didn't accept the stand-in receiver\n");
+    return 1;
+  }
+  if(!enableCallbacks(gps))
+  {
+    fprintf(stderr, "Enabling the automatic messages failed\n");
+    return 1;
+  }
+  uint32_t setupCommands = stream.commands;
+
+  // Per message: one frame per checkUblox(), timed
+  for(uint32_t pass = 0; pass < passes; pass++)
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+      const Frame &frame = frames[i];
+      stream.setWindow(capture.data() + frame.offset, frame.length);
+      uint64_t start = nanos();
+      gps.checkUblox();
+      gps.checkCallbacks();
+      uint64_t elapsed = nanos() - start;
+      TypeStats &stats = types[frame.type];
+      stats.nanos += elapsed;
+      if(elapsed > stats.maxNanos)
+        stats.maxNanos = elapsed;
+      if(pass == 0)
+      {
+        stats.frames++;
+        stats.bytes += frame.length;
+      }
+    }
+  uint32_t callbacksPerPass = callbacks / passes;
+
+  // Throughput: the capture in chunks, as the sketch reads the serial port
+  callbacks = 0;
+  uint64_t start = nanos();
+  for(uint32_t pass = 0; pass < passes; pass++)
+    for(size_t offset = 0; offset < capture.size(); offset += chunk)
+    {
+      stream.setWindow(capture.data() + offset, capture.size() - offset < chunk ? capture.size() - offset : chunk);
+      gps.checkUblox();
+      gps.checkCallbacks();
+    }
+  double seconds = (nanos() - start) / 1e9;
+
+  printf("%zu bytes, %zu frames (UBX %u, NMEA %u, RTCM %u, other %u), %u setup commands answered\n",
+    capture.size(), frames.size(), framesByProtocol[PROTOCOL_UBX], framesByProtocol[PROTOCOL_NMEA],
+    framesByProtocol[PROTOCOL_RTCM], framesByProtocol[PROTOCOL_OTHER], setupCommands);
+  printf("checksum failures: UBX %u, NMEA %u, RTCM %u\n",
+    checksumFailures[PROTOCOL_UBX], checksumFailures[PROTOCOL_NMEA], checksumFailures[PROTOCOL_RTCM]);
+  printf("per pass: %u callbacks, %" PRIu64 " NMEA and %" PRIu64 " RTCM bytes passed on\n",
+    callbacksPerPass, nmeaBytes / (2 * passes), rtcmBytes / (2 * passes));
+  printf("throughput over %u passes in %zu byte chunks: %.0f msgs/s, %.1f MB/s\n",
+    passes, chunk, frames.size() * passes / seconds, capture.size() * passes / seconds / 1e6);
+  printf("\n%-16s %-5s %8s %10s %10s %10s %10s\n", "type", "proto", "frames", "bytes", "ns/msg", "ns/byte", "max ns");
+  for(size_t i = 0; i < types.size(); i++)
+  {
+    const TypeStats &stats = types[i];
+    if(stats.frames == 0)
+      continue;
+    double perMessage = (double)stats.nanos / ((uint64_t)stats.frames * passes);
+    printf("%-16s %-5s %8u %10" PRIu64 " %10.0f %10.2f %10" PRIu64 "\n", stats.name.c_str(), protocolNames[stats.protocol],
+      stats.frames, stats.bytes, perMessage, perMessage * stats.frames / stats.bytes, stats.maxNanos);
+  }
+  return 0;
+}
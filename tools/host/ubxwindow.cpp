@@ -0,0 +1,60 @@
+// Copies the part of a UBX log between two GPS times to stdout, using the log's time index
+// (LOGnnn.IDX) to seek instead of scanning the log from the start.
+// The window starts at the first NAV-PVT at or after the start time and ends before the
+// first one at or after the end time.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -Isrc/GpsStatusDisplay -Itools/host tools/host/ubxwindow.cpp -o ubxwindow
+//
+// Usage: ubxwindow log.ubx log.idx week start end > window.ubx
+//   start and end are seconds of the GPS week and may go past its end into the next week
+// ubxwindow -l log.ubx log.idx lists the index
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "ubxlogreader.h"
+
+int main(int argc, char **argv)
+{
+  bool list = argc == 4 && !strcmp(argv[1], "-l");
+  if(!list && argc != 6)
+  {
+    fprintf(stderr, "Usage: %s log.ubx log.idx week start end\n       %s -l log.ubx log.idx\n", argv[0], argv[0]);
+    return 1;
+  }
+  UbxLogReader reader;
+  const char *logPath = list ? argv[2] : argv[1];
+  const char *indexPath = list ? argv[3] : argv[2];
+  if(!reader.open(logPath, indexPath))
+  {
+    fprintf(stderr, "Can't open %s with the index %s\n", logPath, indexPath);
+    return 1;
+  }
+  if(list)
+  {
+    printf("week,iTOW,offset\n");
+    for(size_t i = 0; i < reader.entryCount(); i++)
+    {
+      LogIndexEntry e = reader.entry(i);
+      printf("%u,%" PRIu32 ",%" PRIu64 "\n", e.week, e.iTOW, e.offset);
+    }
+    return 0;
+  }
+
+  uint16_t week = atoi(argv[3]);
+  uint64_t start = gpsMillis(week, 0) + (uint64_t)(atof(argv[4]) * 1000);
+  uint64_t end = gpsMillis(week, 0) + (uint64_t)(atof(argv[5]) * 1000);
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint64_t begin, finish;
+  reader.window(start, end, begin, finish);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  fwrite(reader.data() + begin, 1, finish - begin, stdout);
+  fprintf(stderr, "%" PRIu64 " bytes at %" PRIu64 " of %zu, %zu index entries every %us, %" PRIu64 " bytes scanned, %.1fus\n",
+    finish - begin, begin, reader.size(), reader.entryCount(), reader.intervalSeconds(), reader.scannedBytes,
+    (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3);
+  return 0;
+}